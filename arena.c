@@ -0,0 +1,215 @@
+/*--------------------------------------------------------------------*/
+/* arena.c                                                            */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include "arena.h"
+
+/*ALIGNMENT is the size every block is rounded up to and aligned on*/
+enum { ALIGNMENT = 16 };
+
+/*blocks of up to CLASS_COUNT * ALIGNMENT bytes come from chunks, one
+size class per multiple of ALIGNMENT. Bigger blocks are malloced alone*/
+enum { CLASS_COUNT = 16 };
+
+/*chunk sizes start at MIN_CHUNK bytes and double up to MAX_CHUNK so
+small tables stay small and big tables need few chunks*/
+enum { MIN_CHUNK = 1024, MAX_CHUNK = 4194304 };
+
+/*A Chunk is a malloced region that small blocks are carved from. The
+header takes the first ALIGNMENT bytes of the region*/
+struct Chunk {
+  /*next Chunk owned by the same Arena*/
+  struct Chunk *next;
+};
+
+/*A Large is the header in front of a block too big for any size class,
+linked so that Arena_free can find blocks never released*/
+struct Large {
+  /*previous Large in the Arena, or NULL if this is the first*/
+  struct Large *prev;
+  /*next Large in the Arena, or NULL if this is the last*/
+  struct Large *next;
+};
+
+/*A FreeBlock is a released small block waiting to be reused*/
+struct FreeBlock {
+  /*next FreeBlock of the same size class*/
+  struct FreeBlock *next;
+};
+
+/*An Arena is the set of Chunks and Large blocks owned by one SymTable,
+with a free list per size class and a bump pointer into the newest
+Chunk.*/
+struct Arena {
+  /*freeLists[i] holds released blocks of (i + 1) * ALIGNMENT bytes*/
+  struct FreeBlock *freeLists[CLASS_COUNT];
+  /*chunks is the newest Chunk, linked to the older ones*/
+  struct Chunk *chunks;
+  /*bump is the first unused byte of the newest Chunk*/
+  char *bump;
+  /*bumpLeft is number of unused bytes after bump*/
+  size_t bumpLeft;
+  /*chunkSize is the size of the next Chunk to allocate*/
+  size_t chunkSize;
+  /*large is the most recent Large block still allocated*/
+  struct Large *large;
+  /*bytes is number of bytes of Chunks and Large blocks allocated*/
+  size_t bytes;
+};
+
+/*Returns the size class index of a small block of uSize bytes.*/
+static size_t Arena_class(size_t uSize);
+
+/*Allocates a new Chunk of at least uNeeded free bytes for oArena and
+makes it the bump Chunk. Returns 1 (TRUE) on success or 0 (FALSE) if
+insufficient memory is available.*/
+static int Arena_grow(Arena_T oArena, size_t uNeeded);
+
+Arena_T Arena_new(void){
+  Arena_T arena;
+  size_t i;
+
+  assert(sizeof(struct Chunk) <= ALIGNMENT);
+  assert(sizeof(struct Large) <= ALIGNMENT);
+
+  arena = (Arena_T) malloc(sizeof(struct Arena));
+  if(arena == NULL) return NULL;
+
+  for(i = 0; i < CLASS_COUNT; i++) arena->freeLists[i] = NULL;
+  /*no Chunk is allocated until the first small block is needed*/
+  arena->chunks = NULL;
+  arena->bump = NULL;
+  arena->bumpLeft = 0;
+  arena->chunkSize = MIN_CHUNK;
+  arena->large = NULL;
+  arena->bytes = 0;
+  return arena;
+}
+
+void Arena_free(Arena_T oArena){
+  struct Chunk *chunk;
+  struct Large *large;
+
+  assert(oArena != NULL);
+
+  chunk = oArena->chunks;
+  while(chunk != NULL){
+    struct Chunk *temp = chunk;
+    chunk = chunk->next;
+    free(temp);
+  }
+  large = oArena->large;
+  while(large != NULL){
+    struct Large *temp = large;
+    large = large->next;
+    free(temp);
+  }
+  free(oArena);
+}
+
+void *Arena_alloc(Arena_T oArena, size_t uSize){
+  size_t cls;
+  size_t blockSize;
+  void *block;
+
+  assert(oArena != NULL);
+
+  if(uSize == 0) uSize = 1;
+
+  /*big blocks get their own malloc with a Large header in front*/
+  if(uSize > CLASS_COUNT * ALIGNMENT){
+    struct Large *large;
+    if(uSize > ((size_t) -1) - ALIGNMENT) return NULL;
+    large = (struct Large *) malloc(ALIGNMENT + uSize);
+    if(large == NULL) return NULL;
+    large->prev = NULL;
+    large->next = oArena->large;
+    if(oArena->large != NULL) oArena->large->prev = large;
+    oArena->large = large;
+    oArena->bytes += ALIGNMENT + uSize;
+    return (char *) large + ALIGNMENT;
+  }
+
+  cls = Arena_class(uSize);
+  blockSize = (cls + 1) * ALIGNMENT;
+
+  /*reuses a released block of the same class first*/
+  if(oArena->freeLists[cls] != NULL){
+    struct FreeBlock *freeBlock = oArena->freeLists[cls];
+    oArena->freeLists[cls] = freeBlock->next;
+    return freeBlock;
+  }
+
+  if(oArena->bumpLeft < blockSize && !Arena_grow(oArena, blockSize))
+    return NULL;
+  block = oArena->bump;
+  oArena->bump += blockSize;
+  oArena->bumpLeft -= blockSize;
+  return block;
+}
+
+void Arena_release(Arena_T oArena, void *pvBlock, size_t uSize){
+  assert(oArena != NULL);
+  assert(pvBlock != NULL);
+
+  if(uSize == 0) uSize = 1;
+
+  if(uSize > CLASS_COUNT * ALIGNMENT){
+    struct Large *large = (struct Large *) ((char *) pvBlock - ALIGNMENT);
+    if(large->prev != NULL) large->prev->next = large->next;
+    else oArena->large = large->next;
+    if(large->next != NULL) large->next->prev = large->prev;
+    free(large);
+    oArena->bytes -= ALIGNMENT + uSize;
+  }
+  else {
+    struct FreeBlock *freeBlock = (struct FreeBlock *) pvBlock;
+    size_t cls = Arena_class(uSize);
+    freeBlock->next = oArena->freeLists[cls];
+    oArena->freeLists[cls] = freeBlock;
+  }
+}
+
+size_t Arena_getBytes(Arena_T oArena){
+  assert(oArena != NULL);
+  return oArena->bytes;
+}
+
+static size_t Arena_class(size_t uSize){
+  assert(uSize > 0 && uSize <= CLASS_COUNT * ALIGNMENT);
+  return (uSize - 1) / ALIGNMENT;
+}
+
+static int Arena_grow(Arena_T oArena, size_t uNeeded){
+  struct Chunk *chunk;
+  size_t size;
+
+  assert(oArena != NULL);
+
+  size = oArena->chunkSize;
+  while(size < ALIGNMENT + uNeeded) size *= 2;
+
+  chunk = (struct Chunk *) malloc(size);
+  if(chunk == NULL) return 0;
+
+  /*the unused tail of the old Chunk becomes one free block of the
+  largest class that fits so it is not lost*/
+  if(oArena->bumpLeft >= ALIGNMENT){
+    struct FreeBlock *freeBlock = (struct FreeBlock *) oArena->bump;
+    size_t cls = oArena->bumpLeft / ALIGNMENT - 1;
+    if(cls >= CLASS_COUNT) cls = CLASS_COUNT - 1;
+    freeBlock->next = oArena->freeLists[cls];
+    oArena->freeLists[cls] = freeBlock;
+  }
+
+  chunk->next = oArena->chunks;
+  oArena->chunks = chunk;
+  oArena->bump = (char *) chunk + ALIGNMENT;
+  oArena->bumpLeft = size - ALIGNMENT;
+  oArena->bytes += size;
+  if(oArena->chunkSize < MAX_CHUNK) oArena->chunkSize *= 2;
+  return 1;
+}
@@ -0,0 +1,38 @@
+/*--------------------------------------------------------------------*/
+/* arena.h                                                            */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*Arena_T is a pointer to an Arena, a pool of memory blocks owned by a
+single SymTable or Intern. Small blocks are carved out of a few large
+chunks and released blocks are reused for later blocks of the same size
+class, so freeing the whole Arena takes a handful of calls to free.*/
+typedef struct Arena* Arena_T;
+
+/*Arena_new creates and returns a new Arena that owns no blocks, or
+returns NULL if insufficient memory is available.*/
+Arena_T Arena_new(void);
+
+/*Arena_free frees oArena and every block allocated from it that has
+not been released.*/
+void Arena_free(Arena_T oArena);
+
+/*Arena_alloc returns a block of at least uSize bytes from oArena,
+aligned for any object the SymTable implementations store, or NULL if
+insufficient memory is available.*/
+void *Arena_alloc(Arena_T oArena, size_t uSize);
+
+/*Arena_release gives pvBlock back to oArena for reuse. pvBlock must
+have come from Arena_alloc on oArena with the same uSize.*/
+void Arena_release(Arena_T oArena, void *pvBlock, size_t uSize);
+
+/*Arena_getBytes returns number of bytes oArena holds from malloc, its
+chunks and large blocks, not counting the Arena itself.*/
+size_t Arena_getBytes(Arena_T oArena);
+
+#endif
@@ -0,0 +1,1650 @@
+/*--------------------------------------------------------------------*/
+/* benchsymtable.c                                                    */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "symtable.h"
+#include "strhash.h"
+#include "intern.h"
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The bench targets are linked with --wrap for malloc, calloc, realloc
+   and free, so every call the SymTable implementation makes to them
+   comes through the functions below and is counted, along with the
+   bytes the allocator actually hands out for it. */
+
+void *__real_malloc(size_t uSize);
+void *__real_calloc(size_t uCount, size_t uSize);
+void *__real_realloc(void *pv, size_t uSize);
+void __real_free(void *pv);
+
+void *__wrap_malloc(size_t uSize);
+void *__wrap_calloc(size_t uCount, size_t uSize);
+void *__wrap_realloc(void *pv, size_t uSize);
+void __wrap_free(void *pv);
+
+/* Number of allocations and frees made by the SymTable implementation
+   since the program started. */
+static unsigned long ulAllocCount = 0;
+static unsigned long ulFreeCount = 0;
+
+/* Number of bytes in blocks allocated and not yet freed, as
+   malloc_usable_size() reports them, so the size rounding and minimum
+   block size of the allocator are included. */
+static long lLiveBytes = 0;
+
+/* Largest value lLiveBytes has had since it was last reset. */
+static long lPeakBytes = 0;
+
+/* The threads of SymTable_bulkLoad() and SymTable_mapParallel()
+   allocate and free at the same time, so the wrappers change the
+   counts above with the GCC __atomic builtins.  The bench reads and
+   resets them only between calls, once those threads have been
+   joined. */
+
+/* Add lBytes, which may be negative, to lLiveBytes, and raise
+   lPeakBytes to the sum if it is larger. */
+
+static void addLiveBytes(long lBytes)
+{
+   long lLive = __atomic_add_fetch(&lLiveBytes, lBytes, __ATOMIC_RELAXED);
+   long lPeak = __atomic_load_n(&lPeakBytes, __ATOMIC_RELAXED);
+
+   /* A failed exchange reloads lPeak, so the loop ends once lPeakBytes
+      is at least lLive. */
+   while (lLive > lPeak
+      && ! __atomic_compare_exchange_n(&lPeakBytes, &lPeak, lLive, 1,
+         __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      ;
+}
+
+void *__wrap_malloc(size_t uSize)
+{
+   void *pv;
+   __atomic_add_fetch(&ulAllocCount, 1, __ATOMIC_RELAXED);
+   pv = __real_malloc(uSize);
+   addLiveBytes((long)malloc_usable_size(pv));
+   return pv;
+}
+
+void *__wrap_calloc(size_t uCount, size_t uSize)
+{
+   void *pv;
+   __atomic_add_fetch(&ulAllocCount, 1, __ATOMIC_RELAXED);
+   pv = __real_calloc(uCount, uSize);
+   addLiveBytes((long)malloc_usable_size(pv));
+   return pv;
+}
+
+void *__wrap_realloc(void *pv, size_t uSize)
+{
+   long lOldBytes = (long)malloc_usable_size(pv);
+   void *pvNew;
+   __atomic_add_fetch(&ulAllocCount, 1, __ATOMIC_RELAXED);
+   pvNew = __real_realloc(pv, uSize);
+   if (pvNew != NULL || uSize == 0)
+      addLiveBytes((long)malloc_usable_size(pvNew) - lOldBytes);
+   return pvNew;
+}
+
+void __wrap_free(void *pv)
+{
+   if (pv != NULL)
+      __atomic_add_fetch(&ulFreeCount, 1, __ATOMIC_RELAXED);
+   addLiveBytes(-(long)malloc_usable_size(pv));
+   __real_free(pv);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the current time of the monotonic clock in nanoseconds. */
+
+static double nowNs(void)
+{
+   struct timespec sTime;
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (double)sTime.tv_sec * 1e9 + (double)sTime.tv_nsec;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iBindingCount bindings into a new SymTable object, timing each
+   SymTable_put() call separately.  The slowest calls are the ones
+   that expanded the table, so write them to stdout along with the
+   total and average time per put. */
+
+static void benchResizePauses(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 16};
+   enum {SLOWEST_COUNT = 8};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   double adSlowest[SLOWEST_COUNT];
+   double dStart;
+   double dElapsed;
+   double dTotal = 0.0;
+   int i;
+   int j;
+
+   printf("------------------------------------------------------\n");
+   printf("Resize pauses while putting %d bindings.\n", iBindingCount);
+   fflush(stdout);
+
+   for (j = 0; j < SLOWEST_COUNT; j++)
+      adSlowest[j] = 0.0;
+
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "SymTable_new failed\n");
+      exit(EXIT_FAILURE);
+   }
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      dStart = nowNs();
+      if (! SymTable_put(oSymTable, acKey, NULL))
+      {
+         fprintf(stderr, "SymTable_put failed\n");
+         exit(EXIT_FAILURE);
+      }
+      dElapsed = nowNs() - dStart;
+      dTotal += dElapsed;
+
+      /* Keep adSlowest sorted from slowest to fastest. */
+      if (dElapsed > adSlowest[SLOWEST_COUNT - 1])
+      {
+         for (j = SLOWEST_COUNT - 1;
+              j > 0 && adSlowest[j - 1] < dElapsed; j--)
+            adSlowest[j] = adSlowest[j - 1];
+         adSlowest[j] = dElapsed;
+      }
+   }
+
+   SymTable_free(oSymTable);
+
+   printf("total put time:   %.3f ms\n", dTotal / 1e6);
+   printf("average put:      %.1f ns\n",
+      iBindingCount > 0 ? dTotal / iBindingCount : 0.0);
+   printf("slowest puts (us):");
+   for (j = 0; j < SLOWEST_COUNT; j++)
+      printf(" %.1f", adSlowest[j] / 1e3);
+   printf("\n");
+   fflush(stdout);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The key shapes used to measure the hash function. */
+
+enum KeyShape {
+   /* "0", "1", "2", ... as in testLargeTable() */
+   SHAPE_DECIMAL,
+   /* decimal keys that all land in bucket 123 of 509 under the
+      assignment's hash, the keys that collided in the original
+      testCollisions() */
+   SHAPE_COLLIDING,
+   /* 999 byte keys that differ only in their last digits, the shape
+      of the keys in testLongKey() */
+   SHAPE_LONG,
+   SHAPE_COUNT
+};
+
+/* Return the bucket of pcKey among uBucketCount buckets under the
+   hash function given in the assignment specification. */
+
+static size_t assignmentBucket(const char *pcKey, size_t uBucketCount)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   size_t uHash = 0;
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+   return uHash % uBucketCount;
+}
+
+/* Write key number i of shape eShape into pcKey, which must have room
+   for LONG_KEY_SIZE bytes.  *piNext is the state needed to generate
+   SHAPE_COLLIDING keys in order and must start at 0.  Return the
+   length of the key. */
+
+enum {LONG_KEY_SIZE = 1000};
+
+static size_t makeKey(enum KeyShape eShape, int i, int *piNext,
+   char *pcKey)
+{
+   enum {COLLIDING_BUCKETS = 509, COLLIDING_BUCKET = 123};
+
+   switch (eShape)
+   {
+      case SHAPE_DECIMAL:
+         return (size_t)sprintf(pcKey, "%d", i);
+      case SHAPE_COLLIDING:
+         do
+            sprintf(pcKey, "%d", (*piNext)++);
+         while (assignmentBucket(pcKey, COLLIDING_BUCKETS)
+                != COLLIDING_BUCKET);
+         return strlen(pcKey);
+      default:
+         memset(pcKey, 'a', LONG_KEY_SIZE - 1);
+         sprintf(pcKey + LONG_KEY_SIZE - 12, "%011d", i);
+         return LONG_KEY_SIZE - 1;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Hash iKeyCount keys of each shape with StrHash_hash() and write its
+   throughput to stdout.  Also spread the hashes over the smallest
+   power of two number of buckets that is at least iKeyCount, masking
+   them as symtablehash.c does, and write the average number of keys
+   compared by a successful lookup next to the ideal for a uniform
+   hash, and the longest chain. */
+
+static void benchHashFunction(int iKeyCount)
+{
+   enum {BATCH_SIZE = 64};
+
+   static const char *apcShapeNames[SHAPE_COUNT] =
+      {"decimal", "colliding", "long"};
+   static char aacBatch[BATCH_SIZE][LONG_KEY_SIZE];
+
+   size_t auLengths[BATCH_SIZE];
+   size_t *puHashes;
+   size_t *puCounts;
+   size_t uBuckets;
+   size_t uBytes;
+   size_t uMax;
+   double dStart;
+   double dElapsed;
+   double dProbes;
+   int iShape;
+   int iNext;
+   int iCount;
+   int iBatch;
+   int i;
+   int j;
+
+   printf("------------------------------------------------------\n");
+   printf("Hash function %s.\n", StrHash_name());
+   printf("shape        keys   ns/hash     MB/s  probes  ideal  "
+          "longest\n");
+   fflush(stdout);
+
+   for (iShape = 0; iShape < SHAPE_COUNT; iShape++)
+   {
+      /* Colliding keys are rare, so fewer of them are made. */
+      iCount = iKeyCount;
+      if (iShape == SHAPE_COLLIDING && iCount > 4096)
+         iCount = 4096;
+
+      uBuckets = 1;
+      while (uBuckets < (size_t)iCount)
+         uBuckets *= 2;
+      puHashes = (size_t*)calloc((size_t)iCount + 1, sizeof(size_t));
+      puCounts = (size_t*)calloc(uBuckets, sizeof(size_t));
+      if (puHashes == NULL || puCounts == NULL)
+      {
+         fprintf(stderr, "out of memory\n");
+         exit(EXIT_FAILURE);
+      }
+
+      /* Keys are made BATCH_SIZE at a time and only the hash calls
+         are timed, so the clock is read once per batch. */
+      iNext = 0;
+      uBytes = 0;
+      dElapsed = 0.0;
+      for (i = 0; i < iCount; i += iBatch)
+      {
+         iBatch = iCount - i < BATCH_SIZE ? iCount - i : BATCH_SIZE;
+         for (j = 0; j < iBatch; j++)
+         {
+            auLengths[j] = makeKey((enum KeyShape)iShape, i + j, &iNext,
+               aacBatch[j]);
+            uBytes += auLengths[j];
+         }
+         dStart = nowNs();
+         for (j = 0; j < iBatch; j++)
+            puHashes[i + j] = StrHash_hash(aacBatch[j], auLengths[j]);
+         dElapsed += nowNs() - dStart;
+      }
+
+      /* A successful lookup in a chain of c keys compares (c+1)/2
+         keys on average. */
+      uMax = 0;
+      dProbes = 0.0;
+      for (i = 0; i < iCount; i++)
+         puCounts[puHashes[i] & (uBuckets - 1)]++;
+      for (i = 0; (size_t)i < uBuckets; i++)
+      {
+         dProbes += (double)puCounts[i] * (double)(puCounts[i] + 1) / 2;
+         if (puCounts[i] > uMax)
+            uMax = puCounts[i];
+      }
+
+      printf("%-10s %6d %9.1f %8.1f %7.3f %6.3f %8lu\n",
+         apcShapeNames[iShape], iCount,
+         iCount > 0 ? dElapsed / iCount : 0.0,
+         dElapsed > 0.0 ? (double)uBytes / dElapsed * 1e3 : 0.0,
+         iCount > 0 ? dProbes / iCount : 0.0,
+         1.0 + (double)iCount / (double)uBuckets / 2,
+         (unsigned long)uMax);
+
+      free(puHashes);
+      free(puCounts);
+   }
+   fflush(stdout);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run the put, get and free phases of testLargeTable() on
+   iBindingCount bindings, then the put phase again on a table made
+   with SymTable_newWithCapacity(), and write the time, the number
+   of allocations and frees made by the SymTable implementation and
+   the change in bytes it holds, per binding, in each phase to
+   stdout. */
+
+static void benchLargeTable(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 16};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   double dStart;
+   unsigned long ulAllocs;
+   unsigned long ulFrees;
+   long lBytes;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Large table of %d bindings.\n", iBindingCount);
+   printf("phase       ms        allocs     frees  bytes/binding\n");
+   fflush(stdout);
+
+   ulAllocs = ulAllocCount;
+   ulFrees = ulFreeCount;
+   lBytes = lLiveBytes;
+   dStart = nowNs();
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "SymTable_new failed\n");
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (! SymTable_put(oSymTable, acKey, acValue))
+      {
+         fprintf(stderr, "SymTable_put failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   printf("put    %10.3f %12lu %9lu %14.1f\n",
+      (nowNs() - dStart) / 1e6, ulAllocCount - ulAllocs,
+      ulFreeCount - ulFrees,
+      (double)(lLiveBytes - lBytes) / iBindingCount);
+
+   ulAllocs = ulAllocCount;
+   ulFrees = ulFreeCount;
+   lBytes = lLiveBytes;
+   dStart = nowNs();
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (SymTable_get(oSymTable, acKey) != acValue)
+      {
+         fprintf(stderr, "SymTable_get failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   printf("get    %10.3f %12lu %9lu %14.1f\n",
+      (nowNs() - dStart) / 1e6, ulAllocCount - ulAllocs,
+      ulFreeCount - ulFrees,
+      (double)(lLiveBytes - lBytes) / iBindingCount);
+
+   ulAllocs = ulAllocCount;
+   ulFrees = ulFreeCount;
+   lBytes = lLiveBytes;
+   dStart = nowNs();
+   SymTable_free(oSymTable);
+   printf("free   %10.3f %12lu %9lu %14.1f\n",
+      (nowNs() - dStart) / 1e6, ulAllocCount - ulAllocs,
+      ulFreeCount - ulFrees,
+      (double)(lLiveBytes - lBytes) / iBindingCount);
+
+   ulAllocs = ulAllocCount;
+   ulFrees = ulFreeCount;
+   lBytes = lLiveBytes;
+   dStart = nowNs();
+   oSymTable = SymTable_newWithCapacity((size_t)iBindingCount);
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "SymTable_newWithCapacity failed\n");
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (! SymTable_put(oSymTable, acKey, acValue))
+      {
+         fprintf(stderr, "SymTable_put failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   printf("sized  %10.3f %12lu %9lu %14.1f\n",
+      (nowNs() - dStart) / 1e6, ulAllocCount - ulAllocs,
+      ulFreeCount - ulFrees,
+      (double)(lLiveBytes - lBytes) / iBindingCount);
+   SymTable_free(oSymTable);
+   fflush(stdout);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iBindingCount bindings into a SymTable object, then look every
+   key up in a shuffled order, once with SymTable_get() and once with
+   SymTable_getBatch() in batches of BATCH_KEYS, and write the time
+   per lookup of each to stdout. */
+
+static void benchBatch(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 16, BATCH_KEYS = 256};
+
+   SymTable_T oSymTable;
+   char *pcKeys;
+   const char **ppcOrder;
+   void *apvResults[BATCH_KEYS];
+   char acValue[] = "value";
+   double dStart;
+   double dSingleNs;
+   double dBatchNs;
+   size_t uCount;
+   size_t u;
+   int i;
+
+   if (iBindingCount == 0)
+      return;
+   uCount = (size_t)iBindingCount;
+
+   printf("------------------------------------------------------\n");
+   printf("Shuffled lookups of %d keys.\n", iBindingCount);
+   fflush(stdout);
+
+   pcKeys = (char*)malloc(uCount * MAX_KEY_LENGTH);
+   ppcOrder = (const char**)malloc(uCount * sizeof(const char*));
+   oSymTable = SymTable_new();
+   if (pcKeys == NULL || ppcOrder == NULL || oSymTable == NULL)
+   {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pcKeys + (size_t)i * MAX_KEY_LENGTH, "%d", i);
+      ppcOrder[i] = pcKeys + (size_t)i * MAX_KEY_LENGTH;
+      if (! SymTable_put(oSymTable, ppcOrder[i], acValue))
+      {
+         fprintf(stderr, "SymTable_put failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   /* A fixed seed keeps the order the same from run to run. */
+   srand(217);
+   for (u = uCount - 1; u > 0; u--)
+   {
+      size_t uOther = (size_t)rand() % (u + 1);
+      const char *pcTemp = ppcOrder[u];
+      ppcOrder[u] = ppcOrder[uOther];
+      ppcOrder[uOther] = pcTemp;
+   }
+
+   dStart = nowNs();
+   for (u = 0; u < uCount; u++)
+      if (SymTable_get(oSymTable, ppcOrder[u]) != acValue)
+      {
+         fprintf(stderr, "SymTable_get failed\n");
+         exit(EXIT_FAILURE);
+      }
+   dSingleNs = (nowNs() - dStart) / (double)uCount;
+
+   dStart = nowNs();
+   for (u = 0; u < uCount; u += BATCH_KEYS)
+   {
+      size_t uBatch = uCount - u < BATCH_KEYS ? uCount - u : BATCH_KEYS;
+      size_t uResult;
+      SymTable_getBatch(oSymTable, ppcOrder + u, uBatch, apvResults);
+      for (uResult = 0; uResult < uBatch; uResult++)
+         if (apvResults[uResult] != acValue)
+         {
+            fprintf(stderr, "SymTable_getBatch failed\n");
+            exit(EXIT_FAILURE);
+         }
+   }
+   dBatchNs = (nowNs() - dStart) / (double)uCount;
+
+   printf("get       %8.1f ns/lookup\n", dSingleNs);
+   printf("getBatch  %8.1f ns/lookup\n", dBatchNs);
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+   free(ppcOrder);
+   free(pcKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count the binding that pvExtra points to the count of.  pcKey and
+   pvValue are unused. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   (void)pcKey;
+   (void)pvValue;
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iBindingCount bindings into a SymTable object and remove all but
+   one in a hundred, then time a traversal of the sparse table with
+   SymTable_map() and with the iterator, and once more with the
+   iterator after SymTable_compact(), and write the time per binding
+   visited to stdout. */
+
+static void benchTraversal(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 16, ROUNDS = 100};
+
+   SymTable_T oSymTable;
+   struct SymTable_Iter sIter;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   const char *pcKey;
+   void *pvValue;
+   size_t uVisited;
+   size_t uLeft;
+   double dStart;
+   int iRound;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Traversal after removing 99%% of %d bindings.\n",
+      iBindingCount);
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "SymTable_new failed\n");
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (! SymTable_put(oSymTable, acKey, acValue))
+      {
+         fprintf(stderr, "SymTable_put failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   for (i = 0; i < iBindingCount; i++)
+      if (i % 100 != 0)
+      {
+         sprintf(acKey, "%d", i);
+         SymTable_remove(oSymTable, acKey);
+      }
+   uLeft = SymTable_getLength(oSymTable);
+   if (uLeft == 0)
+   {
+      SymTable_free(oSymTable);
+      return;
+   }
+
+   uVisited = 0;
+   dStart = nowNs();
+   for (iRound = 0; iRound < ROUNDS; iRound++)
+      SymTable_map(oSymTable, countBinding, &uVisited);
+   printf("map       %8.1f ns/binding\n",
+      (nowNs() - dStart) / (double)uVisited);
+
+   uVisited = 0;
+   dStart = nowNs();
+   for (iRound = 0; iRound < ROUNDS; iRound++)
+   {
+      SymTable_iterBegin(oSymTable, &sIter);
+      while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+         uVisited++;
+   }
+   printf("iterator  %8.1f ns/binding\n",
+      (nowNs() - dStart) / (double)uVisited);
+   if (uVisited != uLeft * ROUNDS)
+   {
+      fprintf(stderr, "Traversal missed bindings\n");
+      exit(EXIT_FAILURE);
+   }
+
+   dStart = nowNs();
+   if (! SymTable_compact(oSymTable))
+   {
+      fprintf(stderr, "SymTable_compact failed\n");
+      exit(EXIT_FAILURE);
+   }
+   printf("compact   %8.3f ms\n", (nowNs() - dStart) / 1e6);
+
+   uVisited = 0;
+   dStart = nowNs();
+   for (iRound = 0; iRound < ROUNDS; iRound++)
+   {
+      SymTable_iterBegin(oSymTable, &sIter);
+      while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+         uVisited++;
+   }
+   printf("compacted %8.1f ns/binding\n",
+      (nowNs() - dStart) / (double)uVisited);
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Time SymTable_mapPrefix() on a table of iBindingCount bindings with
+   prefixes that each match a few keys, so the time shows whether a
+   query walks the matches or the whole table. */
+
+static void benchPrefix(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 16, QUERIES = 200};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   size_t uVisited = 0;
+   double dStart;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Prefix queries on %d bindings.\n", iBindingCount);
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "SymTable_new failed\n");
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (! SymTable_put(oSymTable, acKey, acValue))
+      {
+         fprintf(stderr, "SymTable_put failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   dStart = nowNs();
+   for (i = 0; i < QUERIES; i++)
+   {
+      sprintf(acKey, "%d", iBindingCount / 100 + i);
+      if (! SymTable_mapPrefix(oSymTable, acKey, countBinding,
+         &uVisited))
+      {
+         fprintf(stderr, "SymTable_mapPrefix failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   printf("prefix    %8.1f us/query, %.1f matches/query\n",
+      (nowNs() - dStart) / 1000.0 / QUERIES,
+      (double)uVisited / QUERIES);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Fill a new SymTable object with iBindingCount bindings four ways:
+   with SymTable_putBatch(), with SymTable_putUnique() one key at a
+   time, with SymTable_bulkLoad() on one thread and with
+   SymTable_bulkLoad() on one thread per processor, and write the time
+   per binding of each to stdout. */
+
+static void benchBulkLoad(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 16, WAYS = 4};
+
+   static const char *apcWays[WAYS] =
+      {"putBatch", "putUnique", "bulk 1", "bulk all"};
+   SymTable_T oSymTable;
+   char *pcKeys;
+   const char **ppcKeys;
+   const void **ppvValues;
+   char acValue[] = "value";
+   double dStart;
+   size_t uCount;
+   size_t uAdded;
+   int iWay;
+   int i;
+
+   if (iBindingCount == 0)
+      return;
+   uCount = (size_t)iBindingCount;
+
+   printf("------------------------------------------------------\n");
+   printf("Loading %d bindings at once.\n", iBindingCount);
+   fflush(stdout);
+
+   pcKeys = (char*)malloc(uCount * MAX_KEY_LENGTH);
+   ppcKeys = (const char**)malloc(uCount * sizeof(const char*));
+   ppvValues = (const void**)malloc(uCount * sizeof(const void*));
+   if (pcKeys == NULL || ppcKeys == NULL || ppvValues == NULL)
+   {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pcKeys + (size_t)i * MAX_KEY_LENGTH, "%d", i);
+      ppcKeys[i] = pcKeys + (size_t)i * MAX_KEY_LENGTH;
+      ppvValues[i] = acValue;
+   }
+
+   for (iWay = 0; iWay < WAYS; iWay++)
+   {
+      oSymTable = SymTable_new();
+      if (oSymTable == NULL)
+      {
+         fprintf(stderr, "SymTable_new failed\n");
+         exit(EXIT_FAILURE);
+      }
+      dStart = nowNs();
+      if (iWay == 0)
+         uAdded = SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount);
+      else if (iWay == 1)
+      {
+         uAdded = 0;
+         while (uAdded < uCount && SymTable_putUnique(oSymTable,
+            ppcKeys[uAdded], ppvValues[uAdded]))
+            uAdded++;
+      }
+      else
+         uAdded = SymTable_bulkLoad(oSymTable, ppcKeys, ppvValues, uCount,
+            iWay == 2 ? 1 : 0);
+      printf("%-9s %8.1f ns/binding\n", apcWays[iWay],
+         (nowNs() - dStart) / (double)uCount);
+      fflush(stdout);
+      if (uAdded != uCount)
+      {
+         fprintf(stderr, "%s failed\n", apcWays[iWay]);
+         exit(EXIT_FAILURE);
+      }
+      SymTable_free(oSymTable);
+   }
+
+   free(ppvValues);
+   free(ppcKeys);
+   free(pcKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put the uCount keys in ppcKeys, each bound to itself, into
+   oSymTable, and write the time of the puts and the bytes the
+   SymTable implementation allocated for them, per binding, to stdout
+   after pcName.  Then look the keys up in the order of ppcOrder and
+   write the time per lookup. */
+
+static void timeBorrowed(SymTable_T oSymTable, const char *pcName,
+   const char **ppcKeys, const char **ppcOrder, size_t uCount)
+{
+   double dStart;
+   double dPutMs;
+   long lBytes;
+   size_t u;
+
+   lBytes = lLiveBytes;
+   dStart = nowNs();
+   for (u = 0; u < uCount; u++)
+      if (! SymTable_put(oSymTable, ppcKeys[u], ppcKeys[u]))
+      {
+         fprintf(stderr, "SymTable_put failed\n");
+         exit(EXIT_FAILURE);
+      }
+   dPutMs = (nowNs() - dStart) / 1e6;
+   lBytes = lLiveBytes - lBytes;
+
+   dStart = nowNs();
+   for (u = 0; u < uCount; u++)
+      if (SymTable_get(oSymTable, ppcOrder[u]) == NULL)
+      {
+         fprintf(stderr, "SymTable_get failed\n");
+         exit(EXIT_FAILURE);
+      }
+   printf("%-9s %10.3f %14.1f %10.1f\n", pcName, dPutMs,
+      (double)lBytes / (double)uCount,
+      (nowNs() - dStart) / (double)uCount);
+   fflush(stdout);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iBindingCount identifier-like keys into a SymTable object that
+   copies them and into one from SymTable_newBorrowed() that is given
+   interned copies of them, then look every key up in a shuffled
+   order, by the caller's key in the first and by the interned pointer
+   in the second, and write the results of each to stdout. */
+
+static void benchBorrowed(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 24};
+
+   SymTable_T oSymTable;
+   Intern_T oIntern;
+   char *pcKeys;
+   const char **ppcKeys;
+   const char **ppcInterned;
+   const char **ppcOrder;
+   long lBytes;
+   size_t uCount;
+   size_t u;
+
+   if (iBindingCount == 0)
+      return;
+   uCount = (size_t)iBindingCount;
+
+   printf("------------------------------------------------------\n");
+   printf("Borrowed keys on %d bindings.\n", iBindingCount);
+   printf("table         put ms  bytes/binding  ns/lookup\n");
+   fflush(stdout);
+
+   pcKeys = (char*)malloc(uCount * MAX_KEY_LENGTH);
+   ppcKeys = (const char**)malloc(uCount * sizeof(const char*));
+   ppcInterned = (const char**)malloc(uCount * sizeof(const char*));
+   ppcOrder = (const char**)malloc(uCount * sizeof(const char*));
+   oIntern = Intern_new();
+   if (pcKeys == NULL || ppcKeys == NULL || ppcInterned == NULL
+      || ppcOrder == NULL || oIntern == NULL)
+   {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+   lBytes = lLiveBytes;
+   for (u = 0; u < uCount; u++)
+   {
+      sprintf(pcKeys + u * MAX_KEY_LENGTH, "ident_%lu", (unsigned long)u);
+      ppcKeys[u] = pcKeys + u * MAX_KEY_LENGTH;
+      ppcInterned[u] = Intern_string(oIntern, ppcKeys[u]);
+      if (ppcInterned[u] == NULL)
+      {
+         fprintf(stderr, "Intern_string failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   lBytes = lLiveBytes - lBytes;
+
+   /* A fixed seed keeps the order the same from run to run. */
+   srand(217);
+   for (u = 0; u < uCount; u++)
+      ppcOrder[u] = ppcKeys[u];
+   for (u = uCount - 1; u > 0; u--)
+   {
+      size_t uOther = (size_t)rand() % (u + 1);
+      const char *pcTemp = ppcOrder[u];
+      ppcOrder[u] = ppcOrder[uOther];
+      ppcOrder[uOther] = pcTemp;
+   }
+
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "SymTable_new failed\n");
+      exit(EXIT_FAILURE);
+   }
+   timeBorrowed(oSymTable, "copied", ppcKeys, ppcOrder, uCount);
+   SymTable_free(oSymTable);
+
+   /* The same order, by interned pointer. */
+   for (u = 0; u < uCount; u++)
+      ppcOrder[u] = Intern_string(oIntern, ppcOrder[u]);
+   oSymTable = SymTable_newBorrowed();
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "SymTable_newBorrowed failed\n");
+      exit(EXIT_FAILURE);
+   }
+   timeBorrowed(oSymTable, "borrowed", ppcInterned, ppcOrder, uCount);
+   SymTable_free(oSymTable);
+
+   printf("the intern pool itself took %.1f bytes/string\n",
+      (double)lBytes / (double)uCount);
+   fflush(stdout);
+
+   Intern_free(oIntern);
+   free(ppcOrder);
+   free(ppcInterned);
+   free(ppcKeys);
+   free(pcKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make as many SymTable objects of each of a spread of sizes as fit in
+   iBindingCount bindings, up to MAX_TABLES of them, and write the bytes
+   the SymTable implementation allocated per table and the time per
+   lookup of every key of every table to stdout, or of one missing key
+   in tables of size 0.  The small sizes show what a table costs before
+   it holds anything much, and the large ones how lookups hold up as it
+   grows. */
+
+static void benchTableSizes(int iBindingCount)
+{
+   enum {MAX_TABLES = 10000, MAX_KEY_LENGTH = 16,
+      MIN_LOOKUPS = 1000000};
+   static const int aiSizes[] = {0, 1, 2, 4, 8, 16, 64, 256, 1024,
+      16384};
+
+   SymTable_T *poTables;
+   char *pcKeys;
+   double dStart;
+   long lBytes;
+   int iKeyCount;
+   int iTables;
+   int iRounds;
+   int iRound;
+   int iSize;
+   int iLookups;
+   int i;
+   int t;
+   int k;
+
+   if (iBindingCount == 0)
+      return;
+
+   printf("------------------------------------------------------\n");
+   printf("Tables of a spread of sizes, up to %d bindings in all.\n",
+      iBindingCount);
+   printf("size     tables  bytes/table  ns/lookup\n");
+   fflush(stdout);
+
+   iKeyCount = aiSizes[sizeof(aiSizes) / sizeof(aiSizes[0]) - 1];
+   if (iKeyCount > iBindingCount)
+      iKeyCount = iBindingCount;
+   pcKeys = (char*)malloc((size_t)iKeyCount * MAX_KEY_LENGTH);
+   poTables = (SymTable_T*)malloc(MAX_TABLES * sizeof(SymTable_T));
+   if (pcKeys == NULL || poTables == NULL)
+   {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (k = 0; k < iKeyCount; k++)
+      sprintf(pcKeys + k * MAX_KEY_LENGTH, "key%d", k);
+
+   for (i = 0; i < (int)(sizeof(aiSizes) / sizeof(aiSizes[0])); i++)
+   {
+      iSize = aiSizes[i];
+      if (iSize > iBindingCount)
+         break;
+      iTables = iSize == 0 ? MAX_TABLES : iBindingCount / iSize;
+      if (iTables > MAX_TABLES)
+         iTables = MAX_TABLES;
+
+      /* Every table holds the same keys, each bound to itself. */
+      lBytes = lLiveBytes;
+      for (t = 0; t < iTables; t++)
+      {
+         poTables[t] = SymTable_new();
+         if (poTables[t] == NULL)
+         {
+            fprintf(stderr, "SymTable_new failed\n");
+            exit(EXIT_FAILURE);
+         }
+         for (k = 0; k < iSize; k++)
+            if (! SymTable_put(poTables[t], pcKeys + k * MAX_KEY_LENGTH,
+               pcKeys + k * MAX_KEY_LENGTH))
+            {
+               fprintf(stderr, "SymTable_put failed\n");
+               exit(EXIT_FAILURE);
+            }
+      }
+      lBytes = lLiveBytes - lBytes;
+
+      /* Enough rounds over every table that the time is measurable.
+         An empty table is asked for the first key, which it lacks. */
+      iLookups = iSize > 0 ? iSize : 1;
+      iRounds = MIN_LOOKUPS / (iTables * iLookups) + 1;
+      dStart = nowNs();
+      for (iRound = 0; iRound < iRounds; iRound++)
+         for (t = 0; t < iTables; t++)
+            for (k = 0; k < iLookups; k++)
+               if ((SymTable_get(poTables[t], pcKeys + k * MAX_KEY_LENGTH)
+                  == NULL) != (iSize == 0))
+               {
+                  fprintf(stderr, "SymTable_get failed\n");
+                  exit(EXIT_FAILURE);
+               }
+      printf("%-8d %6d %12.1f %10.1f\n", iSize, iTables,
+         (double)lBytes / (double)iTables,
+         (nowNs() - dStart) / ((double)iRounds * iTables * iLookups));
+      fflush(stdout);
+
+      for (t = 0; t < iTables; t++)
+         SymTable_free(poTables[t]);
+   }
+
+   free(poTables);
+   free(pcKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make a SymTable object of iBindingCount bindings twice: by putting
+   them one by one and by opening a snapshot of them saved with
+   SymTable_save(), then look every key up in each, and write the time
+   of each step to stdout. */
+
+static void benchSnapshot(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 16};
+
+   static const char acPath[] = "benchsymtable.snapshot";
+   SymTable_T oSymTable;
+   SymTable_T oMapped;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   double dStart;
+   double dPutMs;
+   double dOpenMs;
+   double dGetMs;
+   double dMappedGetMs;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Startup from a snapshot of %d bindings.\n", iBindingCount);
+   fflush(stdout);
+
+   dStart = nowNs();
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "SymTable_new failed\n");
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (! SymTable_put(oSymTable, acKey, acValue))
+      {
+         fprintf(stderr, "SymTable_put failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   dPutMs = (nowNs() - dStart) / 1e6;
+
+   if (! SymTable_save(oSymTable, acPath))
+   {
+      fprintf(stderr, "SymTable_save failed\n");
+      exit(EXIT_FAILURE);
+   }
+   dStart = nowNs();
+   oMapped = SymTable_openMapped(acPath);
+   dOpenMs = (nowNs() - dStart) / 1e6;
+   if (oMapped == NULL)
+   {
+      fprintf(stderr, "SymTable_openMapped failed\n");
+      exit(EXIT_FAILURE);
+   }
+
+   dStart = nowNs();
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (SymTable_get(oSymTable, acKey) != acValue)
+      {
+         fprintf(stderr, "SymTable_get failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   dGetMs = (nowNs() - dStart) / 1e6;
+   dStart = nowNs();
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (SymTable_get(oMapped, acKey) != acValue)
+      {
+         fprintf(stderr, "SymTable_get failed on the snapshot\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   dMappedGetMs = (nowNs() - dStart) / 1e6;
+
+   printf("put all   %10.3f ms\n", dPutMs);
+   printf("open      %10.3f ms\n", dOpenMs);
+   printf("get all   %10.3f ms, %10.3f ms opened\n", dGetMs,
+      dMappedGetMs);
+   fflush(stdout);
+
+   SymTable_free(oMapped);
+   SymTable_free(oSymTable);
+   remove(acPath);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The operations a workload mixes. */
+
+enum Op {OP_GET, OP_PUT, OP_REMOVE, OP_REPLACE, OP_COUNT};
+
+static const char *const apcOpNames[OP_COUNT] =
+   {"get", "put", "remove", "replace"};
+
+/* A Workload is a mix of operations run against a SymTable object
+   that starts out holding iKeyCount bindings, keys 0 to iKeyCount - 1.
+   Gets and replaces draw a key from those, puts and removes draw one
+   from keys 0 to 2 * iKeyCount - 1, so about half of them find their
+   key in the table. */
+
+struct Workload
+{
+   /* Name of the workload on the command line. */
+   const char *pcName;
+   /* What the workload does, for the human-readable report. */
+   const char *pcDescription;
+   /* Percentage of the operations of each kind, summing to 100. */
+   int aiPercent[OP_COUNT];
+   /* Whether gets and replaces draw their keys from a Zipfian
+      distribution instead of uniformly.  The keys are ranked in a
+      random order, so that the hot keys are not simply the first ones
+      put, and the key of rank i is drawn in proportion to
+      1 / (i + 1). */
+   int iZipfian;
+   /* Whether gets look for keys iKeyCount to 2 * iKeyCount - 1, none
+      of which is ever put. */
+   int iMissing;
+   /* Shape of the keys, SHAPE_DECIMAL or SHAPE_LONG. */
+   enum KeyShape eShape;
+   /* Whether the keys are the decimal numbers whose SymTable_hash()
+      has its low COLLIDING_BITS bits clear, so that the keys of a
+      table of at most 2^COLLIDING_BITS buckets all share one, and
+      those of a larger one share a few. */
+   int iColliding;
+   /* Most keys the table starts out with, or 0 if there is no limit
+      other than the bindingcount. */
+   int iMaxKeys;
+};
+
+enum {COLLIDING_BITS = 10};
+
+static const struct Workload asWorkloads[] =
+{
+   {"read", "90% get, 5% put, 5% remove, uniform keys",
+      {90, 5, 5, 0}, 0, 0, SHAPE_DECIMAL, 0, 0},
+   {"write", "20% get, 40% put, 40% remove, uniform keys",
+      {20, 40, 40, 0}, 0, 0, SHAPE_DECIMAL, 0, 0},
+   {"zipf", "95% get, 5% replace, Zipfian keys",
+      {95, 0, 0, 5}, 1, 0, SHAPE_DECIMAL, 0, 0},
+   {"miss", "100% get of keys that were never put",
+      {100, 0, 0, 0}, 0, 1, SHAPE_DECIMAL, 0, 0},
+   {"skewed", "100% get, Zipfian keys, a small table",
+      {100, 0, 0, 0}, 1, 0, SHAPE_DECIMAL, 0, 1000},
+   {"longkey", "90% get, 5% put, 5% remove, 999 byte keys",
+      {90, 5, 5, 0}, 0, 0, SHAPE_LONG, 0, 16384},
+   {"collide", "90% get, 5% put, 5% remove, colliding hashes",
+      {90, 5, 5, 0}, 0, 0, SHAPE_DECIMAL, 1, 4096}
+};
+
+enum {WORKLOAD_COUNT = sizeof(asWorkloads) / sizeof(asWorkloads[0])};
+
+/* Advance the xorshift64* generator whose state is *pulState, which
+   must not be 0, and return its next number. */
+
+static unsigned long long nextRandom(unsigned long long *pulState)
+{
+   *pulState ^= *pulState >> 12;
+   *pulState ^= *pulState << 25;
+   *pulState ^= *pulState >> 27;
+   return *pulState * 2685821657736338717ULL;
+}
+
+/* Return a number drawn uniformly from 0 to iCount - 1 with the
+   generator whose state is *pulState. */
+
+static int drawUniform(unsigned long long *pulState, int iCount)
+{
+   return (int)((nextRandom(pulState) >> 11) % (unsigned)iCount);
+}
+
+/* Return a number from 0 to iCount - 1 drawn with the generator whose
+   state is *pulState from the distribution whose cumulative
+   probabilities are pdCdf[0] to pdCdf[iCount - 1]. */
+
+static int drawFrom(unsigned long long *pulState, const double *pdCdf,
+   int iCount)
+{
+   double dDraw = (double)(nextRandom(pulState) >> 11)
+      / 9007199254740992.0;
+   int iLow = 0;
+   int iHigh = iCount - 1;
+
+   while (iLow < iHigh)
+   {
+      int iMiddle = iLow + (iHigh - iLow) / 2;
+      if (pdCdf[iMiddle] < dDraw)
+         iLow = iMiddle + 1;
+      else
+         iHigh = iMiddle;
+   }
+   return iLow;
+}
+
+/* Write key number i of the workload psWorkload into pcKey, which must
+   have room for LONG_KEY_SIZE bytes, and return its length.  piNumbers
+   maps key numbers to the numbers of colliding keys, and is used only
+   if psWorkload->iColliding. */
+
+static size_t workloadKey(const struct Workload *psWorkload, int i,
+   const int *piNumbers, char *pcKey)
+{
+   if (psWorkload->iColliding)
+      return (size_t)sprintf(pcKey, "%d", piNumbers[i]);
+   return makeKey(psWorkload->eShape, i, NULL, pcKey);
+}
+
+/* Compare the doubles at pv1 and pv2, for qsort(). */
+
+static int compareDoubles(const void *pv1, const void *pv2)
+{
+   double d1 = *(const double *)pv1;
+   double d2 = *(const double *)pv2;
+   return (d1 > d2) - (d1 < d2);
+}
+
+/* Sort the uCount latencies at pdLatencies and return the one at
+   fraction dFraction of the way through them, or 0 if there are
+   none. */
+
+static double percentile(double *pdLatencies, size_t uCount,
+   double dFraction)
+{
+   size_t uIndex;
+
+   if (uCount == 0)
+      return 0.0;
+   qsort(pdLatencies, uCount, sizeof(double), compareDoubles);
+   uIndex = (size_t)(dFraction * (double)uCount);
+   if (uIndex >= uCount)
+      uIndex = uCount - 1;
+   return pdLatencies[uIndex];
+}
+
+/* Return the largest resident set size the process has had so far, in
+   kilobytes, or 0 if it is not known. */
+
+static long peakRssKb(void)
+{
+   struct rusage sUsage;
+   if (getrusage(RUSAGE_SELF, &sUsage) != 0)
+      return 0;
+   return sUsage.ru_maxrss;
+}
+
+/* Write one line of the report on the workload psWorkload run by
+   pcImpl: uCount operations of the kind pcOp, taking dTotalNs in all,
+   with the latencies at pdLatencies.  Write it as "key=value" pairs if
+   iMachine, and as a row of the table benchWorkload() heads
+   otherwise. */
+
+static void reportOp(const struct Workload *psWorkload,
+   const char *pcImpl, int iKeyCount, const char *pcOp,
+   double *pdLatencies, size_t uCount, double dTotalNs,
+   unsigned long ulAllocs, unsigned long ulFrees, long lPeak,
+   int iMachine)
+{
+   double dMops = dTotalNs > 0.0 ? (double)uCount / dTotalNs * 1e3
+      : 0.0;
+   double dP50 = percentile(pdLatencies, uCount, 0.50);
+   double dP99 = percentile(pdLatencies, uCount, 0.99);
+   double dP999 = percentile(pdLatencies, uCount, 0.999);
+
+   if (iMachine)
+      printf("bench impl=%s workload=%s op=%s keys=%d count=%lu "
+         "mops=%.3f p50_ns=%.0f p99_ns=%.0f p999_ns=%.0f "
+         "allocs=%lu frees=%lu peak_heap_bytes=%ld "
+         "peak_rss_kb=%ld\n", pcImpl, psWorkload->pcName, pcOp,
+         iKeyCount, (unsigned long)uCount, dMops, dP50, dP99, dP999,
+         ulAllocs, ulFrees, lPeak, peakRssKb());
+   else
+      printf("%-8s %9lu %9.3f %9.0f %9.0f %9.0f\n", pcOp,
+         (unsigned long)uCount, dMops, dP50, dP99, dP999);
+}
+
+/* Run iOpCount operations of the workload psWorkload against a
+   SymTable object, timing each one, and write to stdout the
+   throughput and the 50th, 99th and 99.9th percentile latency of each
+   kind of operation and of all of them, then the number of
+   allocations and frees the operations made, the most heap the table
+   took while it was filled and worked on, and the largest resident
+   set size of the process so far, and the chain walks and resizes the
+   table counted if it keeps statistics.  The throughput counts only the
+   time spent in SymTable calls, and every latency includes the cost
+   of reading the clock once.  pcImpl names the implementation in the
+   report, which is "key=value" lines if iMachine and a table
+   otherwise. */
+
+static void benchWorkload(const struct Workload *psWorkload,
+   int iOpCount, const char *pcImpl, int iMachine)
+{
+   SymTable_T oSymTable;
+   struct SymTable_Stats sStats;
+   char acKey[LONG_KEY_SIZE];
+   char acValue[] = "value";
+   int iKeyCount = iOpCount;
+   int *piNumbers = NULL;
+   int *piRanked = NULL;
+   double *pdCdf = NULL;
+   double *apdLatencies[OP_COUNT];
+   double *pdAll;
+   size_t auCounts[OP_COUNT];
+   double adTotalNs[OP_COUNT];
+   double dAllNs = 0.0;
+   unsigned long long ulState = 88172645463325252ULL;
+   unsigned long ulAllocs;
+   unsigned long ulFrees;
+   long lBaseBytes;
+   size_t uLength;
+   int iOp;
+   int i;
+
+   if (psWorkload->iMaxKeys > 0 && iKeyCount > psWorkload->iMaxKeys)
+      iKeyCount = psWorkload->iMaxKeys;
+   if (iKeyCount == 0)
+      return;
+
+   if (! iMachine)
+   {
+      printf("------------------------------------------------------\n");
+      printf("Workload %s: %s.\n", psWorkload->pcName,
+         psWorkload->pcDescription);
+      printf("%d operations on a table of %d bindings.\n", iOpCount,
+         iKeyCount);
+      fflush(stdout);
+   }
+
+   /* The buffers of the harness come from __real_malloc() so that
+      they stay out of the counts and the peak heap of the table. */
+   pdAll = (double*)__real_malloc((size_t)iOpCount * sizeof(double));
+   for (iOp = 0; iOp < OP_COUNT; iOp++)
+   {
+      apdLatencies[iOp] = (double*)__real_malloc(
+         (size_t)iOpCount * sizeof(double));
+      auCounts[iOp] = 0;
+      adTotalNs[iOp] = 0.0;
+      if (apdLatencies[iOp] == NULL)
+         pdAll = NULL;
+   }
+   if (psWorkload->iColliding)
+   {
+      int iNumber = 0;
+      piNumbers = (int*)__real_malloc(
+         (size_t)(2 * iKeyCount) * sizeof(int));
+      if (piNumbers != NULL)
+         for (i = 0; i < 2 * iKeyCount; i++)
+         {
+            size_t uMask = ((size_t)1 << COLLIDING_BITS) - 1;
+            do
+               uLength = (size_t)sprintf(acKey, "%d", iNumber++);
+            while ((SymTable_hash(acKey, uLength) & uMask) != 0);
+            piNumbers[i] = iNumber - 1;
+         }
+   }
+   if (psWorkload->iZipfian)
+   {
+      double dSum = 0.0;
+      pdCdf = (double*)__real_malloc((size_t)iKeyCount
+         * sizeof(double));
+      piRanked = (int*)__real_malloc((size_t)iKeyCount * sizeof(int));
+      if (pdCdf != NULL && piRanked != NULL)
+      {
+         for (i = 0; i < iKeyCount; i++)
+         {
+            dSum += 1.0 / (double)(i + 1);
+            pdCdf[i] = dSum;
+         }
+         for (i = 0; i < iKeyCount; i++)
+            pdCdf[i] /= dSum;
+         /* piRanked[i] is the key of rank i, in a shuffled order. */
+         for (i = 0; i < iKeyCount; i++)
+            piRanked[i] = i;
+         for (i = iKeyCount - 1; i > 0; i--)
+         {
+            int j = drawUniform(&ulState, i + 1);
+            int iTemp = piRanked[i];
+            piRanked[i] = piRanked[j];
+            piRanked[j] = iTemp;
+         }
+      }
+   }
+   if (pdAll == NULL || (psWorkload->iColliding && piNumbers == NULL)
+      || (psWorkload->iZipfian && (pdCdf == NULL || piRanked == NULL)))
+   {
+      fprintf(stderr, "Out of memory for workload %s\n",
+         psWorkload->pcName);
+      exit(EXIT_FAILURE);
+   }
+
+   lBaseBytes = lLiveBytes;
+   lPeakBytes = lLiveBytes;
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "SymTable_new failed\n");
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0; i < iKeyCount; i++)
+   {
+      workloadKey(psWorkload, i, piNumbers, acKey);
+      if (! SymTable_put(oSymTable, acKey, acValue))
+      {
+         fprintf(stderr, "SymTable_put failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   ulAllocs = ulAllocCount;
+   ulFrees = ulFreeCount;
+   for (i = 0; i < iOpCount; i++)
+   {
+      int iDraw = drawUniform(&ulState, 100);
+      int iKey;
+      double dStart;
+      double dElapsed;
+
+      for (iOp = 0; iDraw >= psWorkload->aiPercent[iOp]; iOp++)
+         iDraw -= psWorkload->aiPercent[iOp];
+
+      if (iOp == OP_PUT || iOp == OP_REMOVE)
+         iKey = drawUniform(&ulState, 2 * iKeyCount);
+      else if (psWorkload->iMissing)
+         iKey = iKeyCount + drawUniform(&ulState, iKeyCount);
+      else if (psWorkload->iZipfian)
+         iKey = piRanked[drawFrom(&ulState, pdCdf, iKeyCount)];
+      else
+         iKey = drawUniform(&ulState, iKeyCount);
+      workloadKey(psWorkload, iKey, piNumbers, acKey);
+
+      dStart = nowNs();
+      switch (iOp)
+      {
+         case OP_GET:
+            SymTable_get(oSymTable, acKey);
+            break;
+         case OP_PUT:
+            SymTable_put(oSymTable, acKey, acValue);
+            break;
+         case OP_REMOVE:
+            SymTable_remove(oSymTable, acKey);
+            break;
+         default:
+            SymTable_replace(oSymTable, acKey, acValue);
+            break;
+      }
+      dElapsed = nowNs() - dStart;
+
+      apdLatencies[iOp][auCounts[iOp]++] = dElapsed;
+      adTotalNs[iOp] += dElapsed;
+      pdAll[i] = dElapsed;
+      dAllNs += dElapsed;
+   }
+   ulAllocs = ulAllocCount - ulAllocs;
+   ulFrees = ulFreeCount - ulFrees;
+
+   if (! iMachine)
+      printf("%-8s %9s %9s %9s %9s %9s\n", "op", "count", "Mops/s",
+         "p50 ns", "p99 ns", "p99.9 ns");
+   for (iOp = 0; iOp < OP_COUNT; iOp++)
+      if (auCounts[iOp] > 0)
+         reportOp(psWorkload, pcImpl, iKeyCount, apcOpNames[iOp],
+            apdLatencies[iOp], auCounts[iOp], adTotalNs[iOp],
+            ulAllocs, ulFrees, lPeakBytes - lBaseBytes, iMachine);
+   reportOp(psWorkload, pcImpl, iKeyCount, "all", pdAll,
+      (size_t)iOpCount, dAllNs, ulAllocs, ulFrees,
+      lPeakBytes - lBaseBytes, iMachine);
+   if (! iMachine)
+      printf("%lu allocations, %lu frees, peak heap %.1f MB, "
+         "peak RSS %.1f MB\n", ulAllocs, ulFrees,
+         (double)(lPeakBytes - lBaseBytes) / 1e6,
+         (double)peakRssKb() / 1e3);
+   if (! iMachine && SymTable_getStats(oSymTable, &sStats))
+      printf("%.2f bindings looked at per get, %.2f per put, "
+         "%lu resizes taking %.3f ms\n",
+         sStats.gets > 0 ? (double)sStats.getProbes
+            / (double)sStats.gets : 0.0,
+         sStats.puts > 0 ? (double)sStats.putProbes
+            / (double)sStats.puts : 0.0,
+         (unsigned long)sStats.resizes, sStats.resizeSeconds * 1e3);
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+   __real_free(pdCdf);
+   __real_free(piRanked);
+   __real_free(piNumbers);
+   for (iOp = 0; iOp < OP_COUNT; iOp++)
+      __real_free(apdLatencies[iOp]);
+   __real_free(pdAll);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Benchmark the SymTable ADT.  Write the results to stdout.  argv[1]
+   is the number of bindings to put into the SymTable object.  With no
+   other arguments, run every benchmark and then every workload.
+   Otherwise run only the workloads the other arguments name, or all of
+   them for "all", and report them as "key=value" lines if one of the
+   arguments is "-m".  Exit with EXIT_FAILURE if argv[1] is missing or
+   not numeric or a workload is unknown.  Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int aiSelected[WORKLOAD_COUNT];
+   const char *pcImpl;
+   int iBindingCount;
+   int iMachine = 0;
+   int iKnown;
+   int i;
+   int j;
+
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount [-m] [workload ...]\n",
+         argv[0]);
+      fprintf(stderr, "Workloads: all");
+      for (j = 0; j < WORKLOAD_COUNT; j++)
+         fprintf(stderr, " %s", asWorkloads[j].pcName);
+      fprintf(stderr, "\n");
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   for (j = 0; j < WORKLOAD_COUNT; j++)
+      aiSelected[j] = argc == 2;
+   for (i = 2; i < argc; i++)
+   {
+      if (strcmp(argv[i], "-m") == 0)
+      {
+         iMachine = 1;
+         continue;
+      }
+      iKnown = 0;
+      for (j = 0; j < WORKLOAD_COUNT; j++)
+         if (strcmp(argv[i], "all") == 0
+            || strcmp(argv[i], asWorkloads[j].pcName) == 0)
+            aiSelected[j] = iKnown = 1;
+      if (! iKnown)
+      {
+         fprintf(stderr, "Unknown workload %s\n", argv[i]);
+         exit(EXIT_FAILURE);
+      }
+   }
+   /* With only "-m", run every workload. */
+   if (argc == 3 && iMachine)
+      for (j = 0; j < WORKLOAD_COUNT; j++)
+         aiSelected[j] = 1;
+
+   /* Name the implementation after the binary, benchsymtablehash
+      being "hash". */
+   pcImpl = strrchr(argv[0], '/') != NULL ? strrchr(argv[0], '/') + 1
+      : argv[0];
+   if (strncmp(pcImpl, "benchsymtable", 13) == 0 && pcImpl[13] != '\0')
+      pcImpl += 13;
+
+   if (argc == 2)
+   {
+      benchResizePauses(iBindingCount);
+      benchLargeTable(iBindingCount);
+      benchHashFunction(iBindingCount);
+      benchBatch(iBindingCount);
+      benchTraversal(iBindingCount);
+      benchPrefix(iBindingCount);
+      benchBulkLoad(iBindingCount);
+      benchSnapshot(iBindingCount);
+      benchBorrowed(iBindingCount);
+      benchTableSizes(iBindingCount);
+   }
+   for (j = 0; j < WORKLOAD_COUNT; j++)
+      if (aiSelected[j])
+         benchWorkload(&asWorkloads[j], iBindingCount, pcImpl,
+            iMachine);
+
+   if (iMachine)
+      return 0;
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
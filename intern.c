@@ -0,0 +1,77 @@
+/*--------------------------------------------------------------------*/
+/* intern.c                                                           */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+/*The pool is a SymTable that borrows its keys, with each copy bound to
+itself, so a copy is both the key and the value and is stored once.
+It is written only against symtable.h and links with every
+implementation.*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+#include "symtable.h"
+#include "arena.h"
+
+/*An Intern is the table that finds the copies and the arena that
+holds them*/
+struct Intern {
+  /*table binds each copy to itself, borrowing it as the key*/
+  SymTable_T table;
+  /*arena holds every copy, so they can be freed all at once*/
+  Arena_T arena;
+};
+
+Intern_T Intern_new(void){
+  Intern_T intern;
+
+  intern = (Intern_T) malloc(sizeof(struct Intern));
+  if(intern == NULL) return NULL;
+  intern->table = SymTable_newBorrowed();
+  intern->arena = Arena_new();
+  if(intern->table == NULL || intern->arena == NULL){
+    if(intern->table != NULL) SymTable_free(intern->table);
+    if(intern->arena != NULL) Arena_free(intern->arena);
+    free(intern);
+    return NULL;
+  }
+  return intern;
+}
+
+void Intern_free(Intern_T oIntern){
+  assert(oIntern != NULL);
+
+  SymTable_free(oIntern->table);
+  Arena_free(oIntern->arena);
+  free(oIntern);
+}
+
+const char *Intern_string(Intern_T oIntern, const char *pcString){
+  size_t length;
+  size_t hash;
+  char *copy;
+
+  assert(oIntern != NULL);
+  assert(pcString != NULL);
+
+  /*the string is hashed once for both the lookup and the put*/
+  length = strlen(pcString);
+  hash = SymTable_hash(pcString, length);
+  copy = (char *) SymTable_getHashed(oIntern->table, pcString, length,
+    hash);
+  if(copy != NULL) return copy;
+
+  /*the lookup just missed, so the put need not look for the string
+  again*/
+  copy = (char *) Arena_alloc(oIntern->arena, sizeof(char) * (length + 1));
+  if(copy == NULL) return NULL;
+  memcpy(copy, pcString, sizeof(char) * (length + 1));
+  if(!SymTable_putUniqueHashed(oIntern->table, copy, length, hash,
+    copy)){
+    Arena_release(oIntern->arena, copy, sizeof(char) * (length + 1));
+    return NULL;
+  }
+  return copy;
+}
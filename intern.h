@@ -0,0 +1,30 @@
+/*--------------------------------------------------------------------*/
+/* intern.h                                                           */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef INTERN_H
+#define INTERN_H
+
+/*Intern_T is a pointer to an Intern, a pool of strings that holds one
+copy of each distinct string for as long as the pool lives. Two
+strings interned in one pool are equal exactly when their pointers
+are, so they make good keys for a SymTable from SymTable_newBorrowed.
+Like a SymTable, an Intern may only be used by one thread at a
+time.*/
+typedef struct Intern* Intern_T;
+
+/*Intern_new creates and returns a new Intern holding no strings, or
+returns NULL if insufficient memory is available.*/
+Intern_T Intern_new(void);
+
+/*Intern_free frees oIntern and every string in it. Pointers returned
+by Intern_string are no longer valid afterwards.*/
+void Intern_free(Intern_T oIntern);
+
+/*Intern_string returns the copy in oIntern of the string pcString,
+adding one first if oIntern has none, or returns NULL if insufficient
+memory is available. The copy must not be changed.*/
+const char *Intern_string(Intern_T oIntern, const char *pcString);
+
+#endif
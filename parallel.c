@@ -0,0 +1,91 @@
+/*--------------------------------------------------------------------*/
+/* parallel.c                                                         */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+/*A Part is the argument of the thread running one part*/
+struct Part {
+  /*work is the function every part runs*/
+  void (*work)(size_t uPart, size_t uParts, void *pvExtra);
+  /*extra is passed to work*/
+  void *extra;
+  /*index is the number of this part*/
+  size_t index;
+  /*count is the number of parts*/
+  size_t count;
+};
+
+/*Runs the Part at pvPart. Its signature is the one pthread_create
+takes.*/
+static void *Parallel_start(void *pvPart);
+
+size_t Parallel_parts(size_t uThreads, size_t uCount, size_t uMinPerPart){
+  size_t parts = uThreads;
+
+  if(parts == 0){
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    parts = processors > 0 ? (size_t) processors : 1;
+  }
+  if(uMinPerPart > 0 && parts > uCount / uMinPerPart)
+    parts = uCount / uMinPerPart;
+  if(parts > PARALLEL_MAX_PARTS) parts = PARALLEL_MAX_PARTS;
+  if(parts == 0) parts = 1;
+  return parts;
+}
+
+void Parallel_run(size_t uParts,
+  void (*pfWork)(size_t uPart, size_t uParts, void *pvExtra),
+  void *pvExtra){
+
+  pthread_t threads[PARALLEL_MAX_PARTS];
+  struct Part parts[PARALLEL_MAX_PARTS];
+  int started[PARALLEL_MAX_PARTS];
+  size_t i;
+
+  assert(pfWork != NULL);
+  assert(uParts >= 1 && uParts <= PARALLEL_MAX_PARTS);
+
+  for(i = 1; i < uParts; i++){
+    parts[i].work = pfWork;
+    parts[i].extra = pvExtra;
+    parts[i].index = i;
+    parts[i].count = uParts;
+    started[i] = pthread_create(&threads[i], NULL, Parallel_start,
+      &parts[i]) == 0;
+  }
+
+  (*pfWork)(0, uParts, pvExtra);
+  /*parts without a thread run here, after part 0, while the threads
+  that did start keep going*/
+  for(i = 1; i < uParts; i++)
+    if(!started[i]) (*pfWork)(i, uParts, pvExtra);
+  for(i = 1; i < uParts; i++)
+    if(started[i]) pthread_join(threads[i], NULL);
+}
+
+size_t Parallel_begin(size_t uCount, size_t uPart, size_t uParts){
+  assert(uParts > 0);
+  assert(uPart <= uParts);
+
+  /*the first uCount % uParts parts get one item more than the rest.
+  Written this way uCount * uPart is never formed, so it cannot
+  overflow*/
+  return uCount / uParts * uPart
+    + (uPart < uCount % uParts ? uPart : uCount % uParts);
+}
+
+static void *Parallel_start(void *pvPart){
+  struct Part *part = (struct Part *) pvPart;
+
+  assert(part != NULL);
+
+  (*part->work)(part->index, part->count, part->extra);
+  return NULL;
+}
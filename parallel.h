@@ -0,0 +1,35 @@
+/*--------------------------------------------------------------------*/
+/* parallel.h                                                         */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+/*PARALLEL_MAX_PARTS is the most parts one call of Parallel_run takes*/
+enum { PARALLEL_MAX_PARTS = 64 };
+
+/*Parallel_parts returns how many parts to split uCount items into for
+up to uThreads threads, or one per processor online if uThreads is 0.
+No part is given fewer than uMinPerPart items, so small jobs stay on
+one thread, and the result is between 1 and PARALLEL_MAX_PARTS.*/
+size_t Parallel_parts(size_t uThreads, size_t uCount, size_t uMinPerPart);
+
+/*Parallel_run calls (*pfWork)(uPart, uParts, pvExtra) once for each
+uPart from 0 to uParts - 1, each on a thread of its own except part 0,
+which runs on the calling thread, and returns once every call has
+returned. A part whose thread cannot be created runs on the calling
+thread instead, so the work is always done. uParts is between 1 and
+PARALLEL_MAX_PARTS.*/
+void Parallel_run(size_t uParts,
+  void (*pfWork)(size_t uPart, size_t uParts, void *pvExtra),
+  void *pvExtra);
+
+/*Parallel_begin returns the first of uCount items that part uPart of
+uParts covers. Part uPart covers the items from Parallel_begin(uCount,
+uPart, uParts) up to Parallel_begin(uCount, uPart + 1, uParts).*/
+size_t Parallel_begin(size_t uCount, size_t uPart, size_t uParts);
+
+#endif
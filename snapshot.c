@@ -0,0 +1,401 @@
+/*--------------------------------------------------------------------*/
+/* snapshot.c                                                         */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "snapshot.h"
+#include "strhash.h"
+
+/*MAGIC_SIZE is the size of the magic string at the start of a file*/
+enum { MAGIC_SIZE = 8 };
+
+/*MAGIC starts every snapshot and names its format version*/
+static const char MAGIC[MAGIC_SIZE] = {'S','Y','M','S','N','A','P','1'};
+
+/*ORDER_MARK is stored as a size_t. A reader with another byte order
+or another size of size_t reads it back as a different number*/
+#define ORDER_MARK ((size_t) 0x0A0B0C00 | sizeof(size_t))
+
+/*HASH_PROBE is hashed into the header, so that a reader built with
+another hash function refuses the file instead of missing every key*/
+#define HASH_PROBE "snapshot"
+
+/*A Header is the start of a snapshot file. The bucket starts, the
+entries and the keys follow it in that order, each right after the
+last*/
+struct Header {
+  /*magic is MAGIC*/
+  char magic[MAGIC_SIZE];
+  /*mark is ORDER_MARK*/
+  size_t mark;
+  /*hashProbe is the hash of HASH_PROBE*/
+  size_t hashProbe;
+  /*count is number of bindings*/
+  size_t count;
+  /*bucketsNum is number of buckets, a power of two*/
+  size_t bucketsNum;
+  /*keysSize is number of bytes of packed keys*/
+  size_t keysSize;
+};
+
+/*An Entry is one binding of a snapshot. The entries of bucket b are
+those from starts[b] up to starts[b + 1]*/
+struct Entry {
+  /*hash is the full hash of the key*/
+  size_t hash;
+  /*key is the offset of the key from the start of the keys*/
+  size_t key;
+  /*value holds the bits of the value*/
+  size_t value;
+};
+
+/*A Snapshot is a mapped snapshot file and pointers to its parts*/
+struct Snapshot {
+  /*map is the address the file is mapped at and mapSize its size*/
+  void *map;
+  size_t mapSize;
+  /*header, starts, entries and keys point into the mapping*/
+  const struct Header *header;
+  const size_t *starts;
+  const struct Entry *entries;
+  const char *keys;
+};
+
+/*A Pending is a binding added to a SnapshotWriter*/
+struct Pending {
+  /*hash is the hash of key*/
+  size_t hash;
+  /*key is the caller's key, not a copy, and length its length*/
+  const char *key;
+  size_t length;
+  /*value is the value of the binding*/
+  void *value;
+};
+
+/*A SnapshotWriter is the bindings added so far*/
+struct SnapshotWriter {
+  /*pending is an array of count bindings with room for capacity*/
+  struct Pending *pending;
+  size_t count;
+  size_t capacity;
+  /*keysSize is the size the packed keys will take*/
+  size_t keysSize;
+  /*failed is 1 (TRUE) once an add has failed*/
+  int failed;
+};
+
+/*Returns the size of a snapshot file of uCount bindings in uBucketsNum
+buckets with uKeysSize bytes of keys, or 0 if that size overflows.*/
+static size_t Snapshot_fileSize(size_t uCount, size_t uBucketsNum,
+  size_t uKeysSize);
+
+/*Writes the snapshot of the bindings of oWriter to the stream psFile,
+placing each in one of uBucketsNum buckets. Returns 1 (TRUE) on
+success, or 0 (FALSE) if insufficient memory is available or a write
+fails.*/
+static int SnapshotWriter_write(SnapshotWriter_T oWriter,
+  size_t uBucketsNum, FILE *psFile);
+
+SnapshotWriter_T SnapshotWriter_new(size_t uCount){
+  SnapshotWriter_T writer;
+
+  writer = (SnapshotWriter_T) malloc(sizeof(struct SnapshotWriter));
+  if(writer == NULL) return NULL;
+  writer->capacity = uCount > 0 ? uCount : 1;
+  if(writer->capacity > ((size_t) -1) / sizeof(struct Pending)){
+    free(writer);
+    return NULL;
+  }
+  writer->pending = (struct Pending *) malloc(writer->capacity
+    * sizeof(struct Pending));
+  if(writer->pending == NULL){
+    free(writer);
+    return NULL;
+  }
+  writer->count = 0;
+  writer->keysSize = 0;
+  writer->failed = 0;
+  return writer;
+}
+
+void SnapshotWriter_add(const char *pcKey, void *pvValue,
+  void *pvWriter){
+  SnapshotWriter_T writer = (SnapshotWriter_T) pvWriter;
+  struct Pending *pending;
+
+  assert(pcKey != NULL);
+  assert(writer != NULL);
+
+  if(writer->failed) return;
+  /*the count given to SnapshotWriter_new was only a hint*/
+  if(writer->count == writer->capacity){
+    struct Pending *grown = NULL;
+    if(writer->capacity <= ((size_t) -1) / 2 / sizeof(struct Pending))
+      grown = (struct Pending *) realloc(writer->pending,
+        2 * writer->capacity * sizeof(struct Pending));
+    if(grown == NULL){
+      writer->failed = 1;
+      return;
+    }
+    writer->pending = grown;
+    writer->capacity *= 2;
+  }
+
+  pending = &writer->pending[writer->count];
+  pending->key = pcKey;
+  pending->length = strlen(pcKey);
+  pending->hash = StrHash_hash(pcKey, pending->length);
+  pending->value = pvValue;
+  if(pending->length + 1 > ((size_t) -1) - writer->keysSize){
+    writer->failed = 1;
+    return;
+  }
+  writer->keysSize += pending->length + 1;
+  writer->count += 1;
+}
+
+int SnapshotWriter_finish(SnapshotWriter_T oWriter, const char *pcPath){
+  static const char suffix[] = ".tmp";
+  size_t bucketsNum = 1;
+  char *tempPath;
+  FILE *file;
+  int result;
+
+  assert(oWriter != NULL);
+  assert(pcPath != NULL);
+
+  /*at most one binding per bucket on average, as in symtablehash.c*/
+  while(bucketsNum < oWriter->count && bucketsNum <= ((size_t) -1) / 4)
+    bucketsNum *= 2;
+
+  result = !oWriter->failed && Snapshot_fileSize(oWriter->count,
+    bucketsNum, oWriter->keysSize) != 0;
+  tempPath = result ? (char *) malloc(strlen(pcPath) + sizeof(suffix))
+    : NULL;
+  if(tempPath == NULL){
+    free(oWriter->pending);
+    free(oWriter);
+    return 0;
+  }
+  strcpy(tempPath, pcPath);
+  strcat(tempPath, suffix);
+
+  /*the file is written in full under another name and then renamed,
+  so no reader ever maps a half written snapshot, and one that has
+  the old file mapped keeps its pages*/
+  file = fopen(tempPath, "wb");
+  if(file == NULL) result = 0;
+  else{
+    result = SnapshotWriter_write(oWriter, bucketsNum, file);
+    if(fclose(file) != 0) result = 0;
+    if(result && rename(tempPath, pcPath) != 0) result = 0;
+    if(!result) (void) remove(tempPath);
+  }
+
+  free(tempPath);
+  free(oWriter->pending);
+  free(oWriter);
+  return result;
+}
+
+Snapshot_T Snapshot_open(const char *pcPath){
+  Snapshot_T snapshot;
+  const struct Header *header;
+  struct stat status;
+  void *map;
+  size_t size;
+  int fd;
+
+  assert(pcPath != NULL);
+
+  fd = open(pcPath, O_RDONLY);
+  if(fd < 0) return NULL;
+  if(fstat(fd, &status) != 0 || status.st_size < 0
+  || (size_t) status.st_size < sizeof(struct Header)){
+    (void) close(fd);
+    return NULL;
+  }
+  size = (size_t) status.st_size;
+  /*the mapping outlives the descriptor*/
+  map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  (void) close(fd);
+  if(map == MAP_FAILED) return NULL;
+
+  /*only the header and the ends of the arrays are checked, so that
+  opening costs the same at any size. The entries themselves are
+  trusted*/
+  header = (const struct Header *) map;
+  snapshot = (Snapshot_T) malloc(sizeof(struct Snapshot));
+  if(snapshot == NULL
+  || memcmp(header->magic, MAGIC, MAGIC_SIZE) != 0
+  || header->mark != ORDER_MARK
+  || header->hashProbe != StrHash_hash(HASH_PROBE, strlen(HASH_PROBE))
+  || header->bucketsNum == 0
+  || (header->bucketsNum & (header->bucketsNum - 1)) != 0
+  || Snapshot_fileSize(header->count, header->bucketsNum,
+    header->keysSize) != size){
+    free(snapshot);
+    (void) munmap(map, size);
+    return NULL;
+  }
+
+  snapshot->map = map;
+  snapshot->mapSize = size;
+  snapshot->header = header;
+  snapshot->starts = (const size_t *) (header + 1);
+  snapshot->entries = (const struct Entry *)
+    (snapshot->starts + header->bucketsNum + 1);
+  snapshot->keys = (const char *) (snapshot->entries + header->count);
+  if(snapshot->starts[header->bucketsNum] != header->count
+  || (header->keysSize > 0
+    && snapshot->keys[header->keysSize - 1] != '\0')){
+    Snapshot_close(snapshot);
+    return NULL;
+  }
+  return snapshot;
+}
+
+void Snapshot_close(Snapshot_T oSnapshot){
+  assert(oSnapshot != NULL);
+
+  (void) munmap(oSnapshot->map, oSnapshot->mapSize);
+  free(oSnapshot);
+}
+
+size_t Snapshot_getLength(Snapshot_T oSnapshot){
+  assert(oSnapshot != NULL);
+  return oSnapshot->header->count;
+}
+
+size_t Snapshot_find(Snapshot_T oSnapshot, const char *pcKey,
+  size_t uLength, size_t uHash){
+  size_t bucket;
+  size_t end;
+  size_t i;
+
+  assert(oSnapshot != NULL);
+  assert(pcKey != NULL);
+
+  /*the entries of a bucket are next to each other, so a lookup reads
+  one start, one run of entries and the matching key*/
+  bucket = uHash & (oSnapshot->header->bucketsNum - 1);
+  end = oSnapshot->starts[bucket + 1];
+  for(i = oSnapshot->starts[bucket]; i < end; i++){
+    const char *key;
+    if(oSnapshot->entries[i].hash != uHash) continue;
+    key = oSnapshot->keys + oSnapshot->entries[i].key;
+    /*strncmp stops at the end of key, so a shorter key is never read
+    past its '\0'*/
+    if(strncmp(key, pcKey, uLength) == 0 && key[uLength] == '\0')
+      return i;
+  }
+  return oSnapshot->header->count;
+}
+
+const char *Snapshot_key(Snapshot_T oSnapshot, size_t uIndex){
+  assert(oSnapshot != NULL);
+  assert(uIndex < oSnapshot->header->count);
+  return oSnapshot->keys + oSnapshot->entries[uIndex].key;
+}
+
+size_t Snapshot_hash(Snapshot_T oSnapshot, size_t uIndex){
+  assert(oSnapshot != NULL);
+  assert(uIndex < oSnapshot->header->count);
+  return oSnapshot->entries[uIndex].hash;
+}
+
+void *Snapshot_value(Snapshot_T oSnapshot, size_t uIndex){
+  assert(oSnapshot != NULL);
+  assert(uIndex < oSnapshot->header->count);
+  return (void *) (uintptr_t) oSnapshot->entries[uIndex].value;
+}
+
+static size_t Snapshot_fileSize(size_t uCount, size_t uBucketsNum,
+  size_t uKeysSize){
+  size_t size = sizeof(struct Header);
+  size_t max = (size_t) -1;
+
+  if(uBucketsNum >= max / sizeof(size_t)) return 0;
+  size += (uBucketsNum + 1) * sizeof(size_t);
+  if(uCount > (max - size) / sizeof(struct Entry)) return 0;
+  size += uCount * sizeof(struct Entry);
+  if(uKeysSize > max - size) return 0;
+  return size + uKeysSize;
+}
+
+static int SnapshotWriter_write(SnapshotWriter_T oWriter,
+  size_t uBucketsNum, FILE *psFile){
+  struct Header header;
+  struct Entry *entries;
+  size_t *starts;
+  size_t *next;
+  size_t offset = 0;
+  size_t i;
+  int result = 1;
+
+  assert(oWriter != NULL);
+  assert(psFile != NULL);
+
+  starts = (size_t *) calloc(uBucketsNum + 1, sizeof(size_t));
+  next = (size_t *) malloc(uBucketsNum * sizeof(size_t));
+  entries = (struct Entry *) malloc((oWriter->count > 0
+    ? oWriter->count : 1) * sizeof(struct Entry));
+  if(starts == NULL || next == NULL || entries == NULL){
+    free(starts);
+    free(next);
+    free(entries);
+    return 0;
+  }
+
+  /*a counting sort of the bindings by bucket. Keys are packed in the
+  order they were added*/
+  for(i = 0; i < oWriter->count; i++)
+    starts[(oWriter->pending[i].hash & (uBucketsNum - 1)) + 1] += 1;
+  for(i = 0; i < uBucketsNum; i++){
+    starts[i + 1] += starts[i];
+    next[i] = starts[i];
+  }
+  for(i = 0; i < oWriter->count; i++){
+    struct Pending *pending = &oWriter->pending[i];
+    struct Entry *entry =
+      &entries[next[pending->hash & (uBucketsNum - 1)]++];
+    entry->hash = pending->hash;
+    entry->key = offset;
+    entry->value = (size_t) (uintptr_t) pending->value;
+    offset += pending->length + 1;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAGIC, MAGIC_SIZE);
+  header.mark = ORDER_MARK;
+  header.hashProbe = StrHash_hash(HASH_PROBE, strlen(HASH_PROBE));
+  header.count = oWriter->count;
+  header.bucketsNum = uBucketsNum;
+  header.keysSize = oWriter->keysSize;
+
+  if(fwrite(&header, sizeof(header), 1, psFile) != 1
+  || fwrite(starts, sizeof(size_t), uBucketsNum + 1, psFile)
+    != uBucketsNum + 1
+  || fwrite(entries, sizeof(struct Entry), oWriter->count, psFile)
+    != oWriter->count) result = 0;
+  for(i = 0; result && i < oWriter->count; i++)
+    if(fwrite(oWriter->pending[i].key, sizeof(char),
+      oWriter->pending[i].length + 1, psFile)
+      != oWriter->pending[i].length + 1) result = 0;
+
+  free(starts);
+  free(next);
+  free(entries);
+  return result;
+}
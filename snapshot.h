@@ -0,0 +1,81 @@
+/*--------------------------------------------------------------------*/
+/* snapshot.h                                                         */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+
+/*A snapshot is a read-only image of a set of bindings in one file,
+made to be mapped into memory and searched where it lies. It holds a
+header, an array of bucket starts, an array of entries grouped by
+bucket, each with a hash, a key offset and the bits of a value, and
+the '\0' terminated keys packed one after the other. Every position in
+it is an offset from the start of the file, so it reads the same at
+any address, and processes that map one file share its pages. A file
+is only read back on a machine with the same size_t, byte order and
+hash function as the one that wrote it.*/
+
+/*Snapshot_T is a pointer to a Snapshot, a file image mapped for
+reading.*/
+typedef struct Snapshot* Snapshot_T;
+
+/*SnapshotWriter_T is a pointer to a SnapshotWriter, which collects
+bindings and writes them out as a snapshot.*/
+typedef struct SnapshotWriter* SnapshotWriter_T;
+
+/*SnapshotWriter_new creates and returns a SnapshotWriter expecting
+about uCount bindings, or returns NULL if insufficient memory is
+available.*/
+SnapshotWriter_T SnapshotWriter_new(size_t uCount);
+
+/*SnapshotWriter_add adds the binding of pcKey and pvValue to the
+SnapshotWriter pvWriter. Its parameters are those of the pfApply of
+SymTable_map, so a table can be added with one call to SymTable_map.
+The key is not copied and must stay as it is until
+SnapshotWriter_finish. A failure is remembered and reported by
+SnapshotWriter_finish.*/
+void SnapshotWriter_add(const char *pcKey, void *pvValue,
+  void *pvWriter);
+
+/*SnapshotWriter_finish writes the bindings of oWriter to the file
+pcPath and frees oWriter. The snapshot is written next to pcPath and
+then renamed over it, so processes that have the old file mapped keep
+seeing the old bindings. Returns 1 (TRUE) on success, or 0 (FALSE) if
+an add failed, insufficient memory is available or the file could not
+be written.*/
+int SnapshotWriter_finish(SnapshotWriter_T oWriter, const char *pcPath);
+
+/*Snapshot_open maps the snapshot in the file pcPath and returns it, or
+returns NULL if the file cannot be mapped or is not a snapshot this
+machine can read.*/
+Snapshot_T Snapshot_open(const char *pcPath);
+
+/*Snapshot_close unmaps oSnapshot and frees it. Keys passed out by it
+are no longer valid afterwards.*/
+void Snapshot_close(Snapshot_T oSnapshot);
+
+/*Snapshot_getLength returns the number of bindings in oSnapshot.*/
+size_t Snapshot_getLength(Snapshot_T oSnapshot);
+
+/*Snapshot_find returns the index of the binding of oSnapshot whose key
+is the uLength bytes at pcKey with hash uHash, or
+Snapshot_getLength(oSnapshot) if there is none.*/
+size_t Snapshot_find(Snapshot_T oSnapshot, const char *pcKey,
+  size_t uLength, size_t uHash);
+
+/*Snapshot_key returns the key of the binding at uIndex of oSnapshot,
+which points into the mapped file.*/
+const char *Snapshot_key(Snapshot_T oSnapshot, size_t uIndex);
+
+/*Snapshot_hash returns the hash of the key of the binding at uIndex of
+oSnapshot.*/
+size_t Snapshot_hash(Snapshot_T oSnapshot, size_t uIndex);
+
+/*Snapshot_value returns the value of the binding at uIndex of
+oSnapshot, with the bits it was written with.*/
+void *Snapshot_value(Snapshot_T oSnapshot, size_t uIndex);
+
+#endif
@@ -0,0 +1,523 @@
+/*--------------------------------------------------------------------*/
+/* stresssymtable.c                                                   */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "symtable.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*--------------------------------------------------------------------*/
+
+/* This program shares one SymTable object between threads, so it is
+   only linked with implementations that are safe to share, such as
+   symtableconc.c. */
+
+#define ASSURE(i) assure(i, __LINE__)
+
+enum {MAX_THREADS = 64, MAX_KEY_LENGTH = 24};
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the current time of the monotonic clock in nanoseconds. */
+
+static double nowNs(void)
+{
+   struct timespec sTime;
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (double)sTime.tv_sec * 1e9 + (double)sTime.tv_nsec;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Advance the xorshift state *puState and return the new state. Each
+   thread has its own state, so no locking is needed. */
+
+static unsigned long nextRandom(unsigned long *puState)
+{
+   unsigned long u = *puState;
+   u ^= u << 13;
+   u ^= u >> 7;
+   u ^= u << 17;
+   *puState = u;
+   return u;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Number of stable bindings, which are put before the threads start
+   and never change, and of bindings each thread puts and removes in
+   each round of the stress test. */
+
+enum {STABLE_COUNT = 2000, OWN_COUNT = 5000, ROUNDS = 4};
+
+/* The value of stable binding i is &acStable[i], and the value of a
+   binding that thread t owns is &acOwned[t] or &acReplaced[t]. */
+
+static char acStable[STABLE_COUNT];
+static char acOwned[MAX_THREADS];
+static char acReplaced[MAX_THREADS];
+
+/* The arguments and results of one thread of the stress test. */
+
+struct StressArgs
+{
+   SymTable_T oSymTable;
+   int iId;
+   int iThreadCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Check that stable key iIndex is in the table with its value, and
+   that a key that another thread may own at the moment has either no
+   binding or one of the values that thread gives it. */
+
+static void checkOthers(SymTable_T oSymTable, int iIndex, int iOther)
+{
+   char acKey[MAX_KEY_LENGTH];
+   void *pvValue;
+
+   sprintf(acKey, "stable%d", iIndex);
+   ASSURE(SymTable_get(oSymTable, acKey) == &acStable[iIndex]);
+   ASSURE(SymTable_contains(oSymTable, acKey));
+
+   sprintf(acKey, "own%d.%d", iOther, iIndex);
+   pvValue = SymTable_get(oSymTable, acKey);
+   ASSURE(pvValue == NULL || pvValue == &acOwned[iOther]
+      || pvValue == &acReplaced[iOther]);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run one thread of the stress test. In each round the thread puts
+   its own keys, replaces half and removes them all, checking every
+   result, while looking up stable keys and the keys of the next
+   thread. pvArgs is a struct StressArgs. */
+
+static void *stressWorker(void *pvArgs)
+{
+   struct StressArgs *psArgs = (struct StressArgs*)pvArgs;
+   SymTable_T oSymTable = psArgs->oSymTable;
+   int iId = psArgs->iId;
+   int iOther = (iId + 1) % psArgs->iThreadCount;
+   char acKey[MAX_KEY_LENGTH];
+   int iRound;
+   int i;
+
+   for (iRound = 0; iRound < ROUNDS; iRound++)
+   {
+      for (i = 0; i < OWN_COUNT; i++)
+      {
+         sprintf(acKey, "own%d.%d", iId, i);
+         ASSURE(SymTable_put(oSymTable, acKey, &acOwned[iId]));
+         ASSURE(! SymTable_put(oSymTable, acKey, &acOwned[iId]));
+         ASSURE(SymTable_get(oSymTable, acKey) == &acOwned[iId]);
+         checkOthers(oSymTable, i % STABLE_COUNT, iOther);
+      }
+      for (i = 0; i < OWN_COUNT; i += 2)
+      {
+         sprintf(acKey, "own%d.%d", iId, i);
+         ASSURE(SymTable_replace(oSymTable, acKey, &acReplaced[iId])
+            == &acOwned[iId]);
+         checkOthers(oSymTable, i % STABLE_COUNT, iOther);
+      }
+      for (i = 0; i < OWN_COUNT; i++)
+      {
+         sprintf(acKey, "own%d.%d", iId, i);
+         ASSURE(SymTable_remove(oSymTable, acKey) == (i % 2 == 0
+            ? &acReplaced[iId] : &acOwned[iId]));
+         ASSURE(! SymTable_contains(oSymTable, acKey));
+         checkOthers(oSymTable, i % STABLE_COUNT, iOther);
+      }
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count the binding with key pcKey in the size_t that pvExtra points
+   to. pvValue is unused. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   (void)pcKey;
+   (void)pvValue;
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that iThreadCount threads can put, replace, remove and look up
+   bindings in one SymTable object at once, through several resizes,
+   without losing or corrupting any binding. */
+
+static void testStress(int iThreadCount)
+{
+   SymTable_T oSymTable;
+   pthread_t aThreads[MAX_THREADS];
+   struct StressArgs asArgs[MAX_THREADS];
+   char acKey[MAX_KEY_LENGTH];
+   size_t uCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing %d threads sharing a table.\n", iThreadCount);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < STABLE_COUNT; i++)
+   {
+      sprintf(acKey, "stable%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, &acStable[i]));
+   }
+
+   for (i = 0; i < iThreadCount; i++)
+   {
+      asArgs[i].oSymTable = oSymTable;
+      asArgs[i].iId = i;
+      asArgs[i].iThreadCount = iThreadCount;
+      ASSURE(pthread_create(&aThreads[i], NULL, stressWorker,
+         &asArgs[i]) == 0);
+   }
+   for (i = 0; i < iThreadCount; i++)
+      ASSURE(pthread_join(aThreads[i], NULL) == 0);
+
+   /* Only the stable bindings are left, each with its value. */
+   ASSURE(SymTable_getLength(oSymTable) == STABLE_COUNT);
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == STABLE_COUNT);
+   for (i = 0; i < STABLE_COUNT; i++)
+   {
+      sprintf(acKey, "stable%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == &acStable[i]);
+   }
+   ASSURE(SymTable_compact(oSymTable));
+   ASSURE(SymTable_getLength(oSymTable) == STABLE_COUNT);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Number of bindings in the table of the scaling benchmark, and of
+   operations each thread runs on it. */
+
+enum {BENCH_KEYS = 100000, BENCH_OPS = 400000};
+
+/* The keys of the scaling benchmark, formatted once ahead of time so
+   that the benchmark times only the SymTable. */
+
+static char aacBenchKeys[BENCH_KEYS][MAX_KEY_LENGTH];
+
+/* The arguments of one thread of the scaling benchmark. */
+
+struct BenchArgs
+{
+   SymTable_T oSymTable;
+   int iId;
+   int iWritePercent;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Run BENCH_OPS operations of one benchmark thread. iWritePercent of
+   them put or remove a key of the thread's own, half each, and the
+   rest get a random key. pvArgs is a struct BenchArgs. */
+
+static void *benchWorker(void *pvArgs)
+{
+   struct BenchArgs *psArgs = (struct BenchArgs*)pvArgs;
+   char acKey[MAX_KEY_LENGTH];
+   unsigned long uState = (unsigned long)psArgs->iId * 2654435761UL + 1;
+   unsigned long uRandom;
+   int iOwned = 0;
+   int i;
+
+   for (i = 0; i < BENCH_OPS; i++)
+   {
+      uRandom = nextRandom(&uState);
+      if ((int)(uRandom % 100) >= psArgs->iWritePercent)
+         (void)SymTable_get(psArgs->oSymTable,
+            aacBenchKeys[(uRandom >> 8) % BENCH_KEYS]);
+      else if (iOwned == 0 || (uRandom & 256) != 0)
+      {
+         sprintf(acKey, "w%d.%d", psArgs->iId, iOwned++);
+         (void)SymTable_put(psArgs->oSymTable, acKey, psArgs);
+      }
+      else
+      {
+         sprintf(acKey, "w%d.%d", psArgs->iId, --iOwned);
+         (void)SymTable_remove(psArgs->oSymTable, acKey);
+      }
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the throughput of iThreadCount threads, each running
+   BENCH_OPS operations with iWritePercent writes, on a table of
+   BENCH_KEYS bindings. Return the operations per microsecond. */
+
+static double benchRun(int iThreadCount, int iWritePercent)
+{
+   SymTable_T oSymTable;
+   pthread_t aThreads[MAX_THREADS];
+   struct BenchArgs asArgs[MAX_THREADS];
+   double dStart;
+   double dElapsed;
+   int i;
+
+   oSymTable = SymTable_newWithCapacity(BENCH_KEYS);
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "SymTable_newWithCapacity failed\n");
+      exit(EXIT_FAILURE);
+   }
+   for (i = 0; i < BENCH_KEYS; i++)
+      if (! SymTable_put(oSymTable, aacBenchKeys[i], aacBenchKeys[i]))
+      {
+         fprintf(stderr, "SymTable_put failed\n");
+         exit(EXIT_FAILURE);
+      }
+
+   dStart = nowNs();
+   for (i = 0; i < iThreadCount; i++)
+   {
+      asArgs[i].oSymTable = oSymTable;
+      asArgs[i].iId = i;
+      asArgs[i].iWritePercent = iWritePercent;
+      if (pthread_create(&aThreads[i], NULL, benchWorker, &asArgs[i])
+         != 0)
+      {
+         fprintf(stderr, "pthread_create failed\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   for (i = 0; i < iThreadCount; i++)
+      pthread_join(aThreads[i], NULL);
+   dElapsed = nowNs() - dStart;
+
+   SymTable_free(oSymTable);
+   return (double)BENCH_OPS * iThreadCount / (dElapsed / 1000.0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write to stdout the throughput of 1, 2, 4, ... and iMaxThreads
+   threads sharing one table, for a read only load and for loads with
+   some writes, along with the speedup over one thread. */
+
+static void benchScaling(int iMaxThreads)
+{
+   static const int aiWritePercents[] = {0, 10, 50};
+   enum {LOADS = sizeof(aiWritePercents) / sizeof(aiWritePercents[0])};
+   double adSingle[LOADS];
+   double dThroughput;
+   int iThreads;
+   int iLoad;
+
+   printf("------------------------------------------------------\n");
+   printf("Throughput of threads sharing %d bindings.\n", BENCH_KEYS);
+   printf("threads  writes  ops/us  speedup\n");
+   fflush(stdout);
+
+   for (iThreads = 1; iThreads <= iMaxThreads;
+      iThreads = (iThreads * 2 > iMaxThreads && iThreads < iMaxThreads)
+         ? iMaxThreads : iThreads * 2)
+   {
+      for (iLoad = 0; iLoad < LOADS; iLoad++)
+      {
+         dThroughput = benchRun(iThreads, aiWritePercents[iLoad]);
+         if (iThreads == 1)
+            adSingle[iLoad] = dThroughput;
+         printf("%7d  %5d%%  %6.2f  %6.2fx\n", iThreads,
+            aiWritePercents[iLoad], dThroughput,
+            dThroughput / adSingle[iLoad]);
+         fflush(stdout);
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The phases of the large table benchmark. */
+
+enum Phase {PHASE_PUT, PHASE_GET, PHASE_REMOVE};
+
+/* The arguments of one thread of the large table benchmark. */
+
+struct LargeArgs
+{
+   SymTable_T oSymTable;
+   int iId;
+   int iThreadCount;
+   enum Phase ePhase;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Run phase psArgs->ePhase of the large table benchmark on the keys
+   i of aacBenchKeys with i % iThreadCount == iId. pvArgs is a struct
+   LargeArgs. */
+
+static void *largeWorker(void *pvArgs)
+{
+   struct LargeArgs *psArgs = (struct LargeArgs*)pvArgs;
+   int iSuccessful = 1;
+   int i;
+
+   for (i = psArgs->iId; i < BENCH_KEYS; i += psArgs->iThreadCount)
+   {
+      if (psArgs->ePhase == PHASE_PUT)
+         iSuccessful = SymTable_put(psArgs->oSymTable, aacBenchKeys[i],
+            aacBenchKeys[i]);
+      else if (psArgs->ePhase == PHASE_GET)
+         iSuccessful = SymTable_get(psArgs->oSymTable, aacBenchKeys[i])
+            == aacBenchKeys[i];
+      else
+         iSuccessful = SymTable_remove(psArgs->oSymTable,
+            aacBenchKeys[i]) == aacBenchKeys[i];
+      if (! iSuccessful)
+      {
+         fprintf(stderr, "Large table phase %d failed\n",
+            (int)psArgs->ePhase);
+         exit(EXIT_FAILURE);
+      }
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run the workload of testLargeTable in testsymtable.c, putting,
+   getting and removing BENCH_KEYS bindings in a table that starts
+   empty, with the keys split over 1, 2, 4, ... and iMaxThreads
+   threads. Write the time of each phase to stdout. */
+
+static void benchLargeTable(int iMaxThreads)
+{
+   SymTable_T oSymTable;
+   pthread_t aThreads[MAX_THREADS];
+   struct LargeArgs asArgs[MAX_THREADS];
+   double adMs[PHASE_REMOVE + 1];
+   double dStart;
+   int iThreads;
+   int iPhase;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Large table of %d bindings split over threads.\n",
+      BENCH_KEYS);
+   printf("threads   put ms   get ms  remove ms\n");
+   fflush(stdout);
+
+   for (iThreads = 1; iThreads <= iMaxThreads;
+      iThreads = (iThreads * 2 > iMaxThreads && iThreads < iMaxThreads)
+         ? iMaxThreads : iThreads * 2)
+   {
+      oSymTable = SymTable_new();
+      if (oSymTable == NULL)
+      {
+         fprintf(stderr, "SymTable_new failed\n");
+         exit(EXIT_FAILURE);
+      }
+      for (iPhase = PHASE_PUT; iPhase <= PHASE_REMOVE; iPhase++)
+      {
+         dStart = nowNs();
+         for (i = 0; i < iThreads; i++)
+         {
+            asArgs[i].oSymTable = oSymTable;
+            asArgs[i].iId = i;
+            asArgs[i].iThreadCount = iThreads;
+            asArgs[i].ePhase = (enum Phase)iPhase;
+            if (pthread_create(&aThreads[i], NULL, largeWorker,
+               &asArgs[i]) != 0)
+            {
+               fprintf(stderr, "pthread_create failed\n");
+               exit(EXIT_FAILURE);
+            }
+         }
+         for (i = 0; i < iThreads; i++)
+            pthread_join(aThreads[i], NULL);
+         adMs[iPhase] = (nowNs() - dStart) / 1e6;
+      }
+      if (SymTable_getLength(oSymTable) != 0)
+      {
+         fprintf(stderr, "Large table not empty after removes\n");
+         exit(EXIT_FAILURE);
+      }
+      SymTable_free(oSymTable);
+      printf("%7d  %7.2f  %7.2f  %9.2f\n", iThreads, adMs[PHASE_PUT],
+         adMs[PHASE_GET], adMs[PHASE_REMOVE]);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Stress test and benchmark a SymTable implementation that threads
+   can share. argv[1], if given, is the most threads to use, which is
+   otherwise the number of processors online. As always, return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iThreads;
+   long lProcessors;
+   int i;
+
+   if (argc > 2)
+   {
+      fprintf(stderr, "Usage: %s [threads]\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+   if (argc == 2)
+      iThreads = atoi(argv[1]);
+   else
+   {
+      lProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+      iThreads = lProcessors < 1 ? 1 : (int)lProcessors;
+   }
+   if (iThreads < 1 || iThreads > MAX_THREADS)
+   {
+      fprintf(stderr, "threads must be from 1 to %d\n", MAX_THREADS);
+      exit(EXIT_FAILURE);
+   }
+
+   /* Two threads at least, so that the test always shares the
+      table. */
+   testStress(iThreads < 2 ? 2 : iThreads);
+   for (i = 0; i < BENCH_KEYS; i++)
+      sprintf(aacBenchKeys[i], "%d", i);
+   benchScaling(iThreads);
+   benchLargeTable(iThreads);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
@@ -0,0 +1,156 @@
+/*--------------------------------------------------------------------*/
+/* strhash.c                                                          */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include "strhash.h"
+
+#if defined(STRHASH_USE_POLY)
+
+const char *StrHash_name(void){
+  return "poly65599";
+}
+
+size_t StrHash_hash(const char *pcKey, size_t uLength){
+  const size_t HASH_MULTIPLIER = 65599;
+  size_t u;
+  size_t uHash = 0;
+
+  assert(pcKey != NULL);
+
+  for(u = 0; u < uLength; u++)
+    uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+  /*mixes high bits into the low bits that a mask keeps*/
+  uHash ^= uHash >> (sizeof(size_t) * 4);
+  uHash *= (size_t) 0x9E3779B97F4A7C15ULL;
+  uHash ^= uHash >> (sizeof(size_t) * 4);
+  return uHash;
+}
+
+#elif defined(STRHASH_USE_FNV1A)
+
+const char *StrHash_name(void){
+  return "fnv1a";
+}
+
+size_t StrHash_hash(const char *pcKey, size_t uLength){
+  uint64_t uHash = 0xCBF29CE484222325ULL;
+  size_t u;
+
+  assert(pcKey != NULL);
+
+  for(u = 0; u < uLength; u++){
+    uHash ^= (unsigned char) pcKey[u];
+    uHash *= 0x100000001B3ULL;
+  }
+  /*FNV-1a leaves its low bits weak for short keys, so they get the
+  high bits folded in*/
+  uHash ^= uHash >> 32;
+  return (size_t) uHash;
+}
+
+#else
+
+/*secrets of the wyhash style function, odd 64 bit constants with
+well spread bits*/
+static const uint64_t SECRET0 = 0xA0761D6478BD642FULL;
+static const uint64_t SECRET1 = 0xE7037ED1A0B428DBULL;
+static const uint64_t SECRET2 = 0x8EBC6AF09C88C6E3ULL;
+
+/*Returns the high and low halves of the 128 bit product of uA and uB
+xored together.*/
+static uint64_t StrHash_mum(uint64_t uA, uint64_t uB);
+
+/*Returns the 8 bytes at pcBytes as a 64 bit integer. pcBytes does not
+need to be aligned.*/
+static uint64_t StrHash_read64(const unsigned char *pcBytes);
+
+/*Returns the 4 bytes at pcBytes as a 32 bit integer. pcBytes does not
+need to be aligned.*/
+static uint64_t StrHash_read32(const unsigned char *pcBytes);
+
+const char *StrHash_name(void){
+  return "wyhash";
+}
+
+size_t StrHash_hash(const char *pcKey, size_t uLength){
+  const unsigned char *bytes = (const unsigned char *) pcKey;
+  uint64_t seed = SECRET0;
+  uint64_t a;
+  uint64_t b;
+  size_t left = uLength;
+
+  assert(pcKey != NULL);
+
+  /*16 bytes per step, each step one multiply that depends on the
+  previous one*/
+  while(left > 16){
+    seed = StrHash_mum(StrHash_read64(bytes) ^ SECRET1,
+      StrHash_read64(bytes + 8) ^ seed);
+    bytes += 16;
+    left -= 16;
+  }
+
+  /*the last 1 to 16 bytes are read as two words that may overlap, so
+  no byte loop is needed*/
+  if(left > 8){
+    a = StrHash_read64(bytes);
+    b = StrHash_read64(bytes + left - 8);
+  }
+  else if(left >= 4){
+    a = StrHash_read32(bytes);
+    b = StrHash_read32(bytes + left - 4);
+  }
+  else if(left > 0){
+    a = ((uint64_t) bytes[0] << 16) | ((uint64_t) bytes[left >> 1] << 8)
+      | (uint64_t) bytes[left - 1];
+    b = 0;
+  }
+  else {
+    a = 0;
+    b = 0;
+  }
+
+  return (size_t) StrHash_mum(SECRET1 ^ (uint64_t) uLength,
+    StrHash_mum(a ^ SECRET2, b ^ seed));
+}
+
+static uint64_t StrHash_mum(uint64_t uA, uint64_t uB){
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 uint128;
+  uint128 product = (uint128) uA * uB;
+  return (uint64_t) product ^ (uint64_t) (product >> 64);
+#else
+  /*schoolbook multiply of 32 bit halves when there is no 128 bit
+  type*/
+  uint64_t aHigh = uA >> 32, aLow = uA & 0xFFFFFFFFULL;
+  uint64_t bHigh = uB >> 32, bLow = uB & 0xFFFFFFFFULL;
+  uint64_t lowLow = aLow * bLow;
+  uint64_t highLow = aHigh * bLow;
+  uint64_t lowHigh = aLow * bHigh;
+  uint64_t highHigh = aHigh * bHigh;
+  uint64_t middle = (lowLow >> 32) + (highLow & 0xFFFFFFFFULL) + lowHigh;
+  uint64_t low = (middle << 32) | (lowLow & 0xFFFFFFFFULL);
+  uint64_t high = highHigh + (highLow >> 32) + (middle >> 32);
+  return low ^ high;
+#endif
+}
+
+static uint64_t StrHash_read64(const unsigned char *pcBytes){
+  uint64_t word;
+  /*memcpy compiles to a single unaligned load*/
+  memcpy(&word, pcBytes, sizeof(word));
+  return word;
+}
+
+static uint64_t StrHash_read32(const unsigned char *pcBytes){
+  uint32_t word;
+  memcpy(&word, pcBytes, sizeof(word));
+  return word;
+}
+
+#endif
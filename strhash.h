@@ -0,0 +1,27 @@
+/*--------------------------------------------------------------------*/
+/* strhash.h                                                          */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef STRHASH_H
+#define STRHASH_H
+
+#include <stddef.h>
+
+/*The hash function is chosen when strhash.c is compiled:
+  -DSTRHASH_USE_POLY   the byte at a time multiply by 65599 from the
+                       assignment, with a final mix
+  -DSTRHASH_USE_FNV1A  64 bit FNV-1a, also byte at a time
+  (neither)            a wyhash style function that reads 8 bytes at a
+                       time and mixes with 64x64->128 bit multiplies
+All three return a full size_t hash whose low bits are well mixed, so
+callers reduce it to a bucket with a power of two mask.*/
+
+/*StrHash_hash returns the hash of the uLength bytes starting at pcKey.
+The bytes do not need to be '\0' terminated.*/
+size_t StrHash_hash(const char *pcKey, size_t uLength);
+
+/*StrHash_name returns the name of the hash function compiled in.*/
+const char *StrHash_name(void);
+
+#endif
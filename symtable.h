@@ -11,10 +11,37 @@
 /*Symtable_T is a pointer to a Symtable*/
 typedef struct SymTable* SymTable_T;
 
+/*A SymTable may only be used by one thread at a time, except with the
+symtableconc.c implementation, which lists what threads may do at once
+at its top.*/
+
 /*SymTable_new creates and returns a new SymTable object that contains 
 no bindings, or returns NULL if insufficient memory is available.*/
 SymTable_T SymTable_new(void);
 
+/*SymTable_newWithCapacity is SymTable_new for a table expected to hold
+uCapacity bindings. The table starts big enough that putting that many
+bindings does not resize it, and does not shrink below that size. It
+returns NULL if insufficient memory is available.*/
+SymTable_T SymTable_newWithCapacity(size_t uCapacity);
+
+/*SymTable_newBorrowed is SymTable_new for a table that borrows its
+keys instead of copying them. It keeps the very key pointers passed to
+SymTable_put, SymTable_putUnique, their Hashed forms, SymTable_putBatch
+and SymTable_bulkLoad, and passes them back out from SymTable_map and
+SymTable_iterNext, so each key must be '\0' terminated and stay
+unchanged at its address until its binding is removed or the table is
+freed. Keys from an intern pool (see intern.h) live that long, and a
+lookup by the same pointer that was put then matches without comparing
+the key. It returns NULL if insufficient memory is available.*/
+SymTable_T SymTable_newBorrowed(void);
+
+/*SymTable_reserve grows oSymTable, if needed, so that it holds
+uCapacity bindings without resizing, and keeps it from shrinking below
+that size. Returns 1 (TRUE) on success, or 0 (FALSE) if insufficient
+memory is available, in which case oSymTable is unchanged.*/
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity);
+
 /*SymTable_free frees all memory occupied by oSymTable.*/
 void SymTable_free(SymTable_T oSymTable);
 
@@ -29,6 +56,16 @@ is available*/
 int SymTable_put(SymTable_T oSymTable,
   const char *pcKey, const void *pvValue);
 
+/*SymTable_putUnique is SymTable_put for a caller that guarantees no
+binding with key pcKey is in oSymTable, such as one filling a new table
+from keys known to be distinct. It skips the search for such a binding
+where the implementation can, which makes it take constant time in
+symtablelist.c. Putting a key that is already there breaks the table.
+Returns 1 (TRUE) on success, or 0 (FALSE) if insufficient memory is
+available.*/
+int SymTable_putUnique(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue);
+
 /*SymTable_replace searches for a binding with a key matching pcKey in 
 oSymtable and replaces the binding's value with pvValue and returns the
 old value. If oSymTable does not contain a matching binding it leaves
@@ -51,9 +88,213 @@ unchanged and returns NULL.*/
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey);
 
 /*SymTable_map applys function *pfApply to each binding in oSymTable,
-passing pvExtra as a parameter.*/
+passing pvExtra as a parameter. The key passed to *pfApply belongs to
+oSymTable and may move when a binding is put or removed, so it is only
+valid until oSymTable is next changed.*/
 void SymTable_map(SymTable_T oSymTable,
   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
   const void *pvExtra);
 
+/*SymTable_mapParallel applies *pfApply to each binding of oSymTable
+once, as SymTable_map does, but may split the bindings over up to
+uThreads threads, or one per processor online if uThreads is 0. The
+bindings are visited in no particular order and *pfApply may run on
+several threads at once, so it must be safe to call that way, and it
+must not change oSymTable. Implementations with no cheap way to split
+their bindings visit them all on the calling thread.*/
+void SymTable_mapParallel(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra, size_t uThreads);
+
+/*SymTable_mapRange applies *pfApply to each binding of oSymTable whose
+key is at or above pcLow and below pcHigh in strcmp order, in ascending
+key order, passing pvExtra as a parameter. A NULL pcLow or pcHigh
+leaves that end of the range open. Returns 1 (TRUE), or 0 (FALSE)
+without applying *pfApply if insufficient memory is available: an
+ordered implementation walks only the range, while the others sort the
+matching bindings in temporary storage first.*/
+int SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+  const char *pcHigh,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra);
+
+/*SymTable_mapPrefix is SymTable_mapRange for the bindings whose key
+starts with pcPrefix.*/
+int SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra);
+
+/*The functions below take a key as its length uLength and its hash
+uHash instead of a '\0' terminated string, so callers that already know
+them (a tokenizer, or a loop looking one key up in several tables) do
+not pay for strlen or hashing again. pcKey points to uLength bytes that
+need not be '\0' terminated but must not contain '\0', and uHash must
+be SymTable_hash(pcKey, uLength). Otherwise each behaves as the
+function without the Hashed suffix.*/
+
+/*SymTable_hash returns the hash of the uLength bytes at pcKey. Every
+SymTable implementation uses the same hash, so the result can be passed
+to any table.*/
+size_t SymTable_hash(const char *pcKey, size_t uLength);
+
+/*SymTable_putHashed is SymTable_put for a key of known length and
+hash.*/
+int SymTable_putHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue);
+
+/*SymTable_putUniqueHashed is SymTable_putUnique for a key of known
+length and hash.*/
+int SymTable_putUniqueHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue);
+
+/*SymTable_replaceHashed is SymTable_replace for a key of known length
+and hash.*/
+void *SymTable_replaceHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue);
+
+/*SymTable_containsHashed is SymTable_contains for a key of known length
+and hash.*/
+int SymTable_containsHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash);
+
+/*SymTable_getHashed is SymTable_get for a key of known length and
+hash.*/
+void *SymTable_getHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash);
+
+/*SymTable_removeHashed is SymTable_remove for a key of known length and
+hash.*/
+void *SymTable_removeHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash);
+
+/*SymTable_getBatch looks up each of the uCount keys in ppcKeys in
+oSymTable and stores the value of its binding at the same index of
+ppvValues, or NULL if no binding exists. The result is the same as
+calling SymTable_get on each key, but the lookups are independent, so
+an implementation may hash the whole batch first and overlap the
+memory accesses of the different keys.*/
+void SymTable_getBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  size_t uCount, void **ppvValues);
+
+/*SymTable_putBatch calls SymTable_put with ppcKeys[i] and ppvValues[i]
+for each i from 0 to uCount - 1 in order, overlapping memory accesses
+as SymTable_getBatch does. Returns the number of bindings added, which
+is less than uCount if a key was already in oSymTable, appeared earlier
+in the batch, or insufficient memory was available.*/
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount);
+
+/*SymTable_bulkLoad adds the uCount bindings of ppcKeys and ppvValues to
+oSymTable with the same result as SymTable_putBatch, so of a key that
+repeats only the first binding is added. It grows oSymTable once for
+all of them and may split the work over up to uThreads threads, or one
+per processor online if uThreads is 0, which makes it the fast way to
+fill a table with many bindings at once. Returns the number of
+bindings added.*/
+size_t SymTable_bulkLoad(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount, size_t uThreads);
+
+/*A SymTable_Iter is a cursor over the bindings of one SymTable. It is
+declared here only so that callers can keep one on the stack without
+an allocation; its fields belong to the SymTable implementation and
+must not be used directly.*/
+struct SymTable_Iter {
+  /*table is the SymTable being traversed*/
+  SymTable_T table;
+  /*position is the next node to visit, in implementations with nodes*/
+  void *position;
+  /*index is the next slot to visit, in implementations with slots*/
+  size_t index;
+};
+
+/*SymTable_iterBegin sets psIter to the start of a traversal of the
+bindings of oSymTable. oSymTable must not be changed by anything but
+SymTable_replace until the traversal ends. A self-organizing list (see
+symtablelist.c) is changed by SymTable_get as well.*/
+void SymTable_iterBegin(SymTable_T oSymTable,
+  struct SymTable_Iter *psIter);
+
+/*SymTable_iterNext stores the key and value of the next binding of the
+traversal psIter in *ppcKey and *ppvValue, advances psIter and returns
+1 (TRUE). It returns 0 (FALSE) and leaves *ppcKey and *ppvValue
+unchanged once every binding has been visited. Each binding is visited
+exactly once, in the same order as SymTable_map. The key stored in
+*ppcKey is valid as long as a key passed out by SymTable_map.*/
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+  void **ppvValue);
+
+/*SymTable_compact shrinks the memory oSymTable holds to what its
+current bindings need, which matters after many removes. Capacity
+reserved earlier is given up. The keys are copied into new storage, so
+key pointers passed out earlier by SymTable_map or SymTable_iterNext
+are no longer valid afterwards; values are untouched. Returns 1 (TRUE)
+on success, or 0 (FALSE) if insufficient memory is available, in which
+case oSymTable is unchanged.*/
+int SymTable_compact(SymTable_T oSymTable);
+
+/*SymTable_save writes the bindings of oSymTable to the file pcPath as
+a snapshot, a read-only image made to be mapped back into memory by
+SymTable_openMapped (see snapshot.h). The file is replaced as a whole,
+so a process that has the old one mapped is not disturbed. Values are
+written as the bits of their pointers, so they only mean the same in
+another process if they are not addresses, such as small integers cast
+to void *, or NULL. Returns 1 (TRUE) on success, or 0 (FALSE) if
+insufficient memory is available or the file cannot be written.*/
+int SymTable_save(SymTable_T oSymTable, const char *pcPath);
+
+/*SymTable_openMapped returns a SymTable holding the bindings saved in
+the file pcPath by SymTable_save, or NULL if the file cannot be read as
+a snapshot or insufficient memory is available. The symtablehash.c
+implementation maps the file and looks keys up where they lie, so
+opening takes the same time at any size and processes that open one
+file share its pages. Its table is read-only: SymTable_put and the
+other functions that add bindings return 0 (FALSE), and
+SymTable_replace and SymTable_remove return NULL, without changing it.
+The other implementations read the file into an ordinary table.*/
+SymTable_T SymTable_openMapped(const char *pcPath);
+
+/*SYMTABLE_STATS_CHAINS is number of chain lengths SymTable_getStats
+counts buckets by. It is a macro, not an enum, so that symtablerename.h can
+include this header twice*/
+#define SYMTABLE_STATS_CHAINS 8
+
+/*A SymTable_Stats is what SymTable_getStats reports about one table.
+Every count is since the table was created.*/
+struct SymTable_Stats {
+  /*chains[i] is number of buckets holding i bindings. The last one
+  also counts every bucket holding more*/
+  size_t chains[SYMTABLE_STATS_CHAINS];
+  /*gets is number of keys looked up by SymTable_get,
+  SymTable_getHashed and SymTable_getBatch, of which hits were found and
+  misses were not*/
+  size_t gets;
+  size_t hits;
+  size_t misses;
+  /*getProbes is number of bindings those lookups looked at*/
+  size_t getProbes;
+  /*puts is number of keys put by SymTable_put, SymTable_putHashed and
+  SymTable_putBatch, new or not, and putProbes is number of bindings
+  they looked at to check that the key was new*/
+  size_t puts;
+  size_t putProbes;
+  /*resizes is number of times the bucket array was grown or shrunk,
+  and resizeSeconds is the time spent allocating new arrays and moving
+  bindings into them*/
+  size_t resizes;
+  double resizeSeconds;
+  /*bytes is number of bytes of memory the table holds*/
+  size_t bytes;
+};
+
+/*SymTable_getStats stores statistics of oSymTable in *psStats and
+returns 1 (TRUE), or returns 0 (FALSE), leaving *psStats unchanged, if
+the implementation keeps none. Only symtablehash.c, symtableshard.c
+through it, and symtablelist.c, whose list is one chain, keep
+statistics, and only when compiled with SYMTABLE_STATS defined (make
+STATSFLAGS=-DSYMTABLE_STATS), so that other builds pay nothing for
+counting. Lookups in a table opened by SymTable_openMapped
+are not counted.*/
+int SymTable_getStats(SymTable_T oSymTable,
+  struct SymTable_Stats *psStats);
+
 #endif
\ No newline at end of file
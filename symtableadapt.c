@@ -0,0 +1,632 @@
+/*--------------------------------------------------------------------*/
+/* symtableadapt.c                                                    */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+/*A SymTable that changes its layout with its size, for programs with
+many tiny tables and a few huge ones. Up to SMALL_MAX bindings are kept
+in an array inside the SymTable itself and found by comparing hashes
+from one end to the other, so a small table is one allocation of a few
+hundred bytes, with no buckets. The put that would go past SMALL_MAX
+moves every binding into a flat table of symtableflat.c (see
+symtablerename.h), and from then on each function passes its call on
+to that table. Only SymTable_compact moves the bindings back into the
+array, once few enough are left, so a size that hovers around
+SMALL_MAX does not convert the table back and forth.
+
+There is no chained hash stage between the two. An empty hash table
+of symtablehash.c is cheap, but its first put allocates its 512
+buckets, 4 KiB, which is twice the 64 Slots a flat table starts with,
+and its lookups are slower than the flat table's at every size.*/
+
+#define SYMTABLE_PREFIX AdaptFlat_
+#include "symtablerename.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtable.h"
+#include "strhash.h"
+
+/*SMALL_MAX is the most bindings the array inside a SymTable holds*/
+enum { SMALL_MAX = 8 };
+
+/*KEY_AREA is number of bytes of an Entry that hold its key. A key of
+at most INLINE_MAX bytes is stored there with its '\0', and a longer
+one is malloced and the area holds a pointer to it. A table that
+borrows its keys holds the caller's pointer there instead. The last
+byte of the area is the tag that tells which. The layout is the one of
+the Slots of symtableflat.c*/
+enum { KEY_AREA = 16, INLINE_MAX = KEY_AREA - 2 };
+
+/*the values of the tag byte of an Entry*/
+enum { TAG_INLINE = 1, TAG_HEAP = 2, TAG_BORROWED = 3 };
+
+/*An Entry is one binding of the small array*/
+struct Entry {
+  /*full hash of key, compared before the key bytes are touched*/
+  size_t hash;
+  /*value of Entry*/
+  const void *value;
+  /*key of Entry: the key itself in bytes if the tag
+  bytes[KEY_AREA - 1] is TAG_INLINE, or a pointer in heap to a
+  malloced copy if it is TAG_HEAP or to the caller's key if it is
+  TAG_BORROWED*/
+  union {
+    char bytes[KEY_AREA];
+    char *heap;
+  } key;
+};
+
+/*A SymTable is its small array until it outgrows it, and a flat table
+after that*/
+struct SymTable {
+  /*large is the flat table holding every binding once the table has
+  outgrown entries, or NULL before that*/
+  AdaptFlat_T large;
+  /*size is number of bindings in entries while large is NULL*/
+  size_t size;
+  /*borrowed is 1 (TRUE) if the table keeps the caller's key pointers
+  instead of copying the keys*/
+  int borrowed;
+  /*entries are the bindings while large is NULL, in the order they
+  were put except where a remove moved the last one into a hole*/
+  struct Entry entries[SMALL_MAX];
+};
+
+/*Returns the tag of the Entry at psEntry.*/
+static int SymTable_tag(const struct Entry *psEntry);
+
+/*Returns the key of the Entry at psEntry.*/
+static const char *SymTable_key(const struct Entry *psEntry);
+
+/*Stores the uLength byte key pcKey in the Entry at psEntry, copying it
+unless iBorrowed is 1 (TRUE). Returns 1 (TRUE) on success, or 0 (FALSE)
+if insufficient memory is available.*/
+static int SymTable_setKey(struct Entry *psEntry, const char *pcKey,
+  size_t uLength, int iBorrowed);
+
+/*Returns the Entry of the small array of oSymTable holding the uLength
+byte key pcKey with hash uHash, or NULL if there is none.*/
+static struct Entry *SymTable_find(SymTable_T oSymTable,
+  const char *pcKey, size_t uLength, size_t uHash);
+
+/*Moves the bindings of the small array of oSymTable into a new flat
+table that holds uCapacity bindings without resizing and never shrinks
+below that size. Returns 1 (TRUE) on success, or 0 (FALSE) if
+insufficient memory is available, in which case oSymTable is
+unchanged.*/
+static int SymTable_promote(SymTable_T oSymTable, size_t uCapacity);
+
+/*Moves the bindings of the flat table of oSymTable, of which there are
+at most SMALL_MAX, back into its small array and frees the flat table.
+Returns 1 (TRUE) on success, or 0 (FALSE) if insufficient memory is
+available, in which case oSymTable is unchanged.*/
+static int SymTable_demote(SymTable_T oSymTable);
+
+SymTable_T SymTable_new(void){
+  SymTable_T table;
+
+  table = (SymTable_T) malloc(sizeof(struct SymTable));
+  if(table == NULL) return NULL;
+  table->large = NULL;
+  table->size = 0;
+  table->borrowed = 0;
+  return table;
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity){
+  SymTable_T table = SymTable_new();
+
+  if(table == NULL) return NULL;
+  /*a table expected to outgrow the array starts as a flat table*/
+  if(uCapacity > SMALL_MAX && !SymTable_promote(table, uCapacity)){
+    free(table);
+    return NULL;
+  }
+  return table;
+}
+
+SymTable_T SymTable_newBorrowed(void){
+  SymTable_T table = SymTable_new();
+
+  if(table != NULL) table->borrowed = 1;
+  return table;
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity){
+  assert(oSymTable != NULL);
+
+  if(oSymTable->large != NULL)
+    return AdaptFlat_reserve(oSymTable->large, uCapacity);
+  if(uCapacity <= SMALL_MAX) return 1;
+  return SymTable_promote(oSymTable, uCapacity);
+}
+
+void SymTable_free(SymTable_T oSymTable){
+  size_t i;
+
+  assert(oSymTable != NULL);
+
+  if(oSymTable->large != NULL) AdaptFlat_free(oSymTable->large);
+  /*frees the keys that are not stored inline, values untouched*/
+  for(i = 0; i < oSymTable->size; i++)
+    if(SymTable_tag(&oSymTable->entries[i]) == TAG_HEAP)
+      free(oSymTable->entries[i].key.heap);
+  free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+
+  if(oSymTable->large != NULL)
+    return AdaptFlat_getLength(oSymTable->large);
+  return oSymTable->size;
+}
+
+int SymTable_put(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if(oSymTable->large != NULL)
+    return AdaptFlat_putHashed(oSymTable->large, pcKey, uLength, uHash,
+      pvValue);
+  if(SymTable_find(oSymTable, pcKey, uLength, uHash) != NULL) return 0;
+  return SymTable_putUniqueHashed(oSymTable, pcKey, uLength, uHash,
+    pvValue);
+}
+
+int SymTable_putUnique(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putUniqueHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putUniqueHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  struct Entry *entry;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /*a full array turns into a flat table, and the binding goes there*/
+  if(oSymTable->large == NULL && oSymTable->size == SMALL_MAX
+  && !SymTable_promote(oSymTable, 0)) return 0;
+  if(oSymTable->large != NULL)
+    return AdaptFlat_putUniqueHashed(oSymTable->large, pcKey, uLength,
+      uHash, pvValue);
+
+  entry = &oSymTable->entries[oSymTable->size];
+  if(!SymTable_setKey(entry, pcKey, uLength, oSymTable->borrowed))
+    return 0;
+  entry->hash = uHash;
+  entry->value = pvValue;
+  oSymTable->size += 1;
+  return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_replaceHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+void *SymTable_replaceHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  struct Entry *entry;
+  void *oldValue;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if(oSymTable->large != NULL)
+    return AdaptFlat_replaceHashed(oSymTable->large, pcKey, uLength,
+      uHash, pvValue);
+  entry = SymTable_find(oSymTable, pcKey, uLength, uHash);
+  if(entry == NULL) return NULL;
+
+  oldValue = (void *) entry->value;
+  entry->value = pvValue;
+  return oldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_containsHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+int SymTable_containsHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if(oSymTable->large != NULL)
+    return AdaptFlat_containsHashed(oSymTable->large, pcKey, uLength,
+      uHash);
+  return SymTable_find(oSymTable, pcKey, uLength, uHash) != NULL;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_getHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_getHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Entry *entry;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if(oSymTable->large != NULL)
+    return AdaptFlat_getHashed(oSymTable->large, pcKey, uLength, uHash);
+  entry = SymTable_find(oSymTable, pcKey, uLength, uHash);
+  if(entry == NULL) return NULL;
+  return (void *) entry->value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_removeHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_removeHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Entry *entry;
+  void *oldValue;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if(oSymTable->large != NULL)
+    return AdaptFlat_removeHashed(oSymTable->large, pcKey, uLength,
+      uHash);
+  entry = SymTable_find(oSymTable, pcKey, uLength, uHash);
+  if(entry == NULL) return NULL;
+
+  oldValue = (void *) entry->value;
+  /*frees key, value untouched*/
+  if(SymTable_tag(entry) == TAG_HEAP) free(entry->key.heap);
+
+  /*the array keeps no order, so the last Entry fills the hole*/
+  oSymTable->size -= 1;
+  *entry = oSymTable->entries[oSymTable->size];
+  return oldValue;
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  size_t uCount, void **ppvValues){
+
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  if(oSymTable->large != NULL){
+    AdaptFlat_getBatch(oSymTable->large, ppcKeys, uCount, ppvValues);
+    return;
+  }
+  /*the array is a few cache lines that the first lookup brings in, so
+  there is nothing to overlap*/
+  for(i = 0; i < uCount; i++)
+    ppvValues[i] = SymTable_get(oSymTable, ppcKeys[i]);
+}
+
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount){
+
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  /*keys are put one at a time until the table turns into a flat table,
+  which takes the rest of the batch at once*/
+  for(i = 0; i < uCount && oSymTable->large == NULL; i++)
+    added += (size_t) SymTable_put(oSymTable, ppcKeys[i], ppvValues[i]);
+  if(i < uCount)
+    added += AdaptFlat_putBatch(oSymTable->large, ppcKeys + i,
+      ppvValues + i, uCount - i);
+  return added;
+}
+
+size_t SymTable_bulkLoad(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount, size_t uThreads){
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  /*a load that may not fit in the array turns the table into a flat
+  table first, even if repeated keys would have let it fit. If that
+  fails, the puts of SymTable_putBatch try again*/
+  if(oSymTable->large == NULL && uCount > SMALL_MAX - oSymTable->size)
+    (void) SymTable_promote(oSymTable, 0);
+  if(oSymTable->large == NULL)
+    return SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount);
+  return AdaptFlat_bulkLoad(oSymTable->large, ppcKeys, ppvValues, uCount,
+    uThreads);
+}
+
+void SymTable_map(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra){
+
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  if(oSymTable->large != NULL){
+    AdaptFlat_map(oSymTable->large, pfApply, pvExtra);
+    return;
+  }
+  for(i = 0; i < oSymTable->size; i++){
+    struct Entry *entry = &oSymTable->entries[i];
+    (*pfApply)(SymTable_key(entry), (void *) entry->value,
+      (void *) pvExtra);
+  }
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra, size_t uThreads){
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  /*a few bindings are not worth a thread*/
+  if(oSymTable->large == NULL){
+    SymTable_map(oSymTable, pfApply, pvExtra);
+    return;
+  }
+  AdaptFlat_mapParallel(oSymTable->large, pfApply, pvExtra, uThreads);
+}
+
+int SymTable_compact(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+
+  /*the small array has nothing to give back: it is part of the
+  SymTable and long keys are malloced one by one*/
+  if(oSymTable->large == NULL) return 1;
+  if(AdaptFlat_getLength(oSymTable->large) <= SMALL_MAX)
+    return SymTable_demote(oSymTable);
+  return AdaptFlat_compact(oSymTable->large);
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable,
+  struct SymTable_Iter *psIter){
+  struct AdaptFlat_Iter inner;
+
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+
+  /*index is the next Entry, or the place in the flat table, whose
+  iterator keeps its place in index alone*/
+  psIter->table = oSymTable;
+  psIter->position = NULL;
+  psIter->index = 0;
+  if(oSymTable->large != NULL){
+    AdaptFlat_iterBegin(oSymTable->large, &inner);
+    psIter->index = inner.index;
+  }
+}
+
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+  void **ppvValue){
+  struct AdaptFlat_Iter inner;
+  SymTable_T table;
+
+  assert(psIter != NULL);
+  assert(ppcKey != NULL);
+  assert(ppvValue != NULL);
+
+  table = psIter->table;
+  if(table->large != NULL){
+    inner.table = table->large;
+    inner.position = NULL;
+    inner.index = psIter->index;
+    if(!AdaptFlat_iterNext(&inner, ppcKey, ppvValue)) return 0;
+    psIter->index = inner.index;
+    return 1;
+  }
+  if(psIter->index >= table->size) return 0;
+  *ppcKey = SymTable_key(&table->entries[psIter->index]);
+  *ppvValue = (void *) table->entries[psIter->index].value;
+  psIter->index += 1;
+  return 1;
+}
+
+int SymTable_getStats(SymTable_T oSymTable,
+  struct SymTable_Stats *psStats){
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+
+  /*neither the array, which has no buckets, nor the flat table keeps
+  any*/
+  return 0;
+}
+
+size_t SymTable_hash(const char *pcKey, size_t uLength){
+  assert(pcKey != NULL);
+  return StrHash_hash(pcKey, uLength);
+}
+
+static int SymTable_tag(const struct Entry *psEntry){
+  assert(psEntry != NULL);
+  return psEntry->key.bytes[KEY_AREA - 1];
+}
+
+static const char *SymTable_key(const struct Entry *psEntry){
+  assert(psEntry != NULL);
+  return SymTable_tag(psEntry) == TAG_INLINE ? psEntry->key.bytes
+    : psEntry->key.heap;
+}
+
+static int SymTable_setKey(struct Entry *psEntry, const char *pcKey,
+  size_t uLength, int iBorrowed){
+  assert(psEntry != NULL);
+  assert(pcKey != NULL);
+
+  /*defensive copy of key, into the Entry if it fits, unless the key is
+  borrowed, in which case it is kept with its const cast away and never
+  written through or freed*/
+  memset(&psEntry->key, 0, sizeof(psEntry->key));
+  if(iBorrowed){
+    psEntry->key.heap = (char *) pcKey;
+    psEntry->key.bytes[KEY_AREA - 1] = TAG_BORROWED;
+  }
+  else if(uLength <= INLINE_MAX){
+    memcpy(psEntry->key.bytes, pcKey, uLength);
+    psEntry->key.bytes[KEY_AREA - 1] = TAG_INLINE;
+  }
+  else {
+    psEntry->key.heap = (char *) malloc(sizeof(char) * (uLength + 1));
+    if(psEntry->key.heap == NULL) return 0;
+    memcpy(psEntry->key.heap, pcKey, uLength);
+    psEntry->key.heap[uLength] = '\0';
+    psEntry->key.bytes[KEY_AREA - 1] = TAG_HEAP;
+  }
+  return 1;
+}
+
+static struct Entry *SymTable_find(SymTable_T oSymTable,
+  const char *pcKey, size_t uLength, size_t uHash){
+
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  for(i = 0; i < oSymTable->size; i++){
+    struct Entry *entry = &oSymTable->entries[i];
+    /*the stored key is '\0' terminated and pcKey need not be, so the
+    terminator is checked after the first uLength bytes match. A
+    borrowed key looked up by the same pointer is equal without
+    reading its bytes*/
+    if(entry->hash == uHash){
+      const char *key = SymTable_key(entry);
+      if((key == pcKey || strncmp(key, pcKey, uLength) == 0)
+      && key[uLength] == '\0') return entry;
+    }
+  }
+  return NULL;
+}
+
+static int SymTable_promote(SymTable_T oSymTable, size_t uCapacity){
+  AdaptFlat_T large;
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(oSymTable->large == NULL);
+
+  if(oSymTable->borrowed){
+    large = AdaptFlat_newBorrowed();
+    if(large != NULL && !AdaptFlat_reserve(large, uCapacity)){
+      AdaptFlat_free(large);
+      return 0;
+    }
+  }
+  else large = AdaptFlat_newWithCapacity(uCapacity);
+  if(large == NULL) return 0;
+
+  /*the keys are distinct and their hashes known, so they go in
+  without a search. The flat table makes copies of its own, and ours
+  are freed only once every put has worked*/
+  for(i = 0; i < oSymTable->size; i++){
+    struct Entry *entry = &oSymTable->entries[i];
+    const char *key = SymTable_key(entry);
+    if(!AdaptFlat_putUniqueHashed(large, key, strlen(key), entry->hash,
+      entry->value)){
+      AdaptFlat_free(large);
+      return 0;
+    }
+  }
+  for(i = 0; i < oSymTable->size; i++)
+    if(SymTable_tag(&oSymTable->entries[i]) == TAG_HEAP)
+      free(oSymTable->entries[i].key.heap);
+  oSymTable->size = 0;
+  oSymTable->large = large;
+  return 1;
+}
+
+static int SymTable_demote(SymTable_T oSymTable){
+  struct AdaptFlat_Iter iter;
+  const char *key;
+  void *value;
+  size_t length;
+  size_t count = 0;
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(oSymTable->large != NULL);
+  assert(oSymTable->size == 0);
+  assert(AdaptFlat_getLength(oSymTable->large) <= SMALL_MAX);
+
+  /*the keys are copied out of the flat table before it is freed, and
+  a failed copy frees the ones made so far and leaves the flat table
+  in place*/
+  AdaptFlat_iterBegin(oSymTable->large, &iter);
+  while(AdaptFlat_iterNext(&iter, &key, &value)){
+    struct Entry *entry = &oSymTable->entries[count];
+    length = strlen(key);
+    if(!SymTable_setKey(entry, key, length, oSymTable->borrowed)){
+      for(i = 0; i < count; i++)
+        if(SymTable_tag(&oSymTable->entries[i]) == TAG_HEAP)
+          free(oSymTable->entries[i].key.heap);
+      return 0;
+    }
+    entry->hash = StrHash_hash(key, length);
+    entry->value = value;
+    count++;
+  }
+  AdaptFlat_free(oSymTable->large);
+  oSymTable->large = NULL;
+  oSymTable->size = count;
+  return 1;
+}
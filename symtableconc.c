@@ -0,0 +1,1069 @@
+/*--------------------------------------------------------------------*/
+/* symtableconc.c                                                     */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+/*A hash table SymTable that threads can share without a lock of their
+own.
+
+put, replace and remove, with their Hashed and batch forms, lock one
+of STRIPE_COUNT stripes picked by the hash of the key, so writers of
+different keys rarely wait for each other.
+
+get and contains take no lock. A reader counts itself in its stripe
+for the current epoch and walks the chain with atomic loads. A removed
+Node is only freed once every reader of the epoch it was removed in
+has left, so a reader never touches freed memory.
+
+Growing copies the chains into a new bucket array while holding every
+stripe and then publishes it with one pointer store. Readers go on
+walking whichever array they loaded. The grow then waits for those
+readers to leave and frees the old array and Nodes before it returns,
+so the copy costs twice the Nodes only while it runs. SymTable_map,
+SymTable_reserve and SymTable_compact also lock every stripe, and so
+does SymTable_mapParallel while its threads run. SymTable_bulkLoad is puts,
+split over threads by stripe.
+
+The iterator, SymTable_mapRange and SymTable_mapPrefix (which are
+built on the iterator in symtableorder.c) and SymTable_free must not
+run while other threads change the table.
+
+The atomics are the GCC __atomic builtins, which clang also has.*/
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtable.h"
+#include "strhash.h"
+#include "parallel.h"
+
+/*BUCKET_COUNT is the bucket count of a new table. STRIPE_COUNT is the
+number of locks and must divide it. Both are powers of two*/
+enum { BUCKET_COUNT = 512, STRIPE_COUNT = 64 };
+
+/*CACHE_LINE is the padding between the reader counters of stripes, so
+readers of different stripes do not write to one cache line*/
+enum { CACHE_LINE = 64 };
+
+/*RECLAIM_BATCH is how many Nodes are retired between attempts to free
+retired memory*/
+enum { RECLAIM_BATCH = 64 };
+
+/*BULK_CHUNK is number of keys SymTable_bulkLoad hashes at a time, which
+bounds its temporary storage. BULK_PART_MIN is the fewest keys, or
+buckets, it gives one thread, so that small loads stay on one thread*/
+enum { BULK_CHUNK = 1048576, BULK_PART_MIN = 4096 };
+
+/*A Node is one binding. The key is stored in the Node itself, so a
+Node is one allocation and is freed as one. In a table that borrows its
+keys the Node holds the caller's key pointer there instead*/
+struct Node {
+  /*hash is the hash of key*/
+  size_t hash;
+  /*value is read by readers while writers replace it*/
+  void *value;
+  /*next is the following Node of the chain*/
+  struct Node *next;
+  /*retired links Nodes waiting to be freed. It is separate from next,
+  which readers may still be following*/
+  struct Node *retired;
+  /*key is the '\0' terminated key, or the bytes of a borrowed key's
+  pointer. Read it with SymTable_nodeKey*/
+  char key[];
+};
+
+/*A Buckets is a bucket array along with its size, so readers load
+both with one pointer*/
+struct Buckets {
+  /*count is number of buckets, a power of two*/
+  size_t count;
+  /*retired links bucket arrays waiting to be freed*/
+  struct Buckets *retired;
+  /*heads are the first Nodes of the chains*/
+  struct Node *heads[];
+};
+
+/*A Stripe is one of the locks and its reader counters*/
+struct Stripe {
+  /*lock is held by writers of keys whose hash falls in the Stripe*/
+  pthread_mutex_t lock;
+  /*readers[e] is number of readers in the Stripe that entered during
+  epoch e*/
+  unsigned long readers[2];
+  char pad[CACHE_LINE];
+};
+
+/*A SymTable is a hash table of Nodes with striped locks*/
+struct SymTable {
+  /*buckets is the current bucket array*/
+  struct Buckets *buckets;
+  /*size is number of key value pairs or bindings*/
+  size_t size;
+  /*stripes are the locks of writers and counters of readers*/
+  struct Stripe stripes[STRIPE_COUNT];
+  /*reclaimLock guards the fields below it*/
+  pthread_mutex_t reclaimLock;
+  /*epoch is the current epoch, 0 or 1*/
+  unsigned epoch;
+  /*retiredNodes[e] and retiredBuckets[e] were unlinked during epoch
+  e and are freed once no reader of that epoch is left*/
+  struct Node *retiredNodes[2];
+  struct Buckets *retiredBuckets[2];
+  /*retiredCount is number of Nodes retired since the last attempt to
+  free them*/
+  size_t retiredCount;
+  /*borrowed is 1 (TRUE) if the table keeps the caller's key pointers
+  instead of copying the keys. It never changes, so readers need no
+  lock to read it*/
+  int borrowed;
+};
+
+/*A Bulk is one chunk of keys of a SymTable_bulkLoad, shared by the
+threads loading it*/
+struct Bulk {
+  /*table is the SymTable being loaded*/
+  SymTable_T table;
+  /*keys and values are the bindings of the chunk*/
+  const char *const *keys;
+  const void *const *values;
+  /*count is number of keys in the chunk*/
+  size_t count;
+  /*lengths[i] and hashes[i] are the length and hash of keys[i]*/
+  size_t *lengths;
+  size_t *hashes;
+  /*added[p] is number of bindings part p added*/
+  size_t added[PARALLEL_MAX_PARTS];
+};
+
+/*A Visit is one SymTable_mapParallel, shared by the threads running
+it*/
+struct Visit {
+  /*table is the SymTable being mapped*/
+  SymTable_T table;
+  /*buckets is the bucket array being mapped*/
+  struct Buckets *buckets;
+  /*apply is the function applied to each binding*/
+  void (*apply)(const char *pcKey, void *pvValue, void *pvExtra);
+  /*extra is passed to apply*/
+  const void *extra;
+};
+
+/*Returns the smallest bucket count, a power of two no lower than
+BUCKET_COUNT, at which uCapacity bindings do not make a table grow, or
+0 if that count would overflow.*/
+static size_t SymTable_bucketsFor(size_t uCapacity);
+
+/*Returns a new empty bucket array of uCount buckets, or NULL if
+insufficient memory is available.*/
+static struct Buckets *SymTable_newBuckets(size_t uCount);
+
+/*Returns the Stripe of oSymTable for keys of hash uHash.*/
+static struct Stripe *SymTable_stripe(SymTable_T oSymTable,
+  size_t uHash);
+
+/*Counts a reader in oStripe for the current epoch of oSymTable and
+returns that epoch, which must be passed to SymTable_leave.*/
+static unsigned SymTable_enter(SymTable_T oSymTable,
+  struct Stripe *oStripe);
+
+/*Ends the read that SymTable_enter returned uEpoch for.*/
+static void SymTable_leave(struct Stripe *oStripe, unsigned uEpoch);
+
+/*Returns the Node of oBuckets, a bucket array of oSymTable, with the
+uLength byte key pcKey and hash
+uHash, or NULL if there is none. Unless ppoLink is NULL, stores in
+*ppoLink the address of the link that pointed to the Node, or of the
+NULL that ended its chain. Safe to call without a lock, but a reader
+must only use the returned Node, as the link may change right after
+it is read.*/
+static struct Node *SymTable_find(SymTable_T oSymTable,
+  struct Buckets *oBuckets, const char *pcKey, size_t uLength,
+  size_t uHash, struct Node ***ppoLink);
+
+/*Locks every stripe of oSymTable, in order.*/
+static void SymTable_lockAll(SymTable_T oSymTable);
+
+/*Unlocks every stripe of oSymTable.*/
+static void SymTable_unlockAll(SymTable_T oSymTable);
+
+/*Copies every Node of oSymTable into a new array of uCount buckets,
+publishes it and frees the old array and Nodes once no reader can
+reach them. The caller holds every stripe. Returns 1 (TRUE) on
+success, or 0 (FALSE) if insufficient memory is available, in which
+case oSymTable is unchanged.*/
+static int SymTable_rebuild(SymTable_T oSymTable, size_t uCount);
+
+/*Doubles the buckets of oSymTable if it holds more bindings than
+buckets. A failed grow leaves the table as it is.*/
+static void SymTable_grow(SymTable_T oSymTable);
+
+/*Finds the lengths and hashes of the keys in part uPart of uParts of
+the Bulk pvBulk.*/
+static void SymTable_bulkHash(size_t uPart, size_t uParts, void *pvBulk);
+
+/*Puts, in order, the bindings of the Bulk pvBulk whose Stripe is in
+part uPart of uParts of the stripes, so no two parts take the same
+lock.*/
+static void SymTable_bulkPut(size_t uPart, size_t uParts, void *pvBulk);
+
+/*Applies the function of the Visit pvVisit to each binding in part
+uPart of uParts of its bucket array.*/
+static void SymTable_visitPart(size_t uPart, size_t uParts,
+  void *pvVisit);
+
+/*Hands oNode and oBuckets, either of which may be NULL, to oSymTable
+to free once no reader can reach them.*/
+static void SymTable_retire(SymTable_T oSymTable, struct Node *oNode,
+  struct Buckets *oBuckets);
+
+/*Frees what was retired in the previous epoch of oSymTable and starts
+a new epoch, if no reader of the previous epoch is left. Returns 1
+(TRUE) if it did, or 0 (FALSE) if a reader is left. The caller holds
+reclaimLock.*/
+static int SymTable_reclaim(SymTable_T oSymTable);
+
+/*Frees everything retired in oSymTable so far, yielding until the
+readers that may still hold it have left. The caller does not hold
+reclaimLock.*/
+static void SymTable_drain(SymTable_T oSymTable);
+
+/*Frees the retired Nodes and bucket arrays of epoch uEpoch.*/
+static void SymTable_freeRetired(SymTable_T oSymTable, unsigned uEpoch);
+
+/*Returns the size of a Node of oSymTable whose key is uLength bytes
+long.*/
+static size_t SymTable_nodeSize(SymTable_T oSymTable, size_t uLength);
+
+/*Returns the key of oNode, a Node of oSymTable.*/
+static const char *SymTable_nodeKey(SymTable_T oSymTable,
+  const struct Node *oNode);
+
+SymTable_T SymTable_new(void){
+  return SymTable_newWithCapacity(0);
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity){
+  SymTable_T table;
+  size_t num;
+  size_t i;
+
+  num = SymTable_bucketsFor(uCapacity);
+  if(num == 0) return NULL;
+
+  table = (SymTable_T) malloc(sizeof(struct SymTable));
+  if(table == NULL) return NULL;
+  table->buckets = SymTable_newBuckets(num);
+  if(table->buckets == NULL){
+    free(table);
+    return NULL;
+  }
+  if(pthread_mutex_init(&table->reclaimLock, NULL) != 0){
+    free(table->buckets);
+    free(table);
+    return NULL;
+  }
+  for(i = 0; i < STRIPE_COUNT; i++){
+    if(pthread_mutex_init(&table->stripes[i].lock, NULL) != 0){
+      while(i > 0) pthread_mutex_destroy(&table->stripes[--i].lock);
+      pthread_mutex_destroy(&table->reclaimLock);
+      free(table->buckets);
+      free(table);
+      return NULL;
+    }
+    table->stripes[i].readers[0] = 0;
+    table->stripes[i].readers[1] = 0;
+  }
+  table->size = 0;
+  table->epoch = 0;
+  table->retiredNodes[0] = table->retiredNodes[1] = NULL;
+  table->retiredBuckets[0] = table->retiredBuckets[1] = NULL;
+  table->retiredCount = 0;
+  table->borrowed = 0;
+  return table;
+}
+
+SymTable_T SymTable_newBorrowed(void){
+  SymTable_T table = SymTable_new();
+
+  if(table != NULL) table->borrowed = 1;
+  return table;
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity){
+  size_t num;
+  int result = 1;
+
+  assert(oSymTable != NULL);
+
+  num = SymTable_bucketsFor(uCapacity);
+  if(num == 0) return 0;
+
+  SymTable_lockAll(oSymTable);
+  if(num > oSymTable->buckets->count)
+    result = SymTable_rebuild(oSymTable, num);
+  SymTable_unlockAll(oSymTable);
+  return result;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+  struct Buckets *buckets;
+  struct Node *node;
+  struct Node *next;
+  size_t i;
+
+  assert(oSymTable != NULL);
+
+  /*no other thread is using the table, so retired memory is freed
+  without waiting*/
+  SymTable_freeRetired(oSymTable, 0);
+  SymTable_freeRetired(oSymTable, 1);
+
+  buckets = oSymTable->buckets;
+  for(i = 0; i < buckets->count; i++){
+    for(node = buckets->heads[i]; node != NULL; node = next){
+      next = node->next;
+      /*frees Node and key together, values untouched*/
+      free(node);
+    }
+  }
+  free(buckets);
+
+  for(i = 0; i < STRIPE_COUNT; i++)
+    pthread_mutex_destroy(&oSymTable->stripes[i].lock);
+  pthread_mutex_destroy(&oSymTable->reclaimLock);
+  free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+  return __atomic_load_n(&oSymTable->size, __ATOMIC_RELAXED);
+}
+
+int SymTable_put(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  struct Stripe *stripe;
+  struct Buckets *buckets;
+  struct Node **link;
+  struct Node *node;
+  size_t size;
+  size_t count;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /*the Node is made before locking to keep the lock short, and thrown
+  away if the key turns out to be there already*/
+  node = (struct Node *) malloc(SymTable_nodeSize(oSymTable, uLength));
+  if(node == NULL) return 0;
+  node->hash = uHash;
+  node->value = (void *) pvValue;
+  node->retired = NULL;
+  /*the pointer is copied bytewise since key need not be aligned for
+  one*/
+  if(oSymTable->borrowed) memcpy(node->key, &pcKey, sizeof(const char *));
+  else {
+    memcpy(node->key, pcKey, uLength);
+    node->key[uLength] = '\0';
+  }
+
+  stripe = SymTable_stripe(oSymTable, uHash);
+  pthread_mutex_lock(&stripe->lock);
+  /*holding a stripe keeps the bucket array from being replaced*/
+  buckets = oSymTable->buckets;
+  if(SymTable_find(oSymTable, buckets, pcKey, uLength, uHash, NULL)
+  != NULL){
+    pthread_mutex_unlock(&stripe->lock);
+    free(node);
+    return 0;
+  }
+  /*the new Node goes at the head of its chain, and the release store
+  makes its fields visible before the Node is*/
+  link = &buckets->heads[uHash & (buckets->count - 1)];
+  node->next = *link;
+  __atomic_store_n(link, node, __ATOMIC_RELEASE);
+  size = __atomic_add_fetch(&oSymTable->size, 1, __ATOMIC_RELAXED);
+  /*the array may be retired as soon as the stripe is unlocked*/
+  count = buckets->count;
+  pthread_mutex_unlock(&stripe->lock);
+
+  if(size > count) SymTable_grow(oSymTable);
+  return 1;
+}
+
+int SymTable_putUnique(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putUniqueHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putUniqueHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+  /*the search for the key is what finds the link a new Node goes in
+  at, and it runs under the stripe lock anyway, so nothing is saved by
+  trusting the caller*/
+  return SymTable_putHashed(oSymTable, pcKey, uLength, uHash, pvValue);
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_replaceHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+void *SymTable_replaceHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  struct Stripe *stripe;
+  struct Node *node;
+  void *oldValue = NULL;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  stripe = SymTable_stripe(oSymTable, uHash);
+  pthread_mutex_lock(&stripe->lock);
+  node = SymTable_find(oSymTable, oSymTable->buckets, pcKey, uLength,
+    uHash, NULL);
+  if(node != NULL){
+    oldValue = node->value;
+    __atomic_store_n(&node->value, (void *) pvValue, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&stripe->lock);
+  return oldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_containsHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+int SymTable_containsHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Stripe *stripe;
+  struct Buckets *buckets;
+  unsigned epoch;
+  int found;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  stripe = SymTable_stripe(oSymTable, uHash);
+  epoch = SymTable_enter(oSymTable, stripe);
+  buckets = __atomic_load_n(&oSymTable->buckets, __ATOMIC_ACQUIRE);
+  found = SymTable_find(oSymTable, buckets, pcKey, uLength, uHash,
+    NULL) != NULL;
+  SymTable_leave(stripe, epoch);
+  return found;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_getHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_getHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Stripe *stripe;
+  struct Buckets *buckets;
+  struct Node *node;
+  void *value = NULL;
+  unsigned epoch;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  stripe = SymTable_stripe(oSymTable, uHash);
+  epoch = SymTable_enter(oSymTable, stripe);
+  buckets = __atomic_load_n(&oSymTable->buckets, __ATOMIC_ACQUIRE);
+  node = SymTable_find(oSymTable, buckets, pcKey, uLength, uHash, NULL);
+  if(node != NULL)
+    value = __atomic_load_n(&node->value, __ATOMIC_ACQUIRE);
+  SymTable_leave(stripe, epoch);
+  return value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_removeHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_removeHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Stripe *stripe;
+  struct Node **link;
+  struct Node *node;
+  void *oldValue;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  stripe = SymTable_stripe(oSymTable, uHash);
+  pthread_mutex_lock(&stripe->lock);
+  node = SymTable_find(oSymTable, oSymTable->buckets, pcKey, uLength,
+    uHash, &link);
+  if(node == NULL){
+    pthread_mutex_unlock(&stripe->lock);
+    return NULL;
+  }
+  /*unlinks the Node but leaves its next alone, so a reader standing
+  on it still finds the rest of the chain*/
+  oldValue = node->value;
+  __atomic_store_n(link, node->next, __ATOMIC_RELEASE);
+  __atomic_sub_fetch(&oSymTable->size, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&stripe->lock);
+
+  SymTable_retire(oSymTable, node, NULL);
+  return oldValue;
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  size_t uCount, void **ppvValues){
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  /*each get is already lock free, so a batch is the gets in turn*/
+  for(i = 0; i < uCount; i++)
+    ppvValues[i] = SymTable_get(oSymTable, ppcKeys[i]);
+}
+
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount){
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  for(i = 0; i < uCount; i++)
+    added += (size_t) SymTable_put(oSymTable, ppcKeys[i], ppvValues[i]);
+  return added;
+}
+
+size_t SymTable_bulkLoad(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount, size_t uThreads){
+
+  struct Bulk bulk;
+  size_t start;
+  size_t parts;
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  /*growing once up front saves copying every Node at each doubling.
+  If it fails, the puts grow the table as usual*/
+  (void) SymTable_reserve(oSymTable,
+    uCount > ((size_t) -1) - SymTable_getLength(oSymTable)
+    ? (size_t) -1 : SymTable_getLength(oSymTable) + uCount);
+
+  bulk.table = oSymTable;
+  bulk.count = uCount < BULK_CHUNK ? uCount : BULK_CHUNK;
+  bulk.lengths = (size_t *) malloc(bulk.count * sizeof(size_t));
+  bulk.hashes = (size_t *) malloc(bulk.count * sizeof(size_t));
+  if(bulk.lengths == NULL || bulk.hashes == NULL){
+    free(bulk.lengths);
+    free(bulk.hashes);
+    return SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount);
+  }
+
+  for(start = 0; start < uCount; start += bulk.count){
+    if(bulk.count > uCount - start) bulk.count = uCount - start;
+    bulk.keys = ppcKeys + start;
+    bulk.values = ppvValues + start;
+    parts = Parallel_parts(uThreads, bulk.count, BULK_PART_MIN);
+    Parallel_run(parts, SymTable_bulkHash, &bulk);
+    /*each key belongs to one part, so the first of a repeated key is
+    always the one put, whatever the timing of the threads*/
+    if(parts > STRIPE_COUNT) parts = STRIPE_COUNT;
+    Parallel_run(parts, SymTable_bulkPut, &bulk);
+    for(i = 0; i < parts; i++) added += bulk.added[i];
+  }
+
+  free(bulk.lengths);
+  free(bulk.hashes);
+  return added;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra){
+
+  struct Buckets *buckets;
+  struct Node *node;
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  /*holds every stripe, so pfApply may read the table but must not
+  change it*/
+  SymTable_lockAll(oSymTable);
+  buckets = oSymTable->buckets;
+  for(i = 0; i < buckets->count; i++)
+    for(node = buckets->heads[i]; node != NULL; node = node->next)
+      (*pfApply)(SymTable_nodeKey(oSymTable, node), node->value,
+        (void *) pvExtra);
+  SymTable_unlockAll(oSymTable);
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra, size_t uThreads){
+
+  struct Visit visit;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  /*the stripes stay held by this thread while the others walk the
+  buckets, so no writer changes them*/
+  SymTable_lockAll(oSymTable);
+  visit.table = oSymTable;
+  visit.buckets = oSymTable->buckets;
+  visit.apply = pfApply;
+  visit.extra = pvExtra;
+  Parallel_run(Parallel_parts(uThreads, visit.buckets->count,
+    BULK_PART_MIN), SymTable_visitPart, &visit);
+  SymTable_unlockAll(oSymTable);
+}
+
+int SymTable_compact(SymTable_T oSymTable){
+  int result;
+
+  assert(oSymTable != NULL);
+
+  SymTable_lockAll(oSymTable);
+  result = SymTable_rebuild(oSymTable,
+    SymTable_bucketsFor(oSymTable->size));
+  SymTable_unlockAll(oSymTable);
+  return result;
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable,
+  struct SymTable_Iter *psIter){
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+
+  psIter->table = oSymTable;
+  psIter->position = NULL;
+  psIter->index = 0;
+}
+
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+  void **ppvValue){
+  struct Buckets *buckets;
+  struct Node *node;
+
+  assert(psIter != NULL);
+  assert(ppcKey != NULL);
+  assert(ppvValue != NULL);
+
+  buckets = psIter->table->buckets;
+  node = (struct Node *) psIter->position;
+  while(node == NULL && psIter->index < buckets->count)
+    node = buckets->heads[psIter->index++];
+  if(node == NULL) return 0;
+
+  *ppcKey = SymTable_nodeKey(psIter->table, node);
+  *ppvValue = node->value;
+  psIter->position = node->next;
+  return 1;
+}
+
+int SymTable_getStats(SymTable_T oSymTable,
+  struct SymTable_Stats *psStats){
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+
+  /*counting would make every reader write to shared lines, so
+  nothing is counted*/
+  return 0;
+}
+
+size_t SymTable_hash(const char *pcKey, size_t uLength){
+  assert(pcKey != NULL);
+  return StrHash_hash(pcKey, uLength);
+}
+
+static size_t SymTable_bucketsFor(size_t uCapacity){
+  size_t num = BUCKET_COUNT;
+
+  /*a put grows the table once size passes the bucket count*/
+  while(num < uCapacity){
+    if(num > ((size_t) -1) / 2 / sizeof(struct Node *)) return 0;
+    num *= 2;
+  }
+  return num;
+}
+
+static struct Buckets *SymTable_newBuckets(size_t uCount){
+  struct Buckets *buckets;
+
+  if(uCount > (((size_t) -1) - sizeof(struct Buckets))
+    / sizeof(struct Node *)) return NULL;
+  buckets = (struct Buckets *) calloc(1, sizeof(struct Buckets)
+    + uCount * sizeof(struct Node *));
+  if(buckets == NULL) return NULL;
+  buckets->count = uCount;
+  buckets->retired = NULL;
+  return buckets;
+}
+
+static struct Stripe *SymTable_stripe(SymTable_T oSymTable,
+  size_t uHash){
+  assert(oSymTable != NULL);
+
+  /*STRIPE_COUNT divides every bucket count, so all keys of a bucket
+  share a Stripe*/
+  return &oSymTable->stripes[uHash & (STRIPE_COUNT - 1)];
+}
+
+static unsigned SymTable_enter(SymTable_T oSymTable,
+  struct Stripe *oStripe){
+  unsigned epoch;
+
+  assert(oSymTable != NULL);
+  assert(oStripe != NULL);
+
+  /*the epoch is checked again after counting in. If it moved on, the
+  reclaimer may already have seen the old counter at zero, so the
+  count is taken back and redone in the new epoch. Nothing is read
+  before the check passes*/
+  for(;;){
+    epoch = __atomic_load_n(&oSymTable->epoch, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&oStripe->readers[epoch], 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&oSymTable->epoch, __ATOMIC_SEQ_CST) == epoch)
+      return epoch;
+    __atomic_sub_fetch(&oStripe->readers[epoch], 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+static void SymTable_leave(struct Stripe *oStripe, unsigned uEpoch){
+  assert(oStripe != NULL);
+
+  __atomic_sub_fetch(&oStripe->readers[uEpoch], 1, __ATOMIC_RELEASE);
+}
+
+static struct Node *SymTable_find(SymTable_T oSymTable,
+  struct Buckets *oBuckets, const char *pcKey, size_t uLength,
+  size_t uHash, struct Node ***ppoLink){
+  struct Node **link;
+  struct Node *node;
+
+  assert(oSymTable != NULL);
+  assert(oBuckets != NULL);
+  assert(pcKey != NULL);
+
+  link = &oBuckets->heads[uHash & (oBuckets->count - 1)];
+  while((node = __atomic_load_n(link, __ATOMIC_ACQUIRE)) != NULL){
+    if(node->hash == uHash){
+      const char *key = SymTable_nodeKey(oSymTable, node);
+      /*a borrowed key looked up by the same pointer, an interned one
+      say, is equal without reading its bytes*/
+      if((key == pcKey || strncmp(key, pcKey, uLength) == 0)
+      && key[uLength] == '\0') break;
+    }
+    link = &node->next;
+  }
+  if(ppoLink != NULL) *ppoLink = link;
+  return node;
+}
+
+static void SymTable_lockAll(SymTable_T oSymTable){
+  size_t i;
+
+  assert(oSymTable != NULL);
+
+  /*always in the same order, so two threads locking all cannot
+  deadlock*/
+  for(i = 0; i < STRIPE_COUNT; i++)
+    pthread_mutex_lock(&oSymTable->stripes[i].lock);
+}
+
+static void SymTable_unlockAll(SymTable_T oSymTable){
+  size_t i;
+
+  assert(oSymTable != NULL);
+
+  for(i = STRIPE_COUNT; i > 0; i--)
+    pthread_mutex_unlock(&oSymTable->stripes[i - 1].lock);
+}
+
+static int SymTable_rebuild(SymTable_T oSymTable, size_t uCount){
+  struct Buckets *old;
+  struct Buckets *buckets;
+  struct Node *node;
+  struct Node *copy;
+  size_t nodeSize;
+  size_t i;
+  unsigned epoch;
+
+  assert(oSymTable != NULL);
+
+  if(uCount == 0) return 0;
+  buckets = SymTable_newBuckets(uCount);
+  if(buckets == NULL) return 0;
+
+  /*Nodes are copied rather than relinked, since relinking would send
+  a reader walking an old chain into a new one where it can miss its
+  key*/
+  old = oSymTable->buckets;
+  for(i = 0; i < old->count; i++){
+    for(node = old->heads[i]; node != NULL; node = node->next){
+      struct Node **head;
+      nodeSize = SymTable_nodeSize(oSymTable,
+        strlen(SymTable_nodeKey(oSymTable, node)));
+      copy = (struct Node *) malloc(nodeSize);
+      if(copy == NULL){
+        size_t j;
+        for(j = 0; j < buckets->count; j++){
+          struct Node *next;
+          for(node = buckets->heads[j]; node != NULL; node = next){
+            next = node->next;
+            free(node);
+          }
+        }
+        free(buckets);
+        return 0;
+      }
+      memcpy(copy, node, nodeSize);
+      head = &buckets->heads[copy->hash & (uCount - 1)];
+      copy->next = *head;
+      *head = copy;
+    }
+  }
+
+  __atomic_store_n(&oSymTable->buckets, buckets, __ATOMIC_RELEASE);
+
+  /*the old Nodes and array are retired in one go and freed right away
+  rather than left for later removes, which a table that only grows
+  never makes*/
+  pthread_mutex_lock(&oSymTable->reclaimLock);
+  epoch = oSymTable->epoch;
+  for(i = 0; i < old->count; i++){
+    for(node = old->heads[i]; node != NULL; node = node->next){
+      node->retired = oSymTable->retiredNodes[epoch];
+      oSymTable->retiredNodes[epoch] = node;
+    }
+  }
+  old->retired = oSymTable->retiredBuckets[epoch];
+  oSymTable->retiredBuckets[epoch] = old;
+  pthread_mutex_unlock(&oSymTable->reclaimLock);
+  SymTable_drain(oSymTable);
+  return 1;
+}
+
+static void SymTable_grow(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+
+  SymTable_lockAll(oSymTable);
+  /*another writer may have grown the table while this one waited*/
+  if(oSymTable->size > oSymTable->buckets->count
+  && oSymTable->buckets->count <= ((size_t) -1) / 2)
+    (void) SymTable_rebuild(oSymTable, oSymTable->buckets->count * 2);
+  SymTable_unlockAll(oSymTable);
+}
+
+static void SymTable_retire(SymTable_T oSymTable, struct Node *oNode,
+  struct Buckets *oBuckets){
+  unsigned epoch;
+
+  assert(oSymTable != NULL);
+
+  pthread_mutex_lock(&oSymTable->reclaimLock);
+  epoch = oSymTable->epoch;
+  if(oNode != NULL){
+    oNode->retired = oSymTable->retiredNodes[epoch];
+    oSymTable->retiredNodes[epoch] = oNode;
+    oSymTable->retiredCount += 1;
+  }
+  if(oBuckets != NULL){
+    oBuckets->retired = oSymTable->retiredBuckets[epoch];
+    oSymTable->retiredBuckets[epoch] = oBuckets;
+    oSymTable->retiredCount += RECLAIM_BATCH;
+  }
+  if(oSymTable->retiredCount >= RECLAIM_BATCH){
+    oSymTable->retiredCount = 0;
+    (void) SymTable_reclaim(oSymTable);
+  }
+  pthread_mutex_unlock(&oSymTable->reclaimLock);
+}
+
+static int SymTable_reclaim(SymTable_T oSymTable){
+  unsigned previous;
+  size_t i;
+
+  assert(oSymTable != NULL);
+
+  /*readers counted in the previous epoch may still hold what was
+  retired in it. Readers of the current epoch entered after it was
+  unlinked, so they cannot reach it. If one is still there the memory
+  waits for a later attempt; readers are never waited for*/
+  previous = oSymTable->epoch ^ 1;
+  for(i = 0; i < STRIPE_COUNT; i++)
+    if(__atomic_load_n(&oSymTable->stripes[i].readers[previous],
+      __ATOMIC_SEQ_CST) != 0) return 0;
+
+  SymTable_freeRetired(oSymTable, previous);
+  /*what is retired from now on goes to the emptied lists*/
+  __atomic_store_n(&oSymTable->epoch, previous, __ATOMIC_SEQ_CST);
+  return 1;
+}
+
+static void SymTable_drain(SymTable_T oSymTable){
+  int flips = 0;
+
+  assert(oSymTable != NULL);
+
+  /*the first flip frees the previous epoch and makes the current one
+  previous, and the second frees that. A reader holds no lock while it
+  is counted in and never waits, so it leaves soon*/
+  pthread_mutex_lock(&oSymTable->reclaimLock);
+  while(flips < 2){
+    if(SymTable_reclaim(oSymTable))
+      flips++;
+    else{
+      pthread_mutex_unlock(&oSymTable->reclaimLock);
+      sched_yield();
+      pthread_mutex_lock(&oSymTable->reclaimLock);
+    }
+  }
+  oSymTable->retiredCount = 0;
+  pthread_mutex_unlock(&oSymTable->reclaimLock);
+}
+
+static void SymTable_freeRetired(SymTable_T oSymTable, unsigned uEpoch){
+  struct Node *node;
+  struct Buckets *buckets;
+
+  assert(oSymTable != NULL);
+
+  while((node = oSymTable->retiredNodes[uEpoch]) != NULL){
+    oSymTable->retiredNodes[uEpoch] = node->retired;
+    free(node);
+  }
+  while((buckets = oSymTable->retiredBuckets[uEpoch]) != NULL){
+    oSymTable->retiredBuckets[uEpoch] = buckets->retired;
+    free(buckets);
+  }
+}
+
+static void SymTable_bulkHash(size_t uPart, size_t uParts, void *pvBulk){
+  struct Bulk *bulk = (struct Bulk *) pvBulk;
+  size_t end;
+  size_t i;
+
+  assert(bulk != NULL);
+
+  end = Parallel_begin(bulk->count, uPart + 1, uParts);
+  for(i = Parallel_begin(bulk->count, uPart, uParts); i < end; i++){
+    assert(bulk->keys[i] != NULL);
+    bulk->lengths[i] = strlen(bulk->keys[i]);
+    bulk->hashes[i] = StrHash_hash(bulk->keys[i], bulk->lengths[i]);
+  }
+}
+
+static void SymTable_bulkPut(size_t uPart, size_t uParts, void *pvBulk){
+  struct Bulk *bulk = (struct Bulk *) pvBulk;
+  size_t first;
+  size_t end;
+  size_t i;
+  size_t added = 0;
+
+  assert(bulk != NULL);
+
+  first = Parallel_begin(STRIPE_COUNT, uPart, uParts);
+  end = Parallel_begin(STRIPE_COUNT, uPart + 1, uParts);
+  for(i = 0; i < bulk->count; i++){
+    size_t stripe = bulk->hashes[i] & (STRIPE_COUNT - 1);
+    if(stripe >= first && stripe < end)
+      added += (size_t) SymTable_putHashed(bulk->table, bulk->keys[i],
+        bulk->lengths[i], bulk->hashes[i], bulk->values[i]);
+  }
+  bulk->added[uPart] = added;
+}
+
+static void SymTable_visitPart(size_t uPart, size_t uParts,
+  void *pvVisit){
+  struct Visit *visit = (struct Visit *) pvVisit;
+  struct Node *node;
+  size_t end;
+  size_t i;
+
+  assert(visit != NULL);
+
+  end = Parallel_begin(visit->buckets->count, uPart + 1, uParts);
+  for(i = Parallel_begin(visit->buckets->count, uPart, uParts);
+    i < end; i++)
+    for(node = visit->buckets->heads[i]; node != NULL; node = node->next)
+      (*visit->apply)(SymTable_nodeKey(visit->table, node), node->value,
+        (void *) visit->extra);
+}
+
+static size_t SymTable_nodeSize(SymTable_T oSymTable, size_t uLength){
+  assert(oSymTable != NULL);
+
+  if(oSymTable->borrowed)
+    return sizeof(struct Node) + sizeof(const char *);
+  return sizeof(struct Node) + sizeof(char) * (uLength + 1);
+}
+
+static const char *SymTable_nodeKey(SymTable_T oSymTable,
+  const struct Node *oNode){
+  const char *key;
+
+  assert(oSymTable != NULL);
+  assert(oNode != NULL);
+
+  if(!oSymTable->borrowed) return oNode->key;
+  memcpy(&key, oNode->key, sizeof(const char *));
+  return key;
+}
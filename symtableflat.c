@@ -0,0 +1,822 @@
+/*--------------------------------------------------------------------*/
+/* symtableflat.c                                                     */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtable.h"
+#include "strhash.h"
+#include "parallel.h"
+
+/*SLOT_COUNT is starting number of slots in the table. It must be a
+power of two so that a slot index can be found with a mask*/
+enum { SLOT_COUNT = 64 };
+
+/*the table grows once more than LOAD_NUM/LOAD_DEN of its slots are
+full*/
+enum { LOAD_NUM = 7, LOAD_DEN = 8 };
+
+/*the table halves once fewer than one in SHRINK_DIVISOR of its slots
+are full. That leaves it just under a quarter full, far enough from
+both thresholds that a size hovering near one does not resize back
+and forth*/
+enum { SHRINK_DIVISOR = 8 };
+
+/*BATCH_SIZE is number of keys SymTable_getBatch and SymTable_putBatch
+hash and prefetch before resolving any of them*/
+enum { BATCH_SIZE = 16 };
+
+/*BULK_CHUNK is number of keys SymTable_bulkLoad hashes at a time, which
+bounds its temporary storage. BULK_PART_MIN is the fewest keys, or
+Slots, it gives one thread, so that small loads stay on one thread*/
+enum { BULK_CHUNK = 1048576, BULK_PART_MIN = 4096 };
+
+/*KEY_AREA is number of bytes of a Slot that hold its key. A key of at
+most INLINE_MAX bytes is stored there with its '\0', and a longer one
+is malloced and the area holds a pointer to it. A table that borrows
+its keys holds the caller's pointer there instead. The last byte of the
+area is the tag that tells which, or that the Slot is empty*/
+enum { KEY_AREA = 16, INLINE_MAX = KEY_AREA - 2 };
+
+/*the values of the tag byte of a Slot. An empty Slot is all zero
+bytes, so a calloced Slot array is empty*/
+enum { TAG_EMPTY = 0, TAG_INLINE = 1, TAG_HEAP = 2, TAG_BORROWED = 3 };
+
+/*SymTable_prefetch starts loading the cache line at pv without waiting
+for it. It is only a hint, so it is a no-op for other compilers*/
+#if defined(__GNUC__)
+#define SymTable_prefetch(pv) __builtin_prefetch(pv)
+#else
+#define SymTable_prefetch(pv) ((void) (pv))
+#endif
+
+/*A Slot is one entry of the flat slot array. A Slot whose tag is
+TAG_EMPTY is empty. Bindings are placed with Robin Hood linear probing,
+so every Slot is at most as far from its home index as the Slots before
+it in the same run. Short keys are kept in the Slot itself, so most
+bindings have no allocation of their own and a hit compares bytes on
+the cache line the probe already read*/
+struct Slot {
+  /*full hash of key, compared before the key bytes are touched*/
+  size_t hash;
+  /*value of Slot*/
+  const void *value;
+  /*key used to identify Slot: the key itself in bytes if the tag
+  bytes[KEY_AREA - 1] is TAG_INLINE, or a pointer in heap to a
+  malloced copy if it is TAG_HEAP or to the caller's key if it is
+  TAG_BORROWED*/
+  union {
+    char bytes[KEY_AREA];
+    char *heap;
+  } key;
+};
+
+/*A Bulk is one chunk of keys of a SymTable_bulkLoad, shared by the
+threads hashing it*/
+struct Bulk {
+  /*keys are the keys of the chunk*/
+  const char *const *keys;
+  /*count is number of keys in the chunk*/
+  size_t count;
+  /*lengths[i] and hashes[i] are filled in with the length and hash of
+  keys[i]*/
+  size_t *lengths;
+  size_t *hashes;
+};
+
+/*A Visit is one SymTable_mapParallel, shared by the threads running
+it*/
+struct Visit {
+  /*table is the SymTable being mapped*/
+  SymTable_T table;
+  /*apply is the function applied to each binding*/
+  void (*apply)(const char *pcKey, void *pvValue, void *pvExtra);
+  /*extra is passed to apply*/
+  const void *extra;
+};
+
+/*A SymTable is a single contiguous array of Slots indexed by the hash
+of their keys. There are no per binding nodes, so a lookup reads the
+slot array and, only for a long key, the matching key.*/
+struct SymTable {
+  /*size is number of key value pairs or bindings*/
+  size_t size;
+  /*slotsNum is number of Slots in SymTable, always a power of two*/
+  size_t slotsNum;
+  /*slots is the array of Slots*/
+  struct Slot *slots;
+  /*minSlotsNum is the Slot count the table never shrinks below,
+  SLOT_COUNT or more if capacity was reserved*/
+  size_t minSlotsNum;
+  /*borrowed is 1 (TRUE) if the table keeps the caller's key pointers
+  instead of copying the keys*/
+  int borrowed;
+};
+
+/*Returns the tag of the Slot at psSlot.*/
+static int SymTable_tag(const struct Slot *psSlot);
+
+/*Returns the key of the Slot at psSlot, which must not be empty.*/
+static const char *SymTable_key(const struct Slot *psSlot);
+
+/*Returns how far the Slot at index uIndex is from the index its hash
+prefers in a table of uSlotsNum Slots.*/
+static size_t SymTable_distance(size_t uHash, size_t uIndex,
+  size_t uSlotsNum);
+
+/*Returns the index of the Slot in oSymTable holding the uLength byte
+key pcKey with hash uHash, or oSymTable->slotsNum if there is no such
+Slot.*/
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash);
+
+/*Hashes the uCount keys in ppcKeys into puLengths and puHashes and
+prefetches their home Slots, then the stored key of each home Slot
+whose hash matches, so the probes can then run without waiting on one
+miss at a time. uCount is at most BATCH_SIZE.*/
+static void SymTable_prefetchBatch(SymTable_T oSymTable,
+  const char *const *ppcKeys, size_t uCount, size_t *puLengths,
+  size_t *puHashes);
+
+/*Places oSlot into oSymTable, displacing Slots that are closer to
+their home index. oSymTable must have at least one empty Slot and must
+not already contain oSlot's key.*/
+static void SymTable_place(SymTable_T oSymTable, struct Slot oSlot);
+
+/*Returns the fewest Slots, a power of two and at least SLOT_COUNT, that
+hold uCapacity bindings under the load limit, or 0 if that many Slots
+could not be addressed.*/
+static size_t SymTable_slotsFor(size_t uCapacity);
+
+/*Changes the number of Slots in oSymTable to uSlotsNum, a power of two
+with room for every binding, and re-places every binding. Returns
+1 (TRUE) on success or 0 (FALSE) if insufficient memory is available,
+in which case oSymTable is unchanged.*/
+static int SymTable_resize(SymTable_T oSymTable, size_t uSlotsNum);
+
+/*Finds the lengths and hashes of the keys in part uPart of uParts of
+the Bulk pvBulk.*/
+static void SymTable_bulkHash(size_t uPart, size_t uParts, void *pvBulk);
+
+/*Applies the function of the Visit pvVisit to each binding in part
+uPart of uParts of the Slot array.*/
+static void SymTable_visitPart(size_t uPart, size_t uParts,
+  void *pvVisit);
+
+SymTable_T SymTable_new(void){
+  return SymTable_newWithCapacity(0);
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity){
+
+  SymTable_T table;
+  size_t num;
+
+  num = SymTable_slotsFor(uCapacity);
+  if(num == 0) return NULL;
+
+  table = (SymTable_T) malloc(sizeof(struct SymTable));
+  if(table == NULL) return NULL;
+
+  /*calloc leaves every key NULL so all Slots start empty*/
+  table->slots = (struct Slot *) calloc(num, sizeof(struct Slot));
+  if(table->slots == NULL){
+    free(table);
+    return NULL;
+  }
+  table->size = 0;
+  table->slotsNum = num;
+  table->minSlotsNum = num;
+  table->borrowed = 0;
+  return table;
+}
+
+SymTable_T SymTable_newBorrowed(void){
+  SymTable_T table = SymTable_new();
+
+  if(table != NULL) table->borrowed = 1;
+  return table;
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity){
+  size_t num;
+
+  assert(oSymTable != NULL);
+
+  num = SymTable_slotsFor(uCapacity);
+  if(num == 0) return 0;
+  if(num > oSymTable->minSlotsNum) oSymTable->minSlotsNum = num;
+  if(num <= oSymTable->slotsNum) return 1;
+  return SymTable_resize(oSymTable, num);
+}
+
+void SymTable_free(SymTable_T oSymTable){
+  size_t i;
+
+  assert(oSymTable != NULL);
+
+  /*frees the keys that are not stored inline, values untouched*/
+  for(i = 0; i < oSymTable->slotsNum; i++)
+    if(SymTable_tag(&oSymTable->slots[i]) == TAG_HEAP)
+      free(oSymTable->slots[i].key.heap);
+  free(oSymTable->slots);
+  free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+  return oSymTable->size;
+}
+
+int SymTable_put(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if(SymTable_find(oSymTable, pcKey, uLength, uHash)
+  != oSymTable->slotsNum) return 0;
+  return SymTable_putUniqueHashed(oSymTable, pcKey, uLength, uHash,
+    pvValue);
+}
+
+int SymTable_putUnique(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putUniqueHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putUniqueHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  struct Slot slot;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /*the caller vouches that the key is new, so the probe for it is
+  skipped and only the one that places the Slot is made.
+  Grows before placing so that the probe always finds an empty Slot.
+  If growing fails the binding can still go in as long as one Slot
+  stays empty*/
+  if((oSymTable->size + 1) * LOAD_DEN > oSymTable->slotsNum * LOAD_NUM){
+    if((oSymTable->slotsNum > ((size_t) -1) / 2 / sizeof(struct Slot)
+    || !SymTable_resize(oSymTable, oSymTable->slotsNum * 2))
+    && oSymTable->size + 1 >= oSymTable->slotsNum) return 0;
+  }
+
+  /*defensive copy of key, into the Slot if it fits, unless the key is
+  borrowed. A borrowed key is never written through or freed, its tag
+  sees to that, so it is kept with its const cast away*/
+  memset(&slot, 0, sizeof(struct Slot));
+  if(oSymTable->borrowed){
+    slot.key.heap = (char *) pcKey;
+    slot.key.bytes[KEY_AREA - 1] = TAG_BORROWED;
+  }
+  else if(uLength <= INLINE_MAX){
+    memcpy(slot.key.bytes, pcKey, uLength);
+    slot.key.bytes[KEY_AREA - 1] = TAG_INLINE;
+  }
+  else {
+    slot.key.heap = (char *) malloc(sizeof(char) * (uLength + 1));
+    if(slot.key.heap == NULL) return 0;
+    memcpy(slot.key.heap, pcKey, uLength);
+    slot.key.heap[uLength] = '\0';
+    slot.key.bytes[KEY_AREA - 1] = TAG_HEAP;
+  }
+  slot.hash = uHash;
+  slot.value = pvValue;
+
+  SymTable_place(oSymTable, slot);
+  oSymTable->size += 1;
+  return 1;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_replaceHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+void *SymTable_replaceHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  size_t index;
+  void *oldValue;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  index = SymTable_find(oSymTable, pcKey, uLength, uHash);
+  if(index == oSymTable->slotsNum) return NULL;
+
+  oldValue = (void *) oSymTable->slots[index].value;
+  oSymTable->slots[index].value = pvValue;
+  return oldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_containsHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+int SymTable_containsHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  return SymTable_find(oSymTable, pcKey, uLength, uHash)
+    != oSymTable->slotsNum;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_getHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_getHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  size_t index;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  index = SymTable_find(oSymTable, pcKey, uLength, uHash);
+  if(index == oSymTable->slotsNum) return NULL;
+  return (void *) oSymTable->slots[index].value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_removeHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_removeHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  size_t index;
+  size_t next;
+  size_t mask;
+  void *oldValue;
+  struct Slot *slots;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  index = SymTable_find(oSymTable, pcKey, uLength, uHash);
+  if(index == oSymTable->slotsNum) return NULL;
+
+  slots = oSymTable->slots;
+  mask = oSymTable->slotsNum - 1;
+  oldValue = (void *) slots[index].value;
+  /*frees key, value untouched*/
+  if(SymTable_tag(&slots[index]) == TAG_HEAP) free(slots[index].key.heap);
+
+  /*backward shift: pulls each following Slot of the run one step
+  closer to home so no tombstone is needed*/
+  next = (index + 1) & mask;
+  while(SymTable_tag(&slots[next]) != TAG_EMPTY
+  && SymTable_distance(slots[next].hash, next, oSymTable->slotsNum) != 0){
+    slots[index] = slots[next];
+    index = next;
+    next = (next + 1) & mask;
+  }
+  memset(&slots[index], 0, sizeof(struct Slot));
+
+  oSymTable->size -= 1;
+
+  /*a failed shrink leaves the table valid, just sparser*/
+  if(oSymTable->slotsNum > oSymTable->minSlotsNum
+  && oSymTable->size < oSymTable->slotsNum / SHRINK_DIVISOR)
+    (void) SymTable_resize(oSymTable, oSymTable->slotsNum / 2);
+  return oldValue;
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  size_t uCount, void **ppvValues){
+
+  size_t lengths[BATCH_SIZE];
+  size_t hashes[BATCH_SIZE];
+  size_t start;
+  size_t count;
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  for(start = 0; start < uCount; start += count){
+    count = uCount - start;
+    if(count > BATCH_SIZE) count = BATCH_SIZE;
+
+    SymTable_prefetchBatch(oSymTable, ppcKeys + start, count, lengths,
+      hashes);
+    for(i = 0; i < count; i++){
+      size_t index = SymTable_find(oSymTable, ppcKeys[start + i],
+        lengths[i], hashes[i]);
+      ppvValues[start + i] = index == oSymTable->slotsNum ? NULL
+        : (void *) oSymTable->slots[index].value;
+    }
+  }
+}
+
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount){
+
+  size_t lengths[BATCH_SIZE];
+  size_t hashes[BATCH_SIZE];
+  size_t start;
+  size_t count;
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  for(start = 0; start < uCount; start += count){
+    count = uCount - start;
+    if(count > BATCH_SIZE) count = BATCH_SIZE;
+
+    /*a put in the middle of the group may resize the slot array, which
+    only makes some prefetches useless, not wrong*/
+    SymTable_prefetchBatch(oSymTable, ppcKeys + start, count, lengths,
+      hashes);
+    for(i = 0; i < count; i++)
+      added += (size_t) SymTable_putHashed(oSymTable, ppcKeys[start + i],
+        lengths[i], hashes[i], ppvValues[start + i]);
+  }
+  return added;
+}
+
+size_t SymTable_bulkLoad(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount, size_t uThreads){
+
+  struct Bulk bulk;
+  size_t num;
+  size_t start;
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  /*the Slot array grows once, to fit every key, instead of doubling
+  over and over. Unlike SymTable_reserve this does not keep the table
+  from shrinking later. If it fails, the puts grow it as usual*/
+  num = SymTable_slotsFor(uCount > ((size_t) -1) - oSymTable->size
+    ? (size_t) -1 : oSymTable->size + uCount);
+  if(num > oSymTable->slotsNum) (void) SymTable_resize(oSymTable, num);
+
+  bulk.count = uCount < BULK_CHUNK ? uCount : BULK_CHUNK;
+  bulk.lengths = (size_t *) malloc(bulk.count * sizeof(size_t));
+  bulk.hashes = (size_t *) malloc(bulk.count * sizeof(size_t));
+  if(bulk.lengths == NULL || bulk.hashes == NULL){
+    free(bulk.lengths);
+    free(bulk.hashes);
+    return SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount);
+  }
+
+  /*a placement can shift Slots any distance along the array, so only
+  the hashing is split over threads and the keys are placed here, in
+  order*/
+  for(start = 0; start < uCount; start += bulk.count){
+    if(bulk.count > uCount - start) bulk.count = uCount - start;
+    bulk.keys = ppcKeys + start;
+    Parallel_run(Parallel_parts(uThreads, bulk.count, BULK_PART_MIN),
+      SymTable_bulkHash, &bulk);
+    for(i = 0; i < bulk.count; i++){
+      /*the hashes are known ahead, so the home Slot of a later key is
+      requested while this one is placed*/
+      if(i + BATCH_SIZE < bulk.count)
+        SymTable_prefetch(&oSymTable->slots[bulk.hashes[i + BATCH_SIZE]
+          & (oSymTable->slotsNum - 1)]);
+      added += (size_t) SymTable_putHashed(oSymTable, bulk.keys[i],
+        bulk.lengths[i], bulk.hashes[i], ppvValues[start + i]);
+    }
+  }
+
+  free(bulk.lengths);
+  free(bulk.hashes);
+  return added;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra){
+
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  for(i = 0; i < oSymTable->slotsNum; i++){
+    struct Slot *slot = &oSymTable->slots[i];
+    if(SymTable_tag(slot) != TAG_EMPTY)
+      (*pfApply)(SymTable_key(slot), (void *) slot->value,
+        (void *) pvExtra);
+  }
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra, size_t uThreads){
+
+  struct Visit visit;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  visit.table = oSymTable;
+  visit.apply = pfApply;
+  visit.extra = pvExtra;
+  Parallel_run(Parallel_parts(uThreads, oSymTable->slotsNum,
+    BULK_PART_MIN), SymTable_visitPart, &visit);
+}
+
+int SymTable_compact(SymTable_T oSymTable){
+  size_t num;
+
+  assert(oSymTable != NULL);
+
+  /*the fewest Slots that hold every binding under the load limit.
+  Long keys are malloced one by one, so only the Slot array, with the
+  short keys in it, moves. Reserved capacity is given up too*/
+  num = SymTable_slotsFor(oSymTable->size);
+  oSymTable->minSlotsNum = SLOT_COUNT;
+  if(num == oSymTable->slotsNum) return 1;
+  return SymTable_resize(oSymTable, num);
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable,
+  struct SymTable_Iter *psIter){
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+
+  psIter->table = oSymTable;
+  psIter->position = NULL;
+  psIter->index = 0;
+}
+
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+  void **ppvValue){
+  SymTable_T table;
+  size_t i;
+
+  assert(psIter != NULL);
+  assert(ppcKey != NULL);
+  assert(ppvValue != NULL);
+
+  table = psIter->table;
+  /*the Slots are one array, so skipping empty ones is a sequential
+  scan with no pointers to chase*/
+  for(i = psIter->index; i < table->slotsNum; i++){
+    if(SymTable_tag(&table->slots[i]) != TAG_EMPTY){
+      *ppcKey = SymTable_key(&table->slots[i]);
+      *ppvValue = (void *) table->slots[i].value;
+      psIter->index = i + 1;
+      return 1;
+    }
+  }
+  psIter->index = table->slotsNum;
+  return 0;
+}
+
+int SymTable_getStats(SymTable_T oSymTable,
+  struct SymTable_Stats *psStats){
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+
+  /*open addressing has no chains, and its probes are not counted*/
+  return 0;
+}
+
+size_t SymTable_hash(const char *pcKey, size_t uLength){
+  assert(pcKey != NULL);
+  return StrHash_hash(pcKey, uLength);
+}
+
+static int SymTable_tag(const struct Slot *psSlot){
+  assert(psSlot != NULL);
+  return psSlot->key.bytes[KEY_AREA - 1];
+}
+
+static const char *SymTable_key(const struct Slot *psSlot){
+  assert(psSlot != NULL);
+  assert(SymTable_tag(psSlot) != TAG_EMPTY);
+  return SymTable_tag(psSlot) == TAG_INLINE ? psSlot->key.bytes
+    : psSlot->key.heap;
+}
+
+static size_t SymTable_distance(size_t uHash, size_t uIndex,
+  size_t uSlotsNum){
+  return (uIndex - uHash) & (uSlotsNum - 1);
+}
+
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+
+  size_t index;
+  size_t dist;
+  size_t mask;
+  struct Slot *slots;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  slots = oSymTable->slots;
+  mask = oSymTable->slotsNum - 1;
+  index = uHash & mask;
+
+  for(dist = 0; ; dist++){
+    struct Slot *slot = &slots[index];
+    if(SymTable_tag(slot) == TAG_EMPTY) break;
+    /*a Slot closer to home than we are means pcKey would have
+    displaced it, so pcKey is not in the table*/
+    if(SymTable_distance(slot->hash, index, oSymTable->slotsNum) < dist)
+      break;
+    /*the stored key is '\0' terminated and pcKey need not be, so the
+    terminator is checked after the first uLength bytes match*/
+    if(slot->hash == uHash){
+      const char *key = SymTable_key(slot);
+      /*a borrowed key looked up by the same pointer, an interned one
+      say, is equal without reading its bytes*/
+      if((key == pcKey || strncmp(key, pcKey, uLength) == 0)
+      && key[uLength] == '\0') return index;
+    }
+    index = (index + 1) & mask;
+  }
+  return oSymTable->slotsNum;
+}
+
+static void SymTable_prefetchBatch(SymTable_T oSymTable,
+  const char *const *ppcKeys, size_t uCount, size_t *puLengths,
+  size_t *puHashes){
+  size_t mask;
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(uCount <= BATCH_SIZE);
+
+  mask = oSymTable->slotsNum - 1;
+  /*every home Slot is requested before any of them is read*/
+  for(i = 0; i < uCount; i++){
+    assert(ppcKeys[i] != NULL);
+    puLengths[i] = strlen(ppcKeys[i]);
+    puHashes[i] = StrHash_hash(ppcKeys[i], puLengths[i]);
+    SymTable_prefetch(&oSymTable->slots[puHashes[i] & mask]);
+  }
+  /*then the key bytes a probe will compare, for the keys not stored in
+  their Slot and not looked up by the same pointer. Most hits are in the
+  home Slot, so only its key is fetched*/
+  for(i = 0; i < uCount; i++){
+    struct Slot *slot = &oSymTable->slots[puHashes[i] & mask];
+    int tag = SymTable_tag(slot);
+    if((tag == TAG_HEAP || tag == TAG_BORROWED)
+    && slot->hash == puHashes[i] && slot->key.heap != ppcKeys[i])
+      SymTable_prefetch(slot->key.heap);
+  }
+}
+
+static void SymTable_place(SymTable_T oSymTable, struct Slot oSlot){
+  size_t index;
+  size_t dist;
+  size_t mask;
+  struct Slot *slots;
+
+  assert(oSymTable != NULL);
+
+  slots = oSymTable->slots;
+  mask = oSymTable->slotsNum - 1;
+  index = oSlot.hash & mask;
+
+  for(dist = 0; SymTable_tag(&slots[index]) != TAG_EMPTY; dist++){
+    size_t other = SymTable_distance(slots[index].hash, index,
+      oSymTable->slotsNum);
+    /*takes the Slot from a binding that is closer to home and carries
+    that binding forward instead*/
+    if(other < dist){
+      struct Slot temp = slots[index];
+      slots[index] = oSlot;
+      oSlot = temp;
+      dist = other;
+    }
+    index = (index + 1) & mask;
+  }
+  slots[index] = oSlot;
+}
+
+static size_t SymTable_slotsFor(size_t uCapacity){
+  size_t num = SLOT_COUNT;
+
+  if(uCapacity > ((size_t) -1) / LOAD_DEN) return 0;
+  /*a put grows the table before size passes LOAD_NUM/LOAD_DEN of the
+  Slots*/
+  while(uCapacity * LOAD_DEN > num * LOAD_NUM){
+    if(num > ((size_t) -1) / 2 / sizeof(struct Slot)) return 0;
+    num *= 2;
+  }
+  return num;
+}
+
+static int SymTable_resize(SymTable_T oSymTable, size_t uSlotsNum){
+  struct Slot *oldSlots;
+  size_t oldNum;
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert((uSlotsNum & (uSlotsNum - 1)) == 0);
+  assert(oSymTable->size < uSlotsNum);
+
+  oldSlots = oSymTable->slots;
+  oldNum = oSymTable->slotsNum;
+
+  oSymTable->slots = (struct Slot *) calloc(uSlotsNum, sizeof(struct Slot));
+  if(oSymTable->slots == NULL){
+    oSymTable->slots = oldSlots;
+    return 0;
+  }
+  oSymTable->slotsNum = uSlotsNum;
+
+  /*moves Slots over as they are, keys are not rehashed and only inline
+  keys move with their Slot*/
+  for(i = 0; i < oldNum; i++)
+    if(SymTable_tag(&oldSlots[i]) != TAG_EMPTY)
+      SymTable_place(oSymTable, oldSlots[i]);
+  free(oldSlots);
+  return 1;
+}
+
+static void SymTable_bulkHash(size_t uPart, size_t uParts, void *pvBulk){
+  struct Bulk *bulk = (struct Bulk *) pvBulk;
+  size_t end;
+  size_t i;
+
+  assert(bulk != NULL);
+
+  end = Parallel_begin(bulk->count, uPart + 1, uParts);
+  for(i = Parallel_begin(bulk->count, uPart, uParts); i < end; i++){
+    assert(bulk->keys[i] != NULL);
+    bulk->lengths[i] = strlen(bulk->keys[i]);
+    bulk->hashes[i] = StrHash_hash(bulk->keys[i], bulk->lengths[i]);
+  }
+}
+
+static void SymTable_visitPart(size_t uPart, size_t uParts,
+  void *pvVisit){
+  struct Visit *visit = (struct Visit *) pvVisit;
+  size_t end;
+  size_t i;
+
+  assert(visit != NULL);
+
+  end = Parallel_begin(visit->table->slotsNum, uPart + 1, uParts);
+  for(i = Parallel_begin(visit->table->slotsNum, uPart, uParts);
+    i < end; i++){
+    struct Slot *slot = &visit->table->slots[i];
+    if(SymTable_tag(slot) != TAG_EMPTY)
+      (*visit->apply)(SymTable_key(slot), (void *) slot->value,
+        (void *) visit->extra);
+  }
+}
@@ -6,83 +6,353 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "symtable.h"
+#include "strhash.h"
+#include "arena.h"
+#include "parallel.h"
+#include "snapshot.h"
 
-/*BUCKET_COUNT is starting size of Hash Table*/
-enum { BUCKET_COUNT = 509 };
+/*BUCKET_COUNT is starting size of Hash Table. Bucket counts are always
+powers of two so that a bucket index can be found with a mask*/
+enum { BUCKET_COUNT = 512 };
+
+/*MIGRATE_STEP is number of old buckets moved into the new bucket array
+by each put, get or remove while a resize is in progress*/
+enum { MIGRATE_STEP = 8 };
+
+/*the bucket count is halved once fewer than one binding per
+SHRINK_DIVISOR buckets is left. Halving leaves a load just under
+2/SHRINK_DIVISOR, well between the shrink and grow thresholds, so a
+table whose size hovers near either one does not resize back and
+forth*/
+enum { SHRINK_DIVISOR = 8 };
+
+/*BATCH_SIZE is number of keys SymTable_getBatch and SymTable_putBatch
+hash and prefetch before resolving any of them*/
+enum { BATCH_SIZE = 16 };
+
+/*BULK_CHUNK is number of keys SymTable_bulkLoad takes at a time, which
+bounds its temporary storage. BULK_PART_MIN is the fewest keys, or
+buckets, it gives one thread, so that small loads stay on one thread*/
+enum { BULK_CHUNK = 1048576, BULK_PART_MIN = 4096 };
+
+/*SymTable_prefetch starts loading the cache line at pv without waiting
+for it. It is only a hint, so it is a no-op for other compilers*/
+#if defined(__GNUC__)
+#define SymTable_prefetch(pv) __builtin_prefetch(pv)
+#else
+#define SymTable_prefetch(pv) ((void) (pv))
+#endif
+
+/*SymTable_count adds uAmount to the statistic field of oSymTable if
+the table keeps statistics, and compiles to nothing otherwise*/
+#ifdef SYMTABLE_STATS
+#define SymTable_count(oSymTable, field, uAmount) \
+  ((oSymTable)->stats.field += (uAmount))
+#else
+#define SymTable_count(oSymTable, field, uAmount) ((void) 0)
+#endif
 
 /*A Binding is a pair of key and value which is setup to be a linked 
 list (within a bucket of SymTable) with Binding *next pointing to 
-following Binding*/
+following Binding. The key is stored at the end of the Binding itself,
+so a Binding is one arena block and comparing its key follows no
+pointer. Most keys are short and fit in the same cache line as the
+fields compared before them; a Binding with a long key is big enough
+that the arena gives it a block of its own from the heap. In a table
+that borrows its keys the end of the Binding holds the caller's key
+pointer instead*/
 struct Binding {
-  /*key used to identify Binding*/
-  char *key;
-  /*value of Binding*/
-  const void *value;
+  /*full hash of key, compared before key bytes and reused on resize*/
+  size_t hash;
   /*pointer pointing to next Binding in linked list*/
   struct Binding *next;
+  /*value of Binding*/
+  const void *value;
+  /*previous Binding in the list of all Bindings of the table, in order
+  of insertion, or NULL if this is the oldest*/
+  struct Binding *prevAll;
+  /*next Binding in the list of all Bindings, or NULL if this is the
+  newest*/
+  struct Binding *nextAll;
+  /*key used to identify Binding, '\0' terminated, or the bytes of a
+  borrowed key's pointer. Read it with SymTable_bindingKey*/
+  char key[];
 };
 
 /*A SymTable is series key value pair Bindings sorted by hash values 
 from their key into respective "buckets". Within the buckets are linked
-lists for Bindings sharing the same hash.*/
+lists for Bindings sharing the same hash. While the table is resizing
+it keeps its old bucket array too, and Bindings move from old buckets
+to new ones a few buckets at a time. Every Binding is also on one list
+of all Bindings, so traversals skip empty buckets.*/
 struct SymTable {
   /*size is number of key value pairs or bindings*/
   size_t size;
-  /*bucketsNum is number of buckets or binding pointers in SymTable*/
-  int bucketsNum;
+  /*bucketsNum is number of buckets or binding pointers in SymTable,
+  always a power of two*/
+  size_t bucketsNum;
   /*buckets is an array of binding pointers with this being the initial
-  pointer*/
+  pointer, or NULL until the first put. A table that is never written
+  then costs no bucket array, and bucketsNum is the count it will be
+  allocated with*/
  struct Binding **buckets;
+  /*oldBuckets is the bucket array being emptied by a resize, or NULL
+  if no resize is in progress*/
+  struct Binding **oldBuckets;
+  /*oldBucketsNum is number of buckets in oldBuckets*/
+  size_t oldBucketsNum;
+  /*migrated is number of oldBuckets, from the start, already moved
+  into buckets*/
+  size_t migrated;
+  /*arena holds every Binding of the table, keys included, so they can be
+  freed all at once*/
+  Arena_T arena;
+  /*firstAll is the oldest Binding of the table, or NULL if it is empty*/
+  struct Binding *firstAll;
+  /*lastAll is the newest Binding of the table, or NULL if it is empty*/
+  struct Binding *lastAll;
+  /*minBucketsNum is the bucket count the table never shrinks below,
+  BUCKET_COUNT or more if capacity was reserved*/
+  size_t minBucketsNum;
+  /*snapshot is the file the table was opened from by
+  SymTable_openMapped, or NULL. A table with a snapshot is read-only,
+  keeps no Bindings and looks keys up in the snapshot instead*/
+  Snapshot_T snapshot;
+  /*borrowed is 1 (TRUE) if the table keeps the caller's key pointers
+  instead of copying the keys*/
+  int borrowed;
+#ifdef SYMTABLE_STATS
+  /*stats are the counts SymTable_getStats reports. Its chains and
+  bytes are only filled in when it is called*/
+  struct SymTable_Stats stats;
+#endif
 }; 
 
-/*Return a hash code for pcKey that is between 0 and uBucketCount-1,
-inclusive.*/
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount);
+/*A Bulk is one chunk of a SymTable_bulkLoad, shared by the threads
+loading it*/
+struct Bulk {
+  /*table is the SymTable being loaded*/
+  SymTable_T table;
+  /*count is number of keys in the chunk*/
+  size_t count;
+  /*bindings[i] is the new Binding of the ith key of the chunk, not yet
+  on any list, or NULL if it could not be allocated*/
+  struct Binding **bindings;
+  /*added[i] is 1 if bindings[i] was linked into its bucket, or 0 if
+  its key was already in the table*/
+  unsigned char *added;
+};
+
+/*A Visit is one SymTable_mapParallel, shared by the threads running
+it*/
+struct Visit {
+  /*table is the SymTable being mapped*/
+  SymTable_T table;
+  /*apply is the function applied to each binding*/
+  void (*apply)(const char *pcKey, void *pvValue, void *pvExtra);
+  /*extra is passed to apply*/
+  const void *extra;
+};
+
+/*SymTable_emptyBucket is the bucket of every hash in a table that has
+no bucket array yet. Nothing is ever linked into it, since a put
+allocates the array first*/
+static struct Binding *SymTable_emptyBucket = NULL;
+
+/*Allocates the bucket array of oSymTable, which has none yet, with
+bucketsNum buckets. Returns 1 (TRUE) on success, or 0 (FALSE) if
+insufficient memory is available, in which case oSymTable is
+unchanged.*/
+static int SymTable_allocBuckets(SymTable_T oSymTable);
+
+/*Returns the fewest buckets, a power of two and at least BUCKET_COUNT,
+that hold uCapacity bindings without growing, or 0 if that many
+buckets could not be addressed.*/
+static size_t SymTable_bucketsFor(size_t uCapacity);
+
+/*Starts moving oSymTable to uBucketsNum buckets, a power of two larger
+or smaller than the current count. Only the new bucket array is
+allocated here, existing Bindings are moved over later by
+SymTable_migrate. Returns 1 (TRUE) on success, or 0 (FALSE) if
+insufficient memory is available, in which case oSymTable is
+unchanged*/
+static int SymTable_resize(SymTable_T oSymTable, size_t uBucketsNum);
+
+/*Starts halving the bucket count of oSymTable if fewer than one binding
+per SHRINK_DIVISOR buckets is left, the count is above minBucketsNum
+and no resize is in progress. A failed shrink leaves the table as it is.*/
+static void SymTable_shrink(SymTable_T oSymTable);
 
-/*Returns a pointer to a new SymTable which is an expanded version of 
-oSymTable*/
-static SymTable_T SymTable_resize(SymTable_T oSymTable);
+/*Moves up to uSteps old buckets of oSymTable into its new bucket
+array, relinking their Bindings, and drops the old array once it is
+empty. Does nothing if no resize is in progress.*/
+static void SymTable_migrate(SymTable_T oSymTable, size_t uSteps);
+
+/*Returns the address of the bucket of oSymTable where a Binding with
+hash uHash is, or would be put. During a resize that is the old bucket
+if it has not been migrated yet, otherwise the new one.*/
+static struct Binding **SymTable_bucket(SymTable_T oSymTable,
+  size_t uHash);
+
+/*Returns the Binding of oSymTable in the chain starting at oFirst whose
+key is the uLength bytes at pcKey with hash uHash, or NULL if there is
+none.*/
+static struct Binding *SymTable_chainFind(SymTable_T oSymTable,
+  struct Binding *oFirst, const char *pcKey, size_t uLength,
+  size_t uHash);
+
+/*SymTable_chainFind for the lookups of SymTable_getHashed and
+SymTable_getBatch, which also counts them if oSymTable keeps
+statistics.*/
+static struct Binding *SymTable_lookup(SymTable_T oSymTable,
+  struct Binding *oFirst, const char *pcKey, size_t uLength,
+  size_t uHash);
+
+/*Hashes the uCount keys in ppcKeys into puLengths and puHashes and
+prefetches their bucket heads and the first Binding of each chain, so
+the chains can then be walked without waiting on one miss at a time.
+uCount is at most BATCH_SIZE.*/
+static void SymTable_prefetchBatch(SymTable_T oSymTable,
+  const char *const *ppcKeys, size_t uCount, size_t *puLengths,
+  size_t *puHashes);
+
+/*Returns 1 (TRUE) if the '\0' terminated key pcStored is the same as
+the uLength bytes at pcKey, or 0 (FALSE) otherwise.*/
+static int SymTable_keyEquals(const char *pcStored, const char *pcKey,
+  size_t uLength);
+
+/*Hashes the keys of the Bindings in part uPart of uParts of the Bulk
+pvBulk.*/
+static void SymTable_bulkHash(size_t uPart, size_t uParts, void *pvBulk);
+
+/*Links each Binding of the Bulk pvBulk whose bucket is in part uPart
+of uParts of the bucket array into that bucket, in order, unless its
+key is there already, and records which ones were linked in added. No
+two parts touch the same bucket, so they need no lock.*/
+static void SymTable_bulkLink(size_t uPart, size_t uParts, void *pvBulk);
+
+/*Applies the function of the Visit pvVisit to each binding in part
+uPart of uParts of the bucket array.*/
+static void SymTable_visitPart(size_t uPart, size_t uParts,
+  void *pvVisit);
+
+/*Returns the size of the arena block of a Binding of oSymTable whose
+key is uLength bytes long.*/
+static size_t SymTable_bindingSize(SymTable_T oSymTable, size_t uLength);
+
+/*Stores the uLength bytes at pcKey as the key of oBinding, a Binding
+of oSymTable: a '\0' terminated copy, or the pointer pcKey itself if
+oSymTable borrows its keys.*/
+static void SymTable_storeKey(SymTable_T oSymTable,
+  struct Binding *oBinding, const char *pcKey, size_t uLength);
+
+/*Returns the key of oBinding, a Binding of oSymTable.*/
+static const char *SymTable_bindingKey(SymTable_T oSymTable,
+  const struct Binding *oBinding);
+
+/*Unlinks oBinding from the list of all Bindings of oSymTable and gives
+it back to the arena of oSymTable. The value is untouched.*/
+static void SymTable_freeBinding(SymTable_T oSymTable,
+  struct Binding *oBinding);
+
+/*Links a new Binding of the uLength bytes at pcKey, with hash uHash and
+value pvValue, into oSymTable at *ppLink, in front of the Binding there
+if any, and appends it to the list of all Bindings. ppLink is a bucket
+of oSymTable or the next of a Binding in one. Grows the table if it
+gets too loaded. Returns 1 (TRUE) on success, or 0 (FALSE) if
+insufficient memory is available.*/
+static int SymTable_addBinding(SymTable_T oSymTable,
+  struct Binding **ppLink, const char *pcKey, size_t uLength,
+  size_t uHash, const void *pvValue);
+
+#ifdef SYMTABLE_STATS
+/*Adds the length of the chain of each bucket from uFirst up to uEnd of
+ppBuckets to the chains histogram of psStats.*/
+static void SymTable_countChains(struct SymTable_Stats *psStats,
+  struct Binding **ppBuckets, size_t uFirst, size_t uEnd);
+#endif
 
 SymTable_T SymTable_new(void){
+  return SymTable_newWithCapacity(0);
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity){
 
   SymTable_T table;
+  size_t num;
+
+  num = SymTable_bucketsFor(uCapacity);
+  if(num == 0) return NULL;
 
   table = (SymTable_T) malloc(sizeof(struct SymTable));
   if(table == NULL) return NULL;
 
-  /*only allocates memory for array of pointers not for actual bindings.
-  This will be done as we put Bindings*/
-  table->buckets = calloc(BUCKET_COUNT, sizeof(struct Binding *));
-  if(table->buckets == NULL){
+  /*allocates neither the Bindings nor the bucket array, which the
+  first put does, so a table that stays empty costs only this*/
+  table->arena = Arena_new();
+  if(table->arena == NULL){
     free(table);
     return NULL;
   }
   table->size = 0;
-  table->bucketsNum = BUCKET_COUNT;
+  table->buckets = NULL;
+  table->bucketsNum = num;
+  table->oldBuckets = NULL;
+  table->oldBucketsNum = 0;
+  table->migrated = 0;
+  table->firstAll = NULL;
+  table->lastAll = NULL;
+  table->minBucketsNum = num;
+  table->snapshot = NULL;
+  table->borrowed = 0;
+#ifdef SYMTABLE_STATS
+  memset(&table->stats, 0, sizeof(table->stats));
+#endif
   return table;
 }
 
-/*frees all memory of oSymTable, except the structure itself*/
-static void SymTable_freeInside(SymTable_T oSymTable){
-  int i;
+SymTable_T SymTable_newBorrowed(void){
+  SymTable_T table = SymTable_new();
+
+  if(table != NULL) table->borrowed = 1;
+  return table;
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity){
+  size_t num;
 
   assert(oSymTable != NULL);
 
-  for(i = 0; i < oSymTable->bucketsNum; i++){
-    struct Binding *current = oSymTable->buckets[i];
-    if(current != NULL){
-      struct Binding *pointer = current;
-      while(pointer != NULL){
-        /* temp is temporary only used to free Binding*/
-        struct Binding *temp = pointer;
-        pointer = pointer->next;
-        /*frees key and Binding, values untouched*/
-        free(temp->key);
-        free(temp);
-      }
-    }
+  if(oSymTable->snapshot != NULL) return 0;
+  num = SymTable_bucketsFor(uCapacity);
+  if(num == 0) return 0;
+  if(num > oSymTable->minBucketsNum) oSymTable->minBucketsNum = num;
+  /*a table with no bucket array yet only has to remember the size to
+  allocate it with*/
+  if(oSymTable->buckets == NULL){
+    if(num > oSymTable->bucketsNum) oSymTable->bucketsNum = num;
+    return 1;
   }
+  if(num <= oSymTable->bucketsNum) return 1;
+
+  if(!SymTable_resize(oSymTable, num)) return 0;
+  /*the caller is about to fill the table, so the Bindings are moved
+  now instead of slowing down the puts that follow*/
+  SymTable_migrate(oSymTable, oSymTable->oldBucketsNum);
+  return 1;
+}
+
+/*frees all memory of oSymTable, except the structure itself*/
+static void SymTable_freeInside(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+
+  /*every Binding lives in the arena, so no chain is walked.
+  Values untouched*/
+  Arena_free(oSymTable->arena);
+  if(oSymTable->snapshot != NULL) Snapshot_close(oSymTable->snapshot);
+  if(oSymTable->oldBuckets != NULL) free(oSymTable->oldBuckets);
   /*frees all pointers and table*/
   free(oSymTable->buckets);
 }
@@ -96,85 +366,119 @@ void SymTable_free(SymTable_T oSymTable){
 
 size_t SymTable_getLength(SymTable_T oSymTable){
   assert(oSymTable != NULL);
+  if(oSymTable->snapshot != NULL)
+    return Snapshot_getLength(oSymTable->snapshot);
   return oSymTable->size;
 }
 
 int SymTable_put(SymTable_T oSymTable,
   const char *pcKey, const void *pvValue){
-    size_t index;
+    size_t length;
+
+    assert(pcKey != NULL);
+
+    length = strlen(pcKey);
+    return SymTable_putHashed(oSymTable, pcKey, length,
+      StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+    struct Binding **bucket;
     struct Binding *current;
-    struct Binding *end;
-    char *newKey;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    index = SymTable_hash(pcKey, (size_t) oSymTable->bucketsNum);
-    current = oSymTable->buckets[index];
+    if(oSymTable->snapshot != NULL) return 0;
+    SymTable_count(oSymTable, puts, 1);
+    if(oSymTable->buckets == NULL && !SymTable_allocBuckets(oSymTable))
+      return 0;
+    SymTable_migrate(oSymTable, MIGRATE_STEP);
+    bucket = SymTable_bucket(oSymTable, uHash);
+    current = *bucket;
 
     if(current != NULL) {
       /*updates current until we are at the last Binding and 
       checks if there is duplicate key*/
       while(current->next != NULL){
-        if(strcmp(current->key, pcKey) == 0) return 0;
+        SymTable_count(oSymTable, putProbes, 1);
+        if(current->hash == uHash
+        && SymTable_keyEquals(SymTable_bindingKey(oSymTable, current),
+          pcKey, uLength)) return 0;
         current = current->next;
       }
       /*special case where table only has one binding and
       there is an attempt to add binding with same key*/
-      if(strcmp(current->key, pcKey) == 0) return 0;
+      SymTable_count(oSymTable, putProbes, 1);
+      if(current->hash == uHash
+      && SymTable_keyEquals(SymTable_bindingKey(oSymTable, current),
+        pcKey, uLength)) return 0;
     }
 
-    /*creates a new Binding end which will be potentially 
-    added to end of linked list*/
-    end = (struct Binding *) malloc(sizeof(struct Binding));
-    if(end == NULL) return 0;
-    /*defensive copy of key*/
-    newKey = (char *) malloc(sizeof(char) * (strlen(pcKey) + 1));
-    if(newKey == NULL){
-      free(end);
-      return 0;
-    } 
-    /*assigns values of Binding end*/
-    strcpy(newKey, pcKey);
-    end->key = newKey;
-    end->value = pvValue;
-    end->next = NULL;
-
-    /*adds end as first Binding if list is currently empty*/
-    if(current == NULL) oSymTable->buckets[index] = end;
-    /*adds end Binding to end of linked list*/
-    else current->next = end;
-    oSymTable->size += 1;
-    
-    /*resizes symtable if there are certain number of 
-    bindings compared to number of buckets*/
-    if((oSymTable->size > (size_t) oSymTable->bucketsNum)
-    && (oSymTable->bucketsNum != 65521)){
-      SymTable_T temp = SymTable_resize(oSymTable);
-      if(temp != NULL){
-        /*must dereferrence to change actual inside values*/
-        *oSymTable = *temp;
-        free(temp);
-      } 
-    }
+    /*adds the new Binding as first Binding if list is currently empty,
+    or after the last one*/
+    return SymTable_addBinding(oSymTable,
+      current == NULL ? bucket : &current->next, pcKey, uLength, uHash,
+      pvValue);
+}
 
-    return 1;
+int SymTable_putUnique(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+    size_t length;
+
+    assert(pcKey != NULL);
+
+    length = strlen(pcKey);
+    return SymTable_putUniqueHashed(oSymTable, pcKey, length,
+      StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putUniqueHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    if(oSymTable->snapshot != NULL) return 0;
+    SymTable_count(oSymTable, puts, 1);
+    if(oSymTable->buckets == NULL && !SymTable_allocBuckets(oSymTable))
+      return 0;
+    SymTable_migrate(oSymTable, MIGRATE_STEP);
+    /*the caller vouches that the key is new, so the chain is not
+    walked and the Binding goes in at its head*/
+    return SymTable_addBinding(oSymTable,
+      SymTable_bucket(oSymTable, uHash), pcKey, uLength, uHash, pvValue);
 }
 
 void *SymTable_replace(SymTable_T oSymTable,
   const char *pcKey, const void *pvValue){
 
-    size_t index;
+    size_t length;
+
+    assert(pcKey != NULL);
+
+    length = strlen(pcKey);
+    return SymTable_replaceHashed(oSymTable, pcKey, length,
+      StrHash_hash(pcKey, length), pvValue);
+}
+
+void *SymTable_replaceHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
     struct Binding *current;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    index = SymTable_hash(pcKey, (size_t) oSymTable->bucketsNum);
-    current = oSymTable->buckets[index];
+    if(oSymTable->snapshot != NULL) return NULL;
+    current = *SymTable_bucket(oSymTable, uHash);
 
     while(current != NULL){
-      if(strcmp(current->key, pcKey) == 0){
+      if(current->hash == uHash
+      && SymTable_keyEquals(SymTable_bindingKey(oSymTable, current),
+        pcKey, uLength)){
         void *temp = (void *) current->value;
         current->value = pvValue;
         return temp;
@@ -186,17 +490,32 @@ void *SymTable_replace(SymTable_T oSymTable,
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
 
-  size_t index;
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_containsHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+int SymTable_containsHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+
   struct Binding *current;
 
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
 
-  index = SymTable_hash(pcKey, (size_t) oSymTable->bucketsNum);
-  current = oSymTable->buckets[index];
+  if(oSymTable->snapshot != NULL)
+    return Snapshot_find(oSymTable->snapshot, pcKey, uLength, uHash)
+      != Snapshot_getLength(oSymTable->snapshot);
+  current = *SymTable_bucket(oSymTable, uHash);
 
   while(current != NULL){
-    if(strcmp(current->key, pcKey) == 0) return 1;      
+    if(current->hash == uHash
+    && SymTable_keyEquals(SymTable_bindingKey(oSymTable, current),
+      pcKey, uLength)) return 1;
     current = current->next;
   }
   return 0;
@@ -204,46 +523,245 @@ int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
 
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
 
-  size_t index;
-  struct Binding *current;
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_getHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_getHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+
+  struct Binding *found;
 
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
 
-  index = SymTable_hash(pcKey, (size_t) oSymTable->bucketsNum);
-  current = oSymTable->buckets[index];
+  if(oSymTable->snapshot != NULL){
+    size_t index = Snapshot_find(oSymTable->snapshot, pcKey, uLength,
+      uHash);
+    if(index == Snapshot_getLength(oSymTable->snapshot)) return NULL;
+    return Snapshot_value(oSymTable->snapshot, index);
+  }
+  SymTable_migrate(oSymTable, MIGRATE_STEP);
+  found = SymTable_lookup(oSymTable,
+    *SymTable_bucket(oSymTable, uHash), pcKey, uLength, uHash);
+  if(found == NULL) return NULL;
+  return (void *) found->value;
+}
 
-  while(current != NULL){
-    if(strcmp(current->key, pcKey) == 0) return (void *) current->value;
-    current = current->next;
+void SymTable_getBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  size_t uCount, void **ppvValues){
+
+  size_t lengths[BATCH_SIZE];
+  size_t hashes[BATCH_SIZE];
+  size_t start;
+  size_t count;
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  if(oSymTable->snapshot != NULL){
+    for(i = 0; i < uCount; i++)
+      ppvValues[i] = SymTable_get(oSymTable, ppcKeys[i]);
+    return;
   }
-  return NULL;
+
+  for(start = 0; start < uCount; start += count){
+    count = uCount - start;
+    if(count > BATCH_SIZE) count = BATCH_SIZE;
+
+    /*migrating moves Bindings between bucket arrays, so the whole
+    group's share is done before any bucket is prefetched*/
+    SymTable_migrate(oSymTable, MIGRATE_STEP * count);
+    SymTable_prefetchBatch(oSymTable, ppcKeys + start, count, lengths,
+      hashes);
+
+    for(i = 0; i < count; i++){
+      struct Binding *found = SymTable_lookup(oSymTable,
+        *SymTable_bucket(oSymTable, hashes[i]), ppcKeys[start + i],
+        lengths[i], hashes[i]);
+      ppvValues[start + i] = found == NULL ? NULL : (void *) found->value;
+    }
+  }
+}
+
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount){
+
+  size_t lengths[BATCH_SIZE];
+  size_t hashes[BATCH_SIZE];
+  size_t start;
+  size_t count;
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  for(start = 0; start < uCount; start += count){
+    count = uCount - start;
+    if(count > BATCH_SIZE) count = BATCH_SIZE;
+
+    /*a put in the middle of the group may start a resize and move
+    chains, which only makes some prefetches useless, not wrong*/
+    SymTable_prefetchBatch(oSymTable, ppcKeys + start, count, lengths,
+      hashes);
+    for(i = 0; i < count; i++)
+      added += (size_t) SymTable_putHashed(oSymTable, ppcKeys[start + i],
+        lengths[i], hashes[i], ppvValues[start + i]);
+  }
+  return added;
+}
+
+size_t SymTable_bulkLoad(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount, size_t uThreads){
+
+  struct Bulk bulk;
+  size_t num;
+  size_t start;
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  if(oSymTable->snapshot != NULL) return 0;
+  /*the table grows once, to fit every key, and the resize is finished
+  now, so that the threads below see a single bucket array that does
+  not change under them. Unlike SymTable_reserve this does not keep
+  the table from shrinking later*/
+  num = SymTable_bucketsFor(uCount > ((size_t) -1) - oSymTable->size
+    ? (size_t) -1 : oSymTable->size + uCount);
+  if(oSymTable->buckets == NULL){
+    /*a table with no bucket array yet gets one of the full size
+    straight away, or is left as it was for the puts to try*/
+    size_t oldNum = oSymTable->bucketsNum;
+    if(num > oldNum) oSymTable->bucketsNum = num;
+    if(!SymTable_allocBuckets(oSymTable)){
+      oSymTable->bucketsNum = oldNum;
+      return SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount);
+    }
+  }
+  else if(num > oSymTable->bucketsNum && !SymTable_resize(oSymTable, num))
+    return SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount);
+  SymTable_migrate(oSymTable, oSymTable->oldBucketsNum);
+
+  bulk.table = oSymTable;
+  bulk.count = uCount < BULK_CHUNK ? uCount : BULK_CHUNK;
+  bulk.bindings = (struct Binding **) malloc(bulk.count
+    * sizeof(struct Binding *));
+  bulk.added = (unsigned char *) malloc(bulk.count);
+  if(bulk.bindings == NULL || bulk.added == NULL){
+    free(bulk.bindings);
+    free(bulk.added);
+    return SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount);
+  }
+
+  for(start = 0; start < uCount; start += bulk.count){
+    if(bulk.count > uCount - start) bulk.count = uCount - start;
+
+    /*the arena is not shared between threads, so the Bindings are
+    made here. Copying the keys is all this loop does; hashing them and
+    walking the chains, where the time goes, is split up below*/
+    for(i = 0; i < bulk.count; i++){
+      const char *key = ppcKeys[start + i];
+      size_t length;
+      struct Binding *binding;
+
+      assert(key != NULL);
+      length = strlen(key);
+      binding = (struct Binding *) Arena_alloc(oSymTable->arena,
+        SymTable_bindingSize(oSymTable, length));
+      if(binding != NULL){
+        SymTable_storeKey(oSymTable, binding, key, length);
+        binding->value = ppvValues[start + i];
+        binding->next = NULL;
+      }
+      bulk.bindings[i] = binding;
+      bulk.added[i] = 0;
+    }
+
+    Parallel_run(Parallel_parts(uThreads, bulk.count, BULK_PART_MIN),
+      SymTable_bulkHash, &bulk);
+    Parallel_run(Parallel_parts(uThreads, oSymTable->bucketsNum,
+      BULK_PART_MIN), SymTable_bulkLink, &bulk);
+
+    /*the new Bindings join the list of all Bindings in the order of
+    the keys, as puts would have left them, and the duplicates are
+    given back*/
+    for(i = 0; i < bulk.count; i++){
+      struct Binding *binding = bulk.bindings[i];
+
+      if(binding == NULL) continue;
+      if(!bulk.added[i]){
+        Arena_release(oSymTable->arena, binding,
+          SymTable_bindingSize(oSymTable,
+          strlen(SymTable_bindingKey(oSymTable, binding))));
+        continue;
+      }
+      binding->prevAll = oSymTable->lastAll;
+      binding->nextAll = NULL;
+      if(oSymTable->lastAll != NULL) oSymTable->lastAll->nextAll = binding;
+      else oSymTable->firstAll = binding;
+      oSymTable->lastAll = binding;
+      added += 1;
+    }
+  }
+
+  free(bulk.bindings);
+  free(bulk.added);
+  oSymTable->size += added;
+  return added;
 }
 
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
 
-    size_t index;
+    size_t length;
+
+    assert(pcKey != NULL);
+
+    length = strlen(pcKey);
+    return SymTable_removeHashed(oSymTable, pcKey, length,
+      StrHash_hash(pcKey, length));
+}
+
+void *SymTable_removeHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+
+    struct Binding **bucket;
     struct Binding *current;
     struct Binding *before;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    index = SymTable_hash(pcKey, (size_t) oSymTable->bucketsNum);
-    current = oSymTable->buckets[index];
+    if(oSymTable->snapshot != NULL) return NULL;
+    SymTable_migrate(oSymTable, MIGRATE_STEP);
+    bucket = SymTable_bucket(oSymTable, uHash);
+    current = *bucket;
 
     /*empty table nothing to remove*/
     if(current == NULL) return NULL;
 
     /*if the starting Binding needs to be removed*/
-    if(strcmp(current->key, pcKey) == 0){
+    if(current->hash == uHash
+    && SymTable_keyEquals(SymTable_bindingKey(oSymTable, current),
+      pcKey, uLength)){
       void *val = (void *) current->value;
       struct Binding *after = current->next;
       /*updates starting Binding*/
-      oSymTable->buckets[index] = after;
-      free(current->key);
-      free(current);
+      *bucket = after;
+      SymTable_freeBinding(oSymTable, current);
       oSymTable->size -= 1;
+      SymTable_shrink(oSymTable);
       return val;
     }
 
@@ -253,15 +771,17 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
     current = current->next;
 
     while(current != NULL){
-      if(strcmp(current->key, pcKey) == 0){
+      if(current->hash == uHash
+      && SymTable_keyEquals(SymTable_bindingKey(oSymTable, current),
+        pcKey, uLength)){
         /*connects Bindings after removal*/
         void *Oldval = (void *) current->value;
         struct Binding *after = current->next;
         before->next = after;
         /*frees key and Binding, values untouched*/
-        free(current->key);
-        free(current);
+        SymTable_freeBinding(oSymTable, current);
         oSymTable->size -= 1;
+        SymTable_shrink(oSymTable);
         return Oldval;
       }
       before = current;
@@ -273,79 +793,617 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
 void SymTable_map(SymTable_T oSymTable,
   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
   const void *pvExtra){
-    int i;
+    struct Binding *current;
+    size_t i;
 
     assert(oSymTable != NULL); 
     assert(pfApply != NULL);
 
-    for(i = 0; i < oSymTable->bucketsNum; i++){
-      struct Binding *current = oSymTable->buckets[i];
-      if(current != NULL){
-        while(current != NULL){
-          (*pfApply)(current->key, (void *) current->value, (void *) pvExtra);
-          current = current->next;
-        }
-      }
+    if(oSymTable->snapshot != NULL){
+      for(i = 0; i < Snapshot_getLength(oSymTable->snapshot); i++)
+        (*pfApply)(Snapshot_key(oSymTable->snapshot, i),
+          Snapshot_value(oSymTable->snapshot, i), (void *) pvExtra);
+      return;
     }
+
+    /*walks the list of all Bindings, so empty buckets and an unfinished
+    resize cost nothing*/
+    for(current = oSymTable->firstAll; current != NULL;
+      current = current->nextAll)
+      (*pfApply)(SymTable_bindingKey(oSymTable, current),
+        (void *) current->value, (void *) pvExtra);
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra, size_t uThreads){
+
+  struct Visit visit;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  /*a table that was never put into has no bindings and no bucket
+  array to split*/
+  if(oSymTable->snapshot == NULL && oSymTable->buckets == NULL) return;
+  /*the list of all Bindings cannot be split without walking it, so
+  the threads split the bucket array instead, which a resize in
+  progress must not be spread over*/
+  SymTable_migrate(oSymTable, oSymTable->oldBucketsNum);
+  visit.table = oSymTable;
+  visit.apply = pfApply;
+  visit.extra = pvExtra;
+  Parallel_run(Parallel_parts(uThreads, oSymTable->snapshot != NULL
+    ? Snapshot_getLength(oSymTable->snapshot) : oSymTable->bucketsNum,
+    BULK_PART_MIN), SymTable_visitPart, &visit);
+}
+
+int SymTable_compact(SymTable_T oSymTable){
+  struct Binding **newBuckets;
+  struct Binding *current;
+  struct Binding *newLast = NULL;
+  struct Binding *newFirst = NULL;
+  Arena_T newArena;
+  size_t num;
+
+  assert(oSymTable != NULL);
+
+  /*a mapped table holds nothing but the mapping*/
+  if(oSymTable->snapshot != NULL) return 1;
+  /*the fewest buckets that keep the load at or under one. Reserved
+  capacity is given up too*/
+  num = SymTable_bucketsFor(oSymTable->size);
+
+  newArena = Arena_new();
+  if(newArena == NULL) return 0;
+  /*an empty table goes back to having no bucket array, as when it was
+  new*/
+  newBuckets = NULL;
+  if(oSymTable->size > 0){
+    newBuckets = (struct Binding **) calloc(num,
+      sizeof(struct Binding *));
+    if(newBuckets == NULL){
+      Arena_free(newArena);
+      return 0;
+    }
+  }
+
+  /*copies every Binding, oldest first, into the new arena so
+  that they are packed together and the old arena with all its
+  released blocks can be freed in one go*/
+  for(current = oSymTable->firstAll; current != NULL;
+    current = current->nextAll){
+    const char *key = SymTable_bindingKey(oSymTable, current);
+    size_t length = strlen(key);
+    struct Binding *copy;
+    size_t index;
+
+    copy = (struct Binding *) Arena_alloc(newArena,
+      SymTable_bindingSize(oSymTable, length));
+    if(copy == NULL){
+      Arena_free(newArena);
+      free(newBuckets);
+      return 0;
+    }
+    SymTable_storeKey(oSymTable, copy, key, length);
+    copy->hash = current->hash;
+    copy->value = current->value;
+
+    index = copy->hash & (num - 1);
+    copy->next = newBuckets[index];
+    newBuckets[index] = copy;
+
+    copy->prevAll = newLast;
+    copy->nextAll = NULL;
+    if(newLast != NULL) newLast->nextAll = copy;
+    else newFirst = copy;
+    newLast = copy;
   }
 
-static SymTable_T SymTable_resize(SymTable_T oSymTable){
-  SymTable_T newTable;
-  int i;
-  int size;
+  /*nothing can fail from here on, so the old storage is dropped,
+  including the bucket array of any resize in progress*/
+  Arena_free(oSymTable->arena);
+  if(oSymTable->oldBuckets != NULL) free(oSymTable->oldBuckets);
+  free(oSymTable->buckets);
+  oSymTable->arena = newArena;
+  oSymTable->buckets = newBuckets;
+  oSymTable->bucketsNum = num;
+  oSymTable->oldBuckets = NULL;
+  oSymTable->oldBucketsNum = 0;
+  oSymTable->migrated = 0;
+  oSymTable->firstAll = newFirst;
+  oSymTable->lastAll = newLast;
+  oSymTable->minBucketsNum = BUCKET_COUNT;
+  return 1;
+}
+
+int SymTable_save(SymTable_T oSymTable, const char *pcPath){
+  SnapshotWriter_T writer;
 
   assert(oSymTable != NULL);
-  size = oSymTable->bucketsNum;
+  assert(pcPath != NULL);
+
+  writer = SnapshotWriter_new(SymTable_getLength(oSymTable));
+  if(writer == NULL) return 0;
+  SymTable_map(oSymTable, SnapshotWriter_add, writer);
+  return SnapshotWriter_finish(writer, pcPath);
+}
 
-  newTable = (SymTable_T) malloc(sizeof(struct SymTable));
-  if(newTable == NULL) return NULL;
+SymTable_T SymTable_openMapped(const char *pcPath){
+  Snapshot_T snapshot;
+  SymTable_T table;
 
-  /*determines size of newTable based on sizes and conditions given
-  in assignments*/
-  if (size == 509) size = 1021;
-  else if(size == 1021) size = 2039;
-  else if (size == 2039) size = 4093;
-  else if (size == 4093) size = 8191;
-  else if (size == 8191) size = 16381;
-  else if (size == 16381) size = 32749;
-  else size = 65521;
+  assert(pcPath != NULL);
 
-  /* allocates memory for array of pointers based on the new number of buckets*/
-  newTable->buckets = (struct Binding **) calloc((size_t) size, sizeof(struct Binding *));
-  if(newTable->buckets == NULL){
-    free(newTable);
+  snapshot = Snapshot_open(pcPath);
+  if(snapshot == NULL) return NULL;
+  /*the table itself stays empty, without even a bucket array. Nothing
+  is read from the file until a key is looked up*/
+  table = SymTable_new();
+  if(table == NULL){
+    Snapshot_close(snapshot);
     return NULL;
-  } 
-  /*assigns rest of values of newTable*/
-  newTable->bucketsNum = size;
-  newTable->size = 0;
-
-  /*re-adds all bindings from previous table into new table*/
-  for(i = 0; i < oSymTable->bucketsNum; i++){
-    struct Binding *current = oSymTable->buckets[i];
-    if(current != NULL){
-      while(current != NULL){
-        SymTable_put(newTable, current->key, current->value);
-        current = current->next;
-      }
+  }
+  table->snapshot = snapshot;
+  return table;
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable,
+  struct SymTable_Iter *psIter){
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+
+  psIter->table = oSymTable;
+  psIter->position = oSymTable->firstAll;
+  psIter->index = 0;
+}
+
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+  void **ppvValue){
+  struct Binding *current;
+
+  assert(psIter != NULL);
+  assert(ppcKey != NULL);
+  assert(ppvValue != NULL);
+
+  /*a mapped table is traversed by entry index*/
+  if(psIter->table->snapshot != NULL){
+    if(psIter->index == Snapshot_getLength(psIter->table->snapshot))
+      return 0;
+    *ppcKey = Snapshot_key(psIter->table->snapshot, psIter->index);
+    *ppvValue = Snapshot_value(psIter->table->snapshot, psIter->index);
+    psIter->index += 1;
+    return 1;
+  }
+  current = (struct Binding *) psIter->position;
+  if(current == NULL) return 0;
+  *ppcKey = SymTable_bindingKey(psIter->table, current);
+  *ppvValue = (void *) current->value;
+  psIter->position = current->nextAll;
+  return 1;
+}
+
+int SymTable_getStats(SymTable_T oSymTable,
+  struct SymTable_Stats *psStats){
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+
+#ifdef SYMTABLE_STATS
+  *psStats = oSymTable->stats;
+  memset(psStats->chains, 0, sizeof(psStats->chains));
+  /*old buckets not migrated yet still hold their chains, and migrated
+  ones are empty, so only the former are counted. Buckets not
+  allocated yet count as the empty buckets they look like*/
+  if(oSymTable->buckets == NULL)
+    psStats->chains[0] += oSymTable->bucketsNum;
+  else
+    SymTable_countChains(psStats, oSymTable->buckets, 0,
+      oSymTable->bucketsNum);
+  if(oSymTable->oldBuckets != NULL)
+    SymTable_countChains(psStats, oSymTable->oldBuckets,
+      oSymTable->migrated, oSymTable->oldBucketsNum);
+  psStats->bytes = sizeof(struct SymTable)
+    + ((oSymTable->buckets != NULL ? oSymTable->bucketsNum : 0)
+      + oSymTable->oldBucketsNum) * sizeof(struct Binding *)
+    + Arena_getBytes(oSymTable->arena);
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+static int SymTable_allocBuckets(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+  assert(oSymTable->buckets == NULL);
+
+  oSymTable->buckets = (struct Binding **) calloc(oSymTable->bucketsNum,
+    sizeof(struct Binding *));
+  return oSymTable->buckets != NULL;
+}
+
+static size_t SymTable_bucketsFor(size_t uCapacity){
+  size_t num = BUCKET_COUNT;
+
+  /*a put grows the table once size passes the bucket count*/
+  while(num < uCapacity){
+    if(num > ((size_t) -1) / 2 / sizeof(struct Binding *)) return 0;
+    num *= 2;
+  }
+  return num;
+}
+
+static int SymTable_resize(SymTable_T oSymTable, size_t uBucketsNum){
+  struct Binding **newBuckets;
+#ifdef SYMTABLE_STATS
+  clock_t start;
+#endif
+
+  assert(oSymTable != NULL);
+  assert(oSymTable->buckets != NULL);
+  assert(uBucketsNum >= BUCKET_COUNT);
+  assert((uBucketsNum & (uBucketsNum - 1)) == 0);
+
+  /*a resize still in progress is finished first so that there are
+  never more than two bucket arrays*/
+  if(oSymTable->oldBuckets != NULL)
+    SymTable_migrate(oSymTable, oSymTable->oldBucketsNum);
+
+  /* allocates memory for array of pointers based on the new number of buckets*/
+#ifdef SYMTABLE_STATS
+  start = clock();
+#endif
+  newBuckets = (struct Binding **) calloc(uBucketsNum,
+    sizeof(struct Binding *));
+  if(newBuckets == NULL) return 0;
+
+  /*the current array becomes the old one and is emptied by later
+  calls, so this call costs only the allocation*/
+  oSymTable->oldBuckets = oSymTable->buckets;
+  oSymTable->oldBucketsNum = oSymTable->bucketsNum;
+  oSymTable->migrated = 0;
+  oSymTable->buckets = newBuckets;
+  oSymTable->bucketsNum = uBucketsNum;
+  SymTable_count(oSymTable, resizes, 1);
+  SymTable_count(oSymTable, resizeSeconds,
+    (double) (clock() - start) / CLOCKS_PER_SEC);
+  return 1;
+}
+
+static void SymTable_shrink(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+
+  /*waiting for a resize in progress to finish, rather than finishing
+  it here, keeps a run of removes from ever pausing for a whole
+  migration. Removes migrate as they go, so the wait is short*/
+  if(oSymTable->oldBuckets != NULL) return;
+  if(oSymTable->bucketsNum <= oSymTable->minBucketsNum) return;
+  if(oSymTable->size >= oSymTable->bucketsNum / SHRINK_DIVISOR) return;
+  (void) SymTable_resize(oSymTable, oSymTable->bucketsNum / 2);
+}
+
+static void SymTable_migrate(SymTable_T oSymTable, size_t uSteps){
+  size_t mask;
+#ifdef SYMTABLE_STATS
+  clock_t start;
+#endif
+
+  assert(oSymTable != NULL);
+
+  if(oSymTable->oldBuckets == NULL) return;
+#ifdef SYMTABLE_STATS
+  start = clock();
+#endif
+  mask = oSymTable->bucketsNum - 1;
+
+  /*moves every Binding of the next old buckets to the front of its new
+  bucket. Bindings and keys are reused as they are, only next pointers
+  change, and the stored hash means no key is hashed again. This works
+  the same way when the new array is smaller, since SymTable_bucket
+  only sends a hash to the new array once its old bucket is empty*/
+  while(uSteps > 0 && oSymTable->migrated < oSymTable->oldBucketsNum){
+    struct Binding *current = oSymTable->oldBuckets[oSymTable->migrated];
+    while(current != NULL){
+      struct Binding *after = current->next;
+      size_t index = current->hash & mask;
+      current->next = oSymTable->buckets[index];
+      oSymTable->buckets[index] = current;
+      current = after;
     }
+    oSymTable->oldBuckets[oSymTable->migrated] = NULL;
+    oSymTable->migrated += 1;
+    uSteps -= 1;
   }
-  /*completely frees all memory associated inside old table but not
-  table itself*/
-  SymTable_freeInside(oSymTable);
-  return newTable;
+
+  /*only the old array of pointers is freed*/
+  if(oSymTable->migrated == oSymTable->oldBucketsNum){
+    free(oSymTable->oldBuckets);
+    oSymTable->oldBuckets = NULL;
+    oSymTable->oldBucketsNum = 0;
+    oSymTable->migrated = 0;
+  }
+  SymTable_count(oSymTable, resizeSeconds,
+    (double) (clock() - start) / CLOCKS_PER_SEC);
 }
 
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount)
-{
-   const size_t HASH_MULTIPLIER = 65599;
-   size_t u;
-   size_t uHash = 0;
+static struct Binding **SymTable_bucket(SymTable_T oSymTable,
+  size_t uHash){
+  assert(oSymTable != NULL);
 
-   assert(pcKey != NULL);
+  if(oSymTable->buckets == NULL) return &SymTable_emptyBucket;
+  if(oSymTable->oldBuckets != NULL){
+    size_t oldIndex = uHash & (oSymTable->oldBucketsNum - 1);
+    if(oldIndex >= oSymTable->migrated)
+      return &oSymTable->oldBuckets[oldIndex];
+  }
+  return &oSymTable->buckets[uHash & (oSymTable->bucketsNum - 1)];
+}
 
-   for (u = 0; pcKey[u] != '\0'; u++)
-      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+size_t SymTable_hash(const char *pcKey, size_t uLength){
+  assert(pcKey != NULL);
+  return StrHash_hash(pcKey, uLength);
+}
 
-   return uHash % uBucketCount;
-}
\ No newline at end of file
+static struct Binding *SymTable_chainFind(SymTable_T oSymTable,
+  struct Binding *oFirst, const char *pcKey, size_t uLength,
+  size_t uHash){
+  struct Binding *current;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  for(current = oFirst; current != NULL; current = current->next)
+    if(current->hash == uHash
+    && SymTable_keyEquals(SymTable_bindingKey(oSymTable, current),
+      pcKey, uLength)) return current;
+  return NULL;
+}
+
+static struct Binding *SymTable_lookup(SymTable_T oSymTable,
+  struct Binding *oFirst, const char *pcKey, size_t uLength,
+  size_t uHash){
+#ifdef SYMTABLE_STATS
+  struct Binding *current;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /*the walk of SymTable_chainFind, counting each Binding looked at*/
+  oSymTable->stats.gets += 1;
+  for(current = oFirst; current != NULL; current = current->next){
+    oSymTable->stats.getProbes += 1;
+    if(current->hash == uHash
+    && SymTable_keyEquals(SymTable_bindingKey(oSymTable, current),
+      pcKey, uLength)){
+      oSymTable->stats.hits += 1;
+      return current;
+    }
+  }
+  oSymTable->stats.misses += 1;
+  return NULL;
+#else
+  return SymTable_chainFind(oSymTable, oFirst, pcKey, uLength, uHash);
+#endif
+}
+
+static void SymTable_prefetchBatch(SymTable_T oSymTable,
+  const char *const *ppcKeys, size_t uCount, size_t *puLengths,
+  size_t *puHashes){
+  struct Binding **buckets[BATCH_SIZE];
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(uCount <= BATCH_SIZE);
+
+  /*every bucket head is requested before any of them is read*/
+  for(i = 0; i < uCount; i++){
+    assert(ppcKeys[i] != NULL);
+    puLengths[i] = strlen(ppcKeys[i]);
+    puHashes[i] = StrHash_hash(ppcKeys[i], puLengths[i]);
+    buckets[i] = SymTable_bucket(oSymTable, puHashes[i]);
+    SymTable_prefetch(buckets[i]);
+  }
+  /*then the first Binding of every chain, whose address the heads
+  give*/
+  for(i = 0; i < uCount; i++)
+    if(*buckets[i] != NULL) SymTable_prefetch(*buckets[i]);
+}
+
+static int SymTable_keyEquals(const char *pcStored, const char *pcKey,
+  size_t uLength){
+  /*a borrowed key looked up by the same pointer, an interned one say,
+  is equal without reading its bytes*/
+  if(pcStored == pcKey) return pcStored[uLength] == '\0';
+  /*strncmp stops at the end of pcStored, so a shorter stored key is
+  never read past its '\0'*/
+  return strncmp(pcStored, pcKey, uLength) == 0 && pcStored[uLength] == '\0';
+}
+
+static void SymTable_freeBinding(SymTable_T oSymTable,
+  struct Binding *oBinding){
+  assert(oSymTable != NULL);
+  assert(oBinding != NULL);
+
+  if(oBinding->prevAll != NULL)
+    oBinding->prevAll->nextAll = oBinding->nextAll;
+  else oSymTable->firstAll = oBinding->nextAll;
+  if(oBinding->nextAll != NULL)
+    oBinding->nextAll->prevAll = oBinding->prevAll;
+  else oSymTable->lastAll = oBinding->prevAll;
+
+  Arena_release(oSymTable->arena, oBinding, SymTable_bindingSize(oSymTable,
+    strlen(SymTable_bindingKey(oSymTable, oBinding))));
+}
+
+static int SymTable_addBinding(SymTable_T oSymTable,
+  struct Binding **ppLink, const char *pcKey, size_t uLength,
+  size_t uHash, const void *pvValue){
+  struct Binding *end;
+
+  assert(oSymTable != NULL);
+  assert(ppLink != NULL);
+  assert(pcKey != NULL);
+
+  end = (struct Binding *) Arena_alloc(oSymTable->arena,
+    SymTable_bindingSize(oSymTable, uLength));
+  if(end == NULL) return 0;
+  /*defensive copy of key, into the Binding, unless it is borrowed*/
+  SymTable_storeKey(oSymTable, end, pcKey, uLength);
+  /*assigns values of Binding end*/
+  end->hash = uHash;
+  end->value = pvValue;
+  end->next = *ppLink;
+  *ppLink = end;
+  /*appends end to the list of all Bindings*/
+  end->prevAll = oSymTable->lastAll;
+  end->nextAll = NULL;
+  if(oSymTable->lastAll != NULL) oSymTable->lastAll->nextAll = end;
+  else oSymTable->firstAll = end;
+  oSymTable->lastAll = end;
+  oSymTable->size += 1;
+
+  /*resizes symtable once there are more bindings than buckets, so
+  the average chain stays under one Binding at any size. A failed
+  resize leaves the table valid, just more loaded*/
+  if(oSymTable->size > oSymTable->bucketsNum
+  && oSymTable->bucketsNum <= ((size_t) -1) / 2 / sizeof(struct Binding *))
+    (void) SymTable_resize(oSymTable, oSymTable->bucketsNum * 2);
+  return 1;
+}
+
+static size_t SymTable_bindingSize(SymTable_T oSymTable, size_t uLength){
+  assert(oSymTable != NULL);
+
+  if(oSymTable->borrowed)
+    return sizeof(struct Binding) + sizeof(const char *);
+  return sizeof(struct Binding) + sizeof(char) * (uLength + 1);
+}
+
+static void SymTable_storeKey(SymTable_T oSymTable,
+  struct Binding *oBinding, const char *pcKey, size_t uLength){
+  assert(oSymTable != NULL);
+  assert(oBinding != NULL);
+  assert(pcKey != NULL);
+
+  /*the pointer is copied bytewise since key need not be aligned for
+  one*/
+  if(oSymTable->borrowed){
+    memcpy(oBinding->key, &pcKey, sizeof(const char *));
+    return;
+  }
+  memcpy(oBinding->key, pcKey, uLength);
+  oBinding->key[uLength] = '\0';
+}
+
+static const char *SymTable_bindingKey(SymTable_T oSymTable,
+  const struct Binding *oBinding){
+  const char *key;
+
+  assert(oSymTable != NULL);
+  assert(oBinding != NULL);
+
+  if(!oSymTable->borrowed) return oBinding->key;
+  memcpy(&key, oBinding->key, sizeof(const char *));
+  return key;
+}
+
+static void SymTable_bulkHash(size_t uPart, size_t uParts, void *pvBulk){
+  struct Bulk *bulk = (struct Bulk *) pvBulk;
+  size_t end;
+  size_t i;
+
+  assert(bulk != NULL);
+
+  end = Parallel_begin(bulk->count, uPart + 1, uParts);
+  for(i = Parallel_begin(bulk->count, uPart, uParts); i < end; i++){
+    struct Binding *binding = bulk->bindings[i];
+    if(binding != NULL){
+      const char *key = SymTable_bindingKey(bulk->table, binding);
+      binding->hash = StrHash_hash(key, strlen(key));
+    }
+  }
+}
+
+static void SymTable_bulkLink(size_t uPart, size_t uParts, void *pvBulk){
+  struct Bulk *bulk = (struct Bulk *) pvBulk;
+  struct Binding **buckets;
+  size_t mask;
+  size_t first;
+  size_t end;
+  size_t i;
+
+  assert(bulk != NULL);
+  assert(bulk->table->oldBuckets == NULL);
+
+  buckets = bulk->table->buckets;
+  mask = bulk->table->bucketsNum - 1;
+  first = Parallel_begin(bulk->table->bucketsNum, uPart, uParts);
+  end = Parallel_begin(bulk->table->bucketsNum, uPart + 1, uParts);
+
+  /*every part reads all the hashes but walks only its own chains, so
+  the keys of one bucket are still taken in order and the first of a
+  repeated key is the one kept*/
+  for(i = 0; i < bulk->count; i++){
+    struct Binding *binding = bulk->bindings[i];
+    const char *key;
+    size_t index;
+
+    if(binding == NULL) continue;
+    index = binding->hash & mask;
+    if(index < first || index >= end) continue;
+    key = SymTable_bindingKey(bulk->table, binding);
+    if(SymTable_chainFind(bulk->table, buckets[index], key, strlen(key),
+      binding->hash) != NULL) continue;
+    binding->next = buckets[index];
+    buckets[index] = binding;
+    bulk->added[i] = 1;
+  }
+}
+
+static void SymTable_visitPart(size_t uPart, size_t uParts,
+  void *pvVisit){
+  struct Visit *visit = (struct Visit *) pvVisit;
+  struct Binding *current;
+  size_t end;
+  size_t i;
+
+  assert(visit != NULL);
+
+  /*the parts of a snapshot are runs of its entries*/
+  if(visit->table->snapshot != NULL){
+    Snapshot_T snapshot = visit->table->snapshot;
+    end = Parallel_begin(Snapshot_getLength(snapshot), uPart + 1, uParts);
+    for(i = Parallel_begin(Snapshot_getLength(snapshot), uPart, uParts);
+      i < end; i++)
+      (*visit->apply)(Snapshot_key(snapshot, i),
+        Snapshot_value(snapshot, i), (void *) visit->extra);
+    return;
+  }
+
+  end = Parallel_begin(visit->table->bucketsNum, uPart + 1, uParts);
+  for(i = Parallel_begin(visit->table->bucketsNum, uPart, uParts);
+    i < end; i++)
+    for(current = visit->table->buckets[i]; current != NULL;
+      current = current->next)
+      (*visit->apply)(SymTable_bindingKey(visit->table, current),
+        (void *) current->value, (void *) visit->extra);
+}
+
+#ifdef SYMTABLE_STATS
+static void SymTable_countChains(struct SymTable_Stats *psStats,
+  struct Binding **ppBuckets, size_t uFirst, size_t uEnd){
+  size_t i;
+
+  assert(psStats != NULL);
+  assert(ppBuckets != NULL);
+
+  for(i = uFirst; i < uEnd; i++){
+    struct Binding *current;
+    size_t length = 0;
+
+    for(current = ppBuckets[i]; current != NULL; current = current->next)
+      length += 1;
+    if(length >= SYMTABLE_STATS_CHAINS) length = SYMTABLE_STATS_CHAINS - 1;
+    psStats->chains[length] += 1;
+  }
+}
+#endif
@@ -2,16 +2,46 @@
 /* symtablelist.c                                                     */
 /* Author: Sevastian Venegas                                          */
 /*--------------------------------------------------------------------*/
+
+/*Compiled with SYMTABLELIST_MOVE_TO_FRONT defined, SymTable_get moves
+the Node it finds to the front of the list, and with
+SYMTABLELIST_TRANSPOSE it swaps it with the Node before it, so that
+keys looked up often end up near the front and cost few comparisons.
+Move-to-front adapts at once to a change of which keys are hot;
+transpose moves a key one place per lookup, so a key looked up once
+disturbs the order less. Either way SymTable_get reorders the list, so
+it must not be called during a traversal of the same table with
+SymTable_map or SymTable_iterNext. Without either, the list keeps the
+order the keys were put in (make LISTFLAGS=..., see the Makefile).*/
+
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include "symtable.h"
+#include "arena.h"
+#include "strhash.h"
+
+#if defined(SYMTABLELIST_MOVE_TO_FRONT) && defined(SYMTABLELIST_TRANSPOSE)
+#error "SYMTABLELIST_MOVE_TO_FRONT and SYMTABLELIST_TRANSPOSE conflict"
+#endif
+
+/*SymTable_count adds uAmount to the statistic field of oSymTable if
+the table keeps statistics, and compiles to nothing otherwise*/
+#ifdef SYMTABLE_STATS
+#define SymTable_count(oSymTable, field, uAmount) \
+  ((oSymTable)->stats.field += (uAmount))
+#else
+#define SymTable_count(oSymTable, field, uAmount) ((void) 0)
+#endif
 
 /* A Node is a pair of key and value which is setup to be a linked list
 with Node *next pointing to following Node*/
 struct Node {
-  /*key used to identify Node*/
-  char *key;
+  /*hash is the full hash of key, compared before the key itself*/
+  size_t hash;
+  /*key used to identify Node, a copy in the arena or, if the table
+  borrows its keys, the caller's own*/
+  const char *key;
   /*value of Node*/
   const void *value;
   /*pointer pointing to next node in linked list*/
@@ -23,36 +53,104 @@ linked list*/
 struct SymTable{
   /*first points to first Node in linked list*/
   struct Node *first;
+  /*last points to last Node in linked list, or is NULL if it is empty,
+  so that a Node is appended without walking the list*/
+  struct Node *last;
   /*size is number of key value pairs or Nodes*/
   size_t size;
+  /*arena holds every Node and key copy of the table, so they can be
+  freed all at once*/
+  Arena_T arena;
+  /*borrowed is 1 (TRUE) if the table keeps the caller's key pointers
+  instead of copying the keys*/
+  int borrowed;
+#ifdef SYMTABLE_STATS
+  /*stats are the counts SymTable_getStats reports. Its chains and
+  bytes are only filled in when it is called*/
+  struct SymTable_Stats stats;
+#endif
 };
 
+/*Returns 1 (TRUE) if the '\0' terminated key pcStored is the same as
+the uLength bytes at pcKey, or 0 (FALSE) otherwise.*/
+static int SymTable_keyEquals(const char *pcStored, const char *pcKey,
+  size_t uLength);
+
+/*Returns the key oSymTable stores for the uLength bytes at pcKey:
+pcKey itself if oSymTable borrows its keys, otherwise a '\0'
+terminated copy from oArena, or NULL if insufficient memory is
+available.*/
+static const char *SymTable_storeKey(SymTable_T oSymTable,
+  Arena_T oArena, const char *pcKey, size_t uLength);
+
+/*Appends a new Node, with a copy of the uLength bytes at pcKey (or
+pcKey itself if oSymTable borrows its keys), hash uHash and value
+pvValue, to the end of the list of oSymTable without looking for the
+key. Returns 1 (TRUE) on success, or 0 (FALSE) if insufficient memory
+is available.*/
+static int SymTable_append(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue);
+
+/*Gives the key copy and Node oNode back to the arena of oSymTable. The
+value is untouched.*/
+static void SymTable_freeNode(SymTable_T oSymTable, struct Node *oNode);
+
+/*Moves oNode, just found by SymTable_get after oBefore and oBeforeThat
+(either NULL if there is no such Node), toward the front of the list of
+oSymTable as the mode the file was compiled in asks, or leaves it where
+it is if there is none.*/
+static void SymTable_promote(SymTable_T oSymTable,
+  struct Node *oBeforeThat, struct Node *oBefore, struct Node *oNode);
+
 SymTable_T SymTable_new(void){
+  return SymTable_newWithCapacity(0);
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity){
   SymTable_T table;
+
+  /*a list has no buckets to size, and its arena already grows in
+  chunks that double, so the hint changes nothing*/
+  (void) uCapacity;
   table = (SymTable_T) malloc(sizeof(struct SymTable));
   if(table == NULL) return NULL;
+  table->arena = Arena_new();
+  if(table->arena == NULL){
+    free(table);
+    return NULL;
+  }
   /*sets table to an empty symtable*/
   table->first = NULL;
+  table->last = NULL;
   table->size = 0;
+  table->borrowed = 0;
+#ifdef SYMTABLE_STATS
+  memset(&table->stats, 0, sizeof(table->stats));
+#endif
   return table;
 }
 
-void SymTable_free(SymTable_T oSymTable){
+SymTable_T SymTable_newBorrowed(void){
+  SymTable_T table = SymTable_new();
 
-  struct Node *current;
+  if(table != NULL) table->borrowed = 1;
+  return table;
+}
 
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity){
   assert(oSymTable != NULL);
-  current = oSymTable->first;
 
-  while(current != NULL){
-    /* temp is temporary only used to free node*/
-    struct Node *temp = current;
-    current = current->next;
+  /*nothing to reserve in a list, see SymTable_newWithCapacity*/
+  (void) uCapacity;
+  return 1;
+}
 
-    /*frees key and node, values untouched*/
-    free(temp->key);
-    free(temp);
-  }
+void SymTable_free(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+
+  /*every key and node lives in the arena, so the list is not walked.
+  Values untouched*/
+  Arena_free(oSymTable->arena);
   free(oSymTable);
 }
 
@@ -64,53 +162,74 @@ size_t SymTable_getLength(SymTable_T oSymTable){
 int SymTable_put(SymTable_T oSymTable,
   const char *pcKey, const void *pvValue){
 
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
   struct Node *current;
-  struct Node *end;
-  char *newKey;
 
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
 
-  current = oSymTable->first;
+  SymTable_count(oSymTable, puts, 1);
 
-  if(current != NULL) {
-    /*updates current until we are at the last node and 
-    checks if there is duplicate key*/
-    while(current->next != NULL){
-      if(strcmp(current->key, pcKey) == 0) return 0;
-      current = current->next;
-    }
-    /*special case where table only has one binding and
-    there is an attempt to add binding with same key*/
-    if(strcmp(current->key, pcKey) == 0) return 0;
+  /*checks every node for a duplicate key. The walk is all that is
+  left of the cost of a put, since the new node is appended through
+  last*/
+  for(current = oSymTable->first; current != NULL;
+    current = current->next){
+    SymTable_count(oSymTable, putProbes, 1);
+    if(current->hash == uHash
+    && SymTable_keyEquals(current->key, pcKey, uLength)) return 0;
   }
+  return SymTable_append(oSymTable, pcKey, uLength, uHash, pvValue);
+}
 
-  /*creates a new node end which will be potentially 
-  added to end of linked list*/
-  end = (struct Node *) malloc(sizeof(struct Node));
-  if(end == NULL) return 0;
-  /*defensive copy of key*/
-  newKey = (char *) malloc(sizeof(char) * (strlen(pcKey) + 1));
-  if(newKey == NULL){
-    free(end);
-    return 0;
-  }
-  /*assigns values of Node end*/
-  strcpy(newKey, pcKey);
-  end->key = newKey;
-  end->value = pvValue;
-  end->next = NULL;
+int SymTable_putUnique(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
 
-  /*adds end as first node if list is currently empty*/
-  if(current == NULL) oSymTable->first = end;
-  /*adds end node to end of linked list*/
-  else current->next = end;
-  oSymTable->size += 1;
-  return 1;
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putUniqueHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putUniqueHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /*the caller vouches that the key is new, so no node is looked at*/
+  SymTable_count(oSymTable, puts, 1);
+  return SymTable_append(oSymTable, pcKey, uLength, uHash, pvValue);
 }
 
 void *SymTable_replace(SymTable_T oSymTable,
   const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_replaceHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+void *SymTable_replaceHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
   
   struct Node *current;
 
@@ -119,7 +238,8 @@ void *SymTable_replace(SymTable_T oSymTable,
   current = oSymTable->first;
 
   while(current != NULL){
-    if(strcmp(current->key, pcKey) == 0){
+    if(current->hash == uHash
+    && SymTable_keyEquals(current->key, pcKey, uLength)){
       void *oldValue = (void *) current->value;
       current->value = pvValue;
       return oldValue;
@@ -130,6 +250,17 @@ void *SymTable_replace(SymTable_T oSymTable,
 }
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_containsHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+int SymTable_containsHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
   struct Node *current;
 
   assert(oSymTable != NULL);
@@ -137,28 +268,65 @@ int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
   current = oSymTable->first;
 
   while(current != NULL){
-    if(strcmp(current->key, pcKey) == 0) return 1;
+    if(current->hash == uHash
+    && SymTable_keyEquals(current->key, pcKey, uLength)) return 1;
     current = current->next;
   }
   return 0;
 }
 
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_getHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_getHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
   struct Node *current;
+  struct Node *before = NULL;
+  struct Node *beforeThat = NULL;
 
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
   
+  SymTable_count(oSymTable, gets, 1);
   current = oSymTable->first;
 
+  /*the two Nodes before current are kept so that it can be moved
+  forward once found*/
   while(current != NULL){
-    if(strcmp(current->key, pcKey) == 0) return (void *)current->value;
+    SymTable_count(oSymTable, getProbes, 1);
+    if(current->hash == uHash
+    && SymTable_keyEquals(current->key, pcKey, uLength)){
+      SymTable_count(oSymTable, hits, 1);
+      SymTable_promote(oSymTable, beforeThat, before, current);
+      return (void *)current->value;
+    }
+    beforeThat = before;
+    before = current;
     current = current->next;
   }
+  SymTable_count(oSymTable, misses, 1);
   return NULL;
 }
 
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_removeHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_removeHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
   struct Node *current;
   struct Node *before;
 
@@ -171,13 +339,14 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
   if(current == NULL) return NULL;
 
   /*if the starting node needs to be removed*/
-  if(strcmp(current->key, pcKey) == 0){
+  if(current->hash == uHash
+  && SymTable_keyEquals(current->key, pcKey, uLength)){
     void *val = (void *) current->value;
     struct Node *after = current->next;
     /*updates starting node*/
     oSymTable->first = after;
-    free(current->key);
-    free(current);
+    if(after == NULL) oSymTable->last = NULL;
+    SymTable_freeNode(oSymTable, current);
     oSymTable->size -= 1;
     return val;
   }
@@ -188,16 +357,17 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
   current = current->next;
 
   while(current != NULL){
-    if(strcmp(current->key, pcKey) == 0){
+    if(current->hash == uHash
+    && SymTable_keyEquals(current->key, pcKey, uLength)){
       /*connects nodes after removal*/
       void *Oldval = (void *) current->value;
       struct Node *after = current->next;
       before->next = after;
+      if(after == NULL) oSymTable->last = before;
       oSymTable->size -= 1;
 
       /*frees key and node, values untouched*/
-      free(current->key);
-      free(current);
+      SymTable_freeNode(oSymTable, current);
       return Oldval;
     }
     before = current;
@@ -207,6 +377,44 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
 
 }
 
+void SymTable_getBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  size_t uCount, void **ppvValues){
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  /*each lookup walks the one list node by node, so there is nothing
+  independent to prefetch ahead and the keys are looked up in turn*/
+  for(i = 0; i < uCount; i++)
+    ppvValues[i] = SymTable_get(oSymTable, ppcKeys[i]);
+}
+
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount){
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  for(i = 0; i < uCount; i++)
+    added += (size_t) SymTable_put(oSymTable, ppcKeys[i], ppvValues[i]);
+  return added;
+}
+
+size_t SymTable_bulkLoad(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount, size_t uThreads){
+  assert(oSymTable != NULL);
+
+  /*every put walks the one list to look for its key, so there is no
+  part of the work that threads could take on their own*/
+  (void) uThreads;
+  return SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount);
+}
+
 void SymTable_map(SymTable_T oSymTable,
   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
   const void *pvExtra){
@@ -222,4 +430,203 @@ void SymTable_map(SymTable_T oSymTable,
     current = current->next;
   }
   
-}
\ No newline at end of file
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra, size_t uThreads){
+  assert(oSymTable != NULL);
+
+  /*a linked list cannot be split without walking it first*/
+  (void) uThreads;
+  SymTable_map(oSymTable, pfApply, pvExtra);
+}
+
+int SymTable_compact(SymTable_T oSymTable){
+  struct Node *current;
+  struct Node *newFirst = NULL;
+  struct Node *newLast = NULL;
+  Arena_T newArena;
+
+  assert(oSymTable != NULL);
+
+  newArena = Arena_new();
+  if(newArena == NULL) return 0;
+
+  /*copies every Node and key, in list order, into the new arena so
+  that they are packed together and the old arena with all its
+  released blocks can be freed in one go. Borrowed keys stay where
+  they are*/
+  for(current = oSymTable->first; current != NULL;
+    current = current->next){
+    struct Node *copy;
+
+    copy = (struct Node *) Arena_alloc(newArena, sizeof(struct Node));
+    if(copy == NULL){
+      Arena_free(newArena);
+      return 0;
+    }
+    copy->key = SymTable_storeKey(oSymTable, newArena, current->key,
+      strlen(current->key));
+    if(copy->key == NULL){
+      Arena_free(newArena);
+      return 0;
+    }
+    copy->hash = current->hash;
+    copy->value = current->value;
+    copy->next = NULL;
+
+    if(newLast != NULL) newLast->next = copy;
+    else newFirst = copy;
+    newLast = copy;
+  }
+
+  Arena_free(oSymTable->arena);
+  oSymTable->arena = newArena;
+  oSymTable->first = newFirst;
+  oSymTable->last = newLast;
+  return 1;
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable,
+  struct SymTable_Iter *psIter){
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+
+  psIter->table = oSymTable;
+  psIter->position = oSymTable->first;
+  psIter->index = 0;
+}
+
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+  void **ppvValue){
+  struct Node *current;
+
+  assert(psIter != NULL);
+  assert(ppcKey != NULL);
+  assert(ppvValue != NULL);
+
+  current = (struct Node *) psIter->position;
+  if(current == NULL) return 0;
+  *ppcKey = current->key;
+  *ppvValue = (void *) current->value;
+  psIter->position = current->next;
+  return 1;
+}
+
+int SymTable_getStats(SymTable_T oSymTable,
+  struct SymTable_Stats *psStats){
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+
+#ifdef SYMTABLE_STATS
+  /*the whole list is one chain*/
+  *psStats = oSymTable->stats;
+  memset(psStats->chains, 0, sizeof(psStats->chains));
+  psStats->chains[oSymTable->size < SYMTABLE_STATS_CHAINS
+    ? oSymTable->size : SYMTABLE_STATS_CHAINS - 1] = 1;
+  psStats->bytes = sizeof(struct SymTable)
+    + Arena_getBytes(oSymTable->arena);
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+size_t SymTable_hash(const char *pcKey, size_t uLength){
+  assert(pcKey != NULL);
+  return StrHash_hash(pcKey, uLength);
+}
+
+static int SymTable_keyEquals(const char *pcStored, const char *pcKey,
+  size_t uLength){
+  /*a borrowed key looked up by the same pointer, an interned one say,
+  is equal without reading its bytes*/
+  if(pcStored == pcKey) return pcStored[uLength] == '\0';
+  /*strncmp stops at the end of pcStored, so a shorter stored key is
+  never read past its '\0'*/
+  return strncmp(pcStored, pcKey, uLength) == 0 && pcStored[uLength] == '\0';
+}
+
+static const char *SymTable_storeKey(SymTable_T oSymTable,
+  Arena_T oArena, const char *pcKey, size_t uLength){
+  char *copy;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if(oSymTable->borrowed) return pcKey;
+  copy = (char *) Arena_alloc(oArena, sizeof(char) * (uLength + 1));
+  if(copy == NULL) return NULL;
+  memcpy(copy, pcKey, uLength);
+  copy[uLength] = '\0';
+  return copy;
+}
+
+static int SymTable_append(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+  struct Node *end;
+  const char *newKey;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /*creates a new node end which will be added to end of linked list*/
+  end = (struct Node *) Arena_alloc(oSymTable->arena, sizeof(struct Node));
+  if(end == NULL) return 0;
+  /*defensive copy of key, unless it is borrowed*/
+  newKey = SymTable_storeKey(oSymTable, oSymTable->arena, pcKey, uLength);
+  if(newKey == NULL){
+    Arena_release(oSymTable->arena, end, sizeof(struct Node));
+    return 0;
+  }
+  /*assigns values of Node end*/
+  end->hash = uHash;
+  end->key = newKey;
+  end->value = pvValue;
+  end->next = NULL;
+
+  /*adds end as first node if list is currently empty, otherwise after
+  the last one*/
+  if(oSymTable->last == NULL) oSymTable->first = end;
+  else oSymTable->last->next = end;
+  oSymTable->last = end;
+  oSymTable->size += 1;
+  return 1;
+}
+
+static void SymTable_freeNode(SymTable_T oSymTable, struct Node *oNode){
+  assert(oSymTable != NULL);
+  assert(oNode != NULL);
+
+  if(!oSymTable->borrowed)
+    Arena_release(oSymTable->arena, (char *) oNode->key,
+      sizeof(char) * (strlen(oNode->key) + 1));
+  Arena_release(oSymTable->arena, oNode, sizeof(struct Node));
+}
+
+static void SymTable_promote(SymTable_T oSymTable,
+  struct Node *oBeforeThat, struct Node *oBefore, struct Node *oNode){
+  assert(oSymTable != NULL);
+  assert(oNode != NULL);
+
+  /*a Node already at the front stays there*/
+  if(oBefore == NULL) return;
+#if defined(SYMTABLELIST_MOVE_TO_FRONT) || defined(SYMTABLELIST_TRANSPOSE)
+  /*either way oBefore ends up where oNode was*/
+  if(oSymTable->last == oNode) oSymTable->last = oBefore;
+#endif
+#if defined(SYMTABLELIST_MOVE_TO_FRONT)
+  (void) oBeforeThat;
+  oBefore->next = oNode->next;
+  oNode->next = oSymTable->first;
+  oSymTable->first = oNode;
+#elif defined(SYMTABLELIST_TRANSPOSE)
+  oBefore->next = oNode->next;
+  oNode->next = oBefore;
+  if(oBeforeThat != NULL) oBeforeThat->next = oNode;
+  else oSymTable->first = oNode;
+#else
+  (void) oBeforeThat;
+#endif
+}
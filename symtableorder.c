@@ -0,0 +1,128 @@
+/*--------------------------------------------------------------------*/
+/* symtableorder.c                                                    */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+/*SymTable_mapRange and SymTable_mapPrefix for the implementations that
+keep no key order (list, hash, flat and adapt). They are written only
+against symtable.h: the table is traversed once and the bindings that
+match are sorted before pfApply sees them, so a call costs
+O(n + k log k).
+symtabletree.c has its own O(log n + k) versions and does not link
+this file.*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtable.h"
+
+/*A Match is a binding that is in the range, kept until the matches are
+sorted.*/
+struct Match {
+  const char *key;
+  void *value;
+};
+
+/*Returns 1 (TRUE) if pcKey is at or above pcLow and below pcHigh, or
+starts with pcPrefix when pcPrefix is not NULL, or 0 (FALSE)
+otherwise. uPrefixLength is the length of pcPrefix.*/
+static int SymTable_inRange(const char *pcKey, const char *pcLow,
+  const char *pcHigh, const char *pcPrefix, size_t uPrefixLength);
+
+/*Compares the keys of the Matches pvA and pvB for qsort.*/
+static int SymTable_compareMatches(const void *pvA, const void *pvB);
+
+/*Applies pfApply in key order to the bindings of oSymTable accepted
+by SymTable_inRange. Returns 1 (TRUE), or 0 (FALSE) if insufficient
+memory is available.*/
+static int SymTable_mapSorted(SymTable_T oSymTable, const char *pcLow,
+  const char *pcHigh, const char *pcPrefix,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra);
+
+int SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+  const char *pcHigh,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra){
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  return SymTable_mapSorted(oSymTable, pcLow, pcHigh, NULL, pfApply,
+    pvExtra);
+}
+
+int SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra){
+  assert(oSymTable != NULL);
+  assert(pcPrefix != NULL);
+  assert(pfApply != NULL);
+
+  return SymTable_mapSorted(oSymTable, NULL, NULL, pcPrefix, pfApply,
+    pvExtra);
+}
+
+static int SymTable_inRange(const char *pcKey, const char *pcLow,
+  const char *pcHigh, const char *pcPrefix, size_t uPrefixLength){
+  assert(pcKey != NULL);
+
+  if(pcLow != NULL && strcmp(pcKey, pcLow) < 0) return 0;
+  if(pcHigh != NULL && strcmp(pcKey, pcHigh) >= 0) return 0;
+  if(pcPrefix != NULL && strncmp(pcKey, pcPrefix, uPrefixLength) != 0)
+    return 0;
+  return 1;
+}
+
+static int SymTable_compareMatches(const void *pvA, const void *pvB){
+  return strcmp(((const struct Match *) pvA)->key,
+    ((const struct Match *) pvB)->key);
+}
+
+static int SymTable_mapSorted(SymTable_T oSymTable, const char *pcLow,
+  const char *pcHigh, const char *pcPrefix,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra){
+
+  struct SymTable_Iter iter;
+  struct Match *matches;
+  const char *key;
+  void *value;
+  size_t prefixLength = 0;
+  size_t count = 0;
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  if(pcPrefix != NULL) prefixLength = strlen(pcPrefix);
+
+  /*counts the matches first, so one array of the right size holds
+  them*/
+  SymTable_iterBegin(oSymTable, &iter);
+  while(SymTable_iterNext(&iter, &key, &value))
+    if(SymTable_inRange(key, pcLow, pcHigh, pcPrefix, prefixLength))
+      count++;
+  if(count == 0) return 1;
+
+  matches = (struct Match *) malloc(count * sizeof(struct Match));
+  if(matches == NULL) return 0;
+
+  i = 0;
+  SymTable_iterBegin(oSymTable, &iter);
+  while(SymTable_iterNext(&iter, &key, &value)){
+    if(SymTable_inRange(key, pcLow, pcHigh, pcPrefix, prefixLength)){
+      matches[i].key = key;
+      matches[i].value = value;
+      i++;
+    }
+  }
+  assert(i == count);
+
+  /*keys in a table are distinct, so the order is total*/
+  qsort(matches, count, sizeof(struct Match), SymTable_compareMatches);
+  for(i = 0; i < count; i++)
+    (*pfApply)(matches[i].key, matches[i].value, (void *) pvExtra);
+
+  free(matches);
+  return 1;
+}
@@ -0,0 +1,116 @@
+/*--------------------------------------------------------------------*/
+/* symtablerename.h                                                   */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+/*Renames every SymTable name of symtable.h to the same name with the
+prefix SYMTABLE_PREFIX in place of SymTable_, so that one
+implementation can keep tables of another under its own SymTable.
+symtableshard.c keeps hash tables of symtablehash.c as ShardHash_
+tables and symtableadapt.c grows into a flat table of symtableflat.c
+as an AdaptFlat_ table. The Makefile compiles the inner implementation
+a second time with -DSYMTABLE_PREFIX=ShardHash_ (say)
+-DSYMTABLE_RENAME_BUILD -include symtablerename.h.
+
+The outer implementation defines SYMTABLE_PREFIX and includes this
+header without SYMTABLE_RENAME_BUILD. It then declares the renamed
+functions and drops the renames again, and must come before
+symtable.h, which is included once more for the SymTable names. A
+name added to symtable.h must be added to both lists below.*/
+
+#ifndef SYMTABLERENAME_H
+#define SYMTABLERENAME_H
+
+#ifdef SYMTABLE_H
+#error "symtablerename.h must be included before symtable.h"
+#endif
+#ifndef SYMTABLE_PREFIX
+#error "symtablerename.h needs SYMTABLE_PREFIX defined"
+#endif
+
+/*SYMTABLE_RENAME(n) is n with SYMTABLE_PREFIX in front. The prefix is
+pasted through a second macro so that it is expanded first*/
+#define SYMTABLE_PASTE(a, b) a##b
+#define SYMTABLE_CAT(a, b) SYMTABLE_PASTE(a, b)
+#define SYMTABLE_RENAME(n) SYMTABLE_CAT(SYMTABLE_PREFIX, n)
+
+#define SymTable SYMTABLE_RENAME(Table)
+#define SymTable_T SYMTABLE_RENAME(T)
+#define SymTable_Iter SYMTABLE_RENAME(Iter)
+#define SymTable_new SYMTABLE_RENAME(new)
+#define SymTable_newWithCapacity SYMTABLE_RENAME(newWithCapacity)
+#define SymTable_newBorrowed SYMTABLE_RENAME(newBorrowed)
+#define SymTable_reserve SYMTABLE_RENAME(reserve)
+#define SymTable_free SYMTABLE_RENAME(free)
+#define SymTable_getLength SYMTABLE_RENAME(getLength)
+#define SymTable_put SYMTABLE_RENAME(put)
+#define SymTable_replace SYMTABLE_RENAME(replace)
+#define SymTable_contains SYMTABLE_RENAME(contains)
+#define SymTable_get SYMTABLE_RENAME(get)
+#define SymTable_remove SYMTABLE_RENAME(remove)
+#define SymTable_map SYMTABLE_RENAME(map)
+#define SymTable_mapParallel SYMTABLE_RENAME(mapParallel)
+#define SymTable_mapRange SYMTABLE_RENAME(mapRange)
+#define SymTable_mapPrefix SYMTABLE_RENAME(mapPrefix)
+#define SymTable_hash SYMTABLE_RENAME(hash)
+#define SymTable_putHashed SYMTABLE_RENAME(putHashed)
+#define SymTable_putUnique SYMTABLE_RENAME(putUnique)
+#define SymTable_putUniqueHashed SYMTABLE_RENAME(putUniqueHashed)
+#define SymTable_replaceHashed SYMTABLE_RENAME(replaceHashed)
+#define SymTable_containsHashed SYMTABLE_RENAME(containsHashed)
+#define SymTable_getHashed SYMTABLE_RENAME(getHashed)
+#define SymTable_removeHashed SYMTABLE_RENAME(removeHashed)
+#define SymTable_getBatch SYMTABLE_RENAME(getBatch)
+#define SymTable_putBatch SYMTABLE_RENAME(putBatch)
+#define SymTable_bulkLoad SYMTABLE_RENAME(bulkLoad)
+#define SymTable_iterBegin SYMTABLE_RENAME(iterBegin)
+#define SymTable_iterNext SYMTABLE_RENAME(iterNext)
+#define SymTable_compact SYMTABLE_RENAME(compact)
+#define SymTable_save SYMTABLE_RENAME(save)
+#define SymTable_openMapped SYMTABLE_RENAME(openMapped)
+#define SymTable_Stats SYMTABLE_RENAME(Stats)
+#define SymTable_getStats SYMTABLE_RENAME(getStats)
+
+#include "symtable.h"
+
+#ifndef SYMTABLE_RENAME_BUILD
+#undef SymTable
+#undef SymTable_T
+#undef SymTable_Iter
+#undef SymTable_new
+#undef SymTable_newWithCapacity
+#undef SymTable_newBorrowed
+#undef SymTable_reserve
+#undef SymTable_free
+#undef SymTable_getLength
+#undef SymTable_put
+#undef SymTable_replace
+#undef SymTable_contains
+#undef SymTable_get
+#undef SymTable_remove
+#undef SymTable_map
+#undef SymTable_mapParallel
+#undef SymTable_mapRange
+#undef SymTable_mapPrefix
+#undef SymTable_hash
+#undef SymTable_putHashed
+#undef SymTable_putUnique
+#undef SymTable_putUniqueHashed
+#undef SymTable_replaceHashed
+#undef SymTable_containsHashed
+#undef SymTable_getHashed
+#undef SymTable_removeHashed
+#undef SymTable_getBatch
+#undef SymTable_putBatch
+#undef SymTable_bulkLoad
+#undef SymTable_iterBegin
+#undef SymTable_iterNext
+#undef SymTable_compact
+#undef SymTable_save
+#undef SymTable_openMapped
+#undef SymTable_Stats
+#undef SymTable_getStats
+#undef SYMTABLE_H
+#endif
+
+#endif
@@ -0,0 +1,659 @@
+/*--------------------------------------------------------------------*/
+/* symtableshard.c                                                    */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+/*A SymTable that threads can share, made of SHARD_COUNT independent
+hash tables from symtablehash.c (see symtablerename.h). The top bits of the
+hash of a key pick its shard, and each shard has its own lock, arena
+and resizes, so threads writing different keys seldom meet on one
+structure.
+
+Every function locks the shards it uses. SymTable_getLength,
+SymTable_map, SymTable_mapParallel and SymTable_compact lock all shards
+at once, so they see a consistent table, and pfApply must not call back
+into it. SymTable_bulkLoad sorts its keys by shard and loads the shards
+on separate threads. The
+iterator, SymTable_mapRange and SymTable_mapPrefix (built on the
+iterator in symtableorder.c) and SymTable_free must not run while other
+threads change the table.*/
+
+#define SYMTABLE_PREFIX ShardHash_
+#include "symtablerename.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtable.h"
+#include "strhash.h"
+#include "parallel.h"
+
+/*SHARD_BITS is the number of top hash bits that pick a shard*/
+enum { SHARD_BITS = 4, SHARD_COUNT = 1 << SHARD_BITS };
+
+/*CACHE_LINE is the padding between shards, so the locks of different
+shards are not on one cache line*/
+enum { CACHE_LINE = 64 };
+
+/*BULK_CHUNK is number of keys SymTable_bulkLoad takes at a time, which
+bounds its temporary storage. BULK_PART_MIN is the fewest keys it gives
+one thread, so that small loads stay on one thread*/
+enum { BULK_CHUNK = 1048576, BULK_PART_MIN = 4096 };
+
+/*A Shard is one of the hash tables and the lock that guards it*/
+struct Shard {
+  pthread_mutex_t lock;
+  ShardHash_T table;
+  char pad[CACHE_LINE];
+};
+
+/*A SymTable is its shards*/
+struct SymTable {
+  struct Shard shards[SHARD_COUNT];
+};
+
+/*A Bulk is one chunk of keys of a SymTable_bulkLoad, shared by the
+threads loading it*/
+struct Bulk {
+  /*table is the SymTable being loaded*/
+  SymTable_T table;
+  /*keys are the keys of the chunk*/
+  const char *const *keys;
+  /*count is number of keys in the chunk*/
+  size_t count;
+  /*shards[i] is the number of the Shard of keys[i]*/
+  unsigned char *shards;
+  /*sortedKeys and sortedValues are the bindings of the chunk grouped
+  by Shard, in their order within each group. Those of Shard s are
+  from starts[s] up to starts[s + 1]*/
+  const char **sortedKeys;
+  const void **sortedValues;
+  size_t starts[SHARD_COUNT + 1];
+  /*added[s] is number of bindings added to Shard s*/
+  size_t added[SHARD_COUNT];
+};
+
+/*A Visit is one SymTable_mapParallel, shared by the threads running
+it*/
+struct Visit {
+  /*table is the SymTable being mapped*/
+  SymTable_T table;
+  /*apply is the function applied to each binding*/
+  void (*apply)(const char *pcKey, void *pvValue, void *pvExtra);
+  /*extra is passed to apply*/
+  const void *extra;
+};
+
+/*Returns the Shard of oSymTable for keys of hash uHash. The top bits
+are used because the shards use the bottom bits for their buckets.*/
+static struct Shard *SymTable_shard(SymTable_T oSymTable, size_t uHash);
+
+/*Locks every shard of oSymTable, in order.*/
+static void SymTable_lockAll(SymTable_T oSymTable);
+
+/*Unlocks every shard of oSymTable.*/
+static void SymTable_unlockAll(SymTable_T oSymTable);
+
+/*Finds the Shard of each key in part uPart of uParts of the Bulk
+pvBulk.*/
+static void SymTable_bulkShard(size_t uPart, size_t uParts,
+  void *pvBulk);
+
+/*Creates and returns a SymTable whose Shards are new ShardHashes with
+room for uCapacity bindings in all, or that borrow their keys if
+iBorrowed is 1 (TRUE). Returns NULL if insufficient memory is
+available.*/
+static SymTable_T SymTable_create(size_t uCapacity, int iBorrowed);
+
+/*Loads the sorted bindings of the Bulk pvBulk into the Shards in part
+uPart of uParts of the shards, locking one Shard at a time.*/
+static void SymTable_bulkPut(size_t uPart, size_t uParts, void *pvBulk);
+
+/*Maps the Shards in part uPart of uParts of the shards with the
+function of the Visit pvVisit. The caller holds every Shard.*/
+static void SymTable_visitPart(size_t uPart, size_t uParts,
+  void *pvVisit);
+
+SymTable_T SymTable_new(void){
+  return SymTable_newWithCapacity(0);
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity){
+  return SymTable_create(uCapacity, 0);
+}
+
+SymTable_T SymTable_newBorrowed(void){
+  return SymTable_create(0, 1);
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity){
+  size_t i;
+  int result = 1;
+
+  assert(oSymTable != NULL);
+
+  /*a shard that fails keeps its old size, which is still a valid
+  table*/
+  for(i = 0; i < SHARD_COUNT; i++){
+    struct Shard *shard = &oSymTable->shards[i];
+    pthread_mutex_lock(&shard->lock);
+    if(!ShardHash_reserve(shard->table, uCapacity / SHARD_COUNT + 1))
+      result = 0;
+    pthread_mutex_unlock(&shard->lock);
+  }
+  return result;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+  size_t i;
+
+  assert(oSymTable != NULL);
+
+  for(i = 0; i < SHARD_COUNT; i++){
+    pthread_mutex_destroy(&oSymTable->shards[i].lock);
+    ShardHash_free(oSymTable->shards[i].table);
+  }
+  free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+  size_t length = 0;
+  size_t i;
+
+  assert(oSymTable != NULL);
+
+  SymTable_lockAll(oSymTable);
+  for(i = 0; i < SHARD_COUNT; i++)
+    length += ShardHash_getLength(oSymTable->shards[i].table);
+  SymTable_unlockAll(oSymTable);
+  return length;
+}
+
+int SymTable_put(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  struct Shard *shard;
+  int result;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  shard = SymTable_shard(oSymTable, uHash);
+  pthread_mutex_lock(&shard->lock);
+  result = ShardHash_putHashed(shard->table, pcKey, uLength, uHash,
+    pvValue);
+  pthread_mutex_unlock(&shard->lock);
+  return result;
+}
+
+int SymTable_putUnique(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putUniqueHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putUniqueHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  struct Shard *shard;
+  int result;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  shard = SymTable_shard(oSymTable, uHash);
+  pthread_mutex_lock(&shard->lock);
+  result = ShardHash_putUniqueHashed(shard->table, pcKey, uLength, uHash,
+    pvValue);
+  pthread_mutex_unlock(&shard->lock);
+  return result;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_replaceHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+void *SymTable_replaceHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  struct Shard *shard;
+  void *oldValue;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  shard = SymTable_shard(oSymTable, uHash);
+  pthread_mutex_lock(&shard->lock);
+  oldValue = ShardHash_replaceHashed(shard->table, pcKey, uLength, uHash,
+    pvValue);
+  pthread_mutex_unlock(&shard->lock);
+  return oldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_containsHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+int SymTable_containsHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Shard *shard;
+  int result;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  shard = SymTable_shard(oSymTable, uHash);
+  pthread_mutex_lock(&shard->lock);
+  result = ShardHash_containsHashed(shard->table, pcKey, uLength, uHash);
+  pthread_mutex_unlock(&shard->lock);
+  return result;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_getHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_getHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Shard *shard;
+  void *value;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  shard = SymTable_shard(oSymTable, uHash);
+  pthread_mutex_lock(&shard->lock);
+  value = ShardHash_getHashed(shard->table, pcKey, uLength, uHash);
+  pthread_mutex_unlock(&shard->lock);
+  return value;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_removeHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_removeHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Shard *shard;
+  void *oldValue;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  shard = SymTable_shard(oSymTable, uHash);
+  pthread_mutex_lock(&shard->lock);
+  oldValue = ShardHash_removeHashed(shard->table, pcKey, uLength, uHash);
+  pthread_mutex_unlock(&shard->lock);
+  return oldValue;
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  size_t uCount, void **ppvValues){
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  /*keys of a batch fall in different shards, so each is looked up
+  under its own lock*/
+  for(i = 0; i < uCount; i++)
+    ppvValues[i] = SymTable_get(oSymTable, ppcKeys[i]);
+}
+
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount){
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  for(i = 0; i < uCount; i++)
+    added += (size_t) SymTable_put(oSymTable, ppcKeys[i], ppvValues[i]);
+  return added;
+}
+
+size_t SymTable_bulkLoad(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount, size_t uThreads){
+
+  struct Bulk bulk;
+  size_t start;
+  size_t parts;
+  size_t next[SHARD_COUNT];
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  bulk.table = oSymTable;
+  bulk.count = uCount < BULK_CHUNK ? uCount : BULK_CHUNK;
+  bulk.shards = (unsigned char *) malloc(bulk.count);
+  bulk.sortedKeys = (const char **) malloc(bulk.count
+    * sizeof(const char *));
+  bulk.sortedValues = (const void **) malloc(bulk.count
+    * sizeof(const void *));
+  if(bulk.shards == NULL || bulk.sortedKeys == NULL
+  || bulk.sortedValues == NULL){
+    free(bulk.shards);
+    free(bulk.sortedKeys);
+    free(bulk.sortedValues);
+    return SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount);
+  }
+
+  for(start = 0; start < uCount; start += bulk.count){
+    if(bulk.count > uCount - start) bulk.count = uCount - start;
+    bulk.keys = ppcKeys + start;
+    Parallel_run(Parallel_parts(uThreads, bulk.count, BULK_PART_MIN),
+      SymTable_bulkShard, &bulk);
+
+    /*a counting sort by Shard, which keeps the keys of each Shard in
+    order, so the first of a repeated key is still the one kept*/
+    for(i = 0; i <= SHARD_COUNT; i++) bulk.starts[i] = 0;
+    for(i = 0; i < bulk.count; i++) bulk.starts[bulk.shards[i] + 1] += 1;
+    for(i = 0; i < SHARD_COUNT; i++){
+      bulk.starts[i + 1] += bulk.starts[i];
+      next[i] = bulk.starts[i];
+    }
+    for(i = 0; i < bulk.count; i++){
+      size_t position = next[bulk.shards[i]]++;
+      bulk.sortedKeys[position] = bulk.keys[i];
+      bulk.sortedValues[position] = ppvValues[start + i];
+    }
+
+    parts = Parallel_parts(uThreads, bulk.count, BULK_PART_MIN);
+    if(parts > SHARD_COUNT) parts = SHARD_COUNT;
+    Parallel_run(parts, SymTable_bulkPut, &bulk);
+    for(i = 0; i < SHARD_COUNT; i++) added += bulk.added[i];
+  }
+
+  free(bulk.shards);
+  free(bulk.sortedKeys);
+  free(bulk.sortedValues);
+  return added;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra){
+
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  SymTable_lockAll(oSymTable);
+  for(i = 0; i < SHARD_COUNT; i++)
+    ShardHash_map(oSymTable->shards[i].table, pfApply, pvExtra);
+  SymTable_unlockAll(oSymTable);
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra, size_t uThreads){
+
+  struct Visit visit;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  /*this thread holds every Shard while the others map them*/
+  SymTable_lockAll(oSymTable);
+  visit.table = oSymTable;
+  visit.apply = pfApply;
+  visit.extra = pvExtra;
+  Parallel_run(Parallel_parts(uThreads, SHARD_COUNT, 1),
+    SymTable_visitPart, &visit);
+  SymTable_unlockAll(oSymTable);
+}
+
+int SymTable_compact(SymTable_T oSymTable){
+  size_t i;
+  int result = 1;
+
+  assert(oSymTable != NULL);
+
+  /*a shard that fails is left as it was, and the others still
+  shrink*/
+  SymTable_lockAll(oSymTable);
+  for(i = 0; i < SHARD_COUNT; i++)
+    if(!ShardHash_compact(oSymTable->shards[i].table)) result = 0;
+  SymTable_unlockAll(oSymTable);
+  return result;
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable,
+  struct SymTable_Iter *psIter){
+  struct ShardHash_Iter inner;
+
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+
+  /*index is the shard being traversed and position the place in it.
+  The iterator of symtablehash.c keeps its place in position alone*/
+  ShardHash_iterBegin(oSymTable->shards[0].table, &inner);
+  psIter->table = oSymTable;
+  psIter->position = inner.position;
+  psIter->index = 0;
+}
+
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+  void **ppvValue){
+  struct ShardHash_Iter inner;
+
+  assert(psIter != NULL);
+  assert(ppcKey != NULL);
+  assert(ppvValue != NULL);
+
+  while(psIter->index < SHARD_COUNT){
+    inner.table = psIter->table->shards[psIter->index].table;
+    inner.position = psIter->position;
+    inner.index = 0;
+    if(ShardHash_iterNext(&inner, ppcKey, ppvValue)){
+      psIter->position = inner.position;
+      return 1;
+    }
+    /*this shard is done, so the traversal moves to the next*/
+    psIter->index += 1;
+    if(psIter->index < SHARD_COUNT){
+      ShardHash_iterBegin(psIter->table->shards[psIter->index].table,
+        &inner);
+      psIter->position = inner.position;
+    }
+  }
+  return 0;
+}
+
+int SymTable_getStats(SymTable_T oSymTable,
+  struct SymTable_Stats *psStats){
+  struct ShardHash_Stats shard;
+  struct SymTable_Stats total;
+  size_t i;
+  size_t j;
+
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+
+  /*the statistics of the table are the sums of those of its shards*/
+  memset(&total, 0, sizeof(total));
+  SymTable_lockAll(oSymTable);
+  for(i = 0; i < SHARD_COUNT; i++){
+    if(!ShardHash_getStats(oSymTable->shards[i].table, &shard)){
+      SymTable_unlockAll(oSymTable);
+      return 0;
+    }
+    for(j = 0; j < SYMTABLE_STATS_CHAINS; j++)
+      total.chains[j] += shard.chains[j];
+    total.gets += shard.gets;
+    total.hits += shard.hits;
+    total.misses += shard.misses;
+    total.getProbes += shard.getProbes;
+    total.puts += shard.puts;
+    total.putProbes += shard.putProbes;
+    total.resizes += shard.resizes;
+    total.resizeSeconds += shard.resizeSeconds;
+    total.bytes += shard.bytes;
+  }
+  SymTable_unlockAll(oSymTable);
+  total.bytes += sizeof(struct SymTable);
+  *psStats = total;
+  return 1;
+}
+
+size_t SymTable_hash(const char *pcKey, size_t uLength){
+  assert(pcKey != NULL);
+  return StrHash_hash(pcKey, uLength);
+}
+
+static struct Shard *SymTable_shard(SymTable_T oSymTable, size_t uHash){
+  assert(oSymTable != NULL);
+
+  return &oSymTable->shards[uHash >> (sizeof(size_t) * 8 - SHARD_BITS)];
+}
+
+static void SymTable_lockAll(SymTable_T oSymTable){
+  size_t i;
+
+  assert(oSymTable != NULL);
+
+  /*always in the same order, so two threads locking all cannot
+  deadlock*/
+  for(i = 0; i < SHARD_COUNT; i++)
+    pthread_mutex_lock(&oSymTable->shards[i].lock);
+}
+
+static void SymTable_unlockAll(SymTable_T oSymTable){
+  size_t i;
+
+  assert(oSymTable != NULL);
+
+  for(i = SHARD_COUNT; i > 0; i--)
+    pthread_mutex_unlock(&oSymTable->shards[i - 1].lock);
+}
+
+static void SymTable_bulkShard(size_t uPart, size_t uParts,
+  void *pvBulk){
+  struct Bulk *bulk = (struct Bulk *) pvBulk;
+  size_t end;
+  size_t i;
+
+  assert(bulk != NULL);
+
+  end = Parallel_begin(bulk->count, uPart + 1, uParts);
+  for(i = Parallel_begin(bulk->count, uPart, uParts); i < end; i++){
+    const char *key = bulk->keys[i];
+    assert(key != NULL);
+    bulk->shards[i] = (unsigned char) (SymTable_shard(bulk->table,
+      StrHash_hash(key, strlen(key))) - bulk->table->shards);
+  }
+}
+
+static SymTable_T SymTable_create(size_t uCapacity, int iBorrowed){
+  SymTable_T table;
+  size_t i;
+
+  table = (SymTable_T) malloc(sizeof(struct SymTable));
+  if(table == NULL) return NULL;
+
+  /*keys spread evenly over the shards, so each needs a share of the
+  capacity*/
+  for(i = 0; i < SHARD_COUNT; i++){
+    struct Shard *shard = &table->shards[i];
+    shard->table = iBorrowed ? ShardHash_newBorrowed()
+      : ShardHash_newWithCapacity(uCapacity / SHARD_COUNT + 1);
+    if(shard->table == NULL
+    || pthread_mutex_init(&shard->lock, NULL) != 0){
+      if(shard->table != NULL) ShardHash_free(shard->table);
+      while(i > 0){
+        i--;
+        pthread_mutex_destroy(&table->shards[i].lock);
+        ShardHash_free(table->shards[i].table);
+      }
+      free(table);
+      return NULL;
+    }
+  }
+  return table;
+}
+
+static void SymTable_bulkPut(size_t uPart, size_t uParts, void *pvBulk){
+  struct Bulk *bulk = (struct Bulk *) pvBulk;
+  size_t end;
+  size_t i;
+
+  assert(bulk != NULL);
+
+  /*each Shard hashes its keys again. Keeping the hashes for it would
+  take another array and Hashed forms of the bulk load*/
+  end = Parallel_begin(SHARD_COUNT, uPart + 1, uParts);
+  for(i = Parallel_begin(SHARD_COUNT, uPart, uParts); i < end; i++){
+    struct Shard *shard = &bulk->table->shards[i];
+    pthread_mutex_lock(&shard->lock);
+    bulk->added[i] = ShardHash_bulkLoad(shard->table,
+      bulk->sortedKeys + bulk->starts[i],
+      bulk->sortedValues + bulk->starts[i],
+      bulk->starts[i + 1] - bulk->starts[i], 1);
+    pthread_mutex_unlock(&shard->lock);
+  }
+}
+
+static void SymTable_visitPart(size_t uPart, size_t uParts,
+  void *pvVisit){
+  struct Visit *visit = (struct Visit *) pvVisit;
+  size_t end;
+  size_t i;
+
+  assert(visit != NULL);
+
+  end = Parallel_begin(SHARD_COUNT, uPart + 1, uParts);
+  for(i = Parallel_begin(SHARD_COUNT, uPart, uParts); i < end; i++)
+    ShardHash_map(visit->table->shards[i].table, visit->apply,
+      visit->extra);
+}
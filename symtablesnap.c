@@ -0,0 +1,61 @@
+/*--------------------------------------------------------------------*/
+/* symtablesnap.c                                                     */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+/*SymTable_save and SymTable_openMapped for the implementations that
+cannot search a snapshot where it lies (list, flat, tree, conc, shard
+and adapt). They are written only against symtable.h: saving adds every
+binding to a SnapshotWriter with SymTable_map, and opening maps the
+file only long enough to put its bindings into a new table, reusing
+the stored hashes. symtablehash.c has its own versions, whose tables
+stay mapped, and does not link this file.*/
+
+#include <assert.h>
+#include <string.h>
+#include "symtable.h"
+#include "snapshot.h"
+
+int SymTable_save(SymTable_T oSymTable, const char *pcPath){
+  SnapshotWriter_T writer;
+
+  assert(oSymTable != NULL);
+  assert(pcPath != NULL);
+
+  writer = SnapshotWriter_new(SymTable_getLength(oSymTable));
+  if(writer == NULL) return 0;
+  SymTable_map(oSymTable, SnapshotWriter_add, writer);
+  return SnapshotWriter_finish(writer, pcPath);
+}
+
+SymTable_T SymTable_openMapped(const char *pcPath){
+  Snapshot_T snapshot;
+  SymTable_T table;
+  size_t count;
+  size_t i;
+
+  assert(pcPath != NULL);
+
+  snapshot = Snapshot_open(pcPath);
+  if(snapshot == NULL) return NULL;
+  count = Snapshot_getLength(snapshot);
+  table = SymTable_newWithCapacity(count);
+  if(table == NULL){
+    Snapshot_close(snapshot);
+    return NULL;
+  }
+
+  /*keys are unique in a snapshot, so they are put without looking
+  for them first, and a put only fails for lack of memory*/
+  for(i = 0; i < count; i++){
+    const char *key = Snapshot_key(snapshot, i);
+    if(!SymTable_putUniqueHashed(table, key, strlen(key),
+      Snapshot_hash(snapshot, i), Snapshot_value(snapshot, i))){
+      SymTable_free(table);
+      Snapshot_close(snapshot);
+      return NULL;
+    }
+  }
+  Snapshot_close(snapshot);
+  return table;
+}
@@ -0,0 +1,1125 @@
+/*--------------------------------------------------------------------*/
+/* symtabletree.c                                                     */
+/* Author: Sevastian Venegas                                          */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtable.h"
+#include "strhash.h"
+#include "arena.h"
+
+/*LEAF_MAX is the most bindings a Leaf holds and BRANCH_MAX the most
+children a Branch has. Both make a node exactly 256 bytes, the biggest
+block the arena carves out of its chunks*/
+enum { LEAF_MAX = 15, BRANCH_MAX = 16 };
+
+/*every node but the root keeps at least LEAF_MIN bindings or
+BRANCH_MIN children, so the tree stays O(log n) deep*/
+enum { LEAF_MIN = LEAF_MAX / 2, BRANCH_MIN = BRANCH_MAX / 2 };
+
+/*MAX_HEIGHT bounds the number of Branch levels. With at least
+BRANCH_MIN children per Branch no memory could hold a taller tree*/
+enum { MAX_HEIGHT = 32 };
+
+/*A Leaf holds up to LEAF_MAX bindings sorted by key. Leaves are linked
+left to right, so ordered walks never go back up the tree*/
+struct Leaf {
+  /*count is number of bindings in Leaf*/
+  size_t count;
+  /*next is the Leaf with the following keys, or NULL if this is the
+  last*/
+  struct Leaf *next;
+  /*keys are the keys of the bindings in ascending strcmp order*/
+  char *keys[LEAF_MAX];
+  /*values[i] is the value bound to keys[i]*/
+  const void *values[LEAF_MAX];
+};
+
+/*A Branch routes a search to one of its children, which are Branches
+or, on the lowest level, Leaves. keys[i] is the smallest key under
+children[i + 1]. It points at that key inside its Leaf rather than
+owning a copy, so a remove that deletes a smallest key moves the
+pointer along*/
+struct Branch {
+  /*count is number of children of Branch*/
+  size_t count;
+  /*keys are the count - 1 separator keys*/
+  char *keys[BRANCH_MAX - 1];
+  /*children are the count children*/
+  void *children[BRANCH_MAX];
+};
+
+/*A SymTable is a B+ tree whose Leaves hold the bindings in key
+order.*/
+struct SymTable {
+  /*size is number of key value pairs or bindings*/
+  size_t size;
+  /*height is number of Branch levels above the Leaves, 0 if the root
+  is a Leaf*/
+  size_t height;
+  /*root is the top Branch, or the only Leaf if height is 0*/
+  void *root;
+  /*arena holds every node and key copy of the table, so they can be
+  freed all at once*/
+  Arena_T arena;
+  /*borrowed is 1 (TRUE) if the table keeps the caller's key pointers
+  instead of copying the keys*/
+  int borrowed;
+};
+
+/*A Path is the Branches passed on the way from the root to a Leaf,
+root first, and the index of the child taken in each.*/
+struct Path {
+  struct Branch *branches[MAX_HEIGHT];
+  size_t indexes[MAX_HEIGHT];
+};
+
+/*Returns a negative number, 0 or a positive number as the '\0'
+terminated key pcStored is below, equal to or above the uLength bytes
+at pcKey in strcmp order.*/
+static int SymTable_compare(const char *pcStored, const char *pcKey,
+  size_t uLength);
+
+/*Returns the Leaf of oSymTable where the uLength byte key pcKey is or
+would be put, filling in psPath unless it is NULL.*/
+static struct Leaf *SymTable_descend(SymTable_T oSymTable,
+  const char *pcKey, size_t uLength, struct Path *psPath);
+
+/*Returns the first index of oLeaf whose key is not below the uLength
+byte key pcKey, and sets *piFound to 1 (TRUE) if that key is pcKey or
+0 (FALSE) otherwise.*/
+static size_t SymTable_leafFind(struct Leaf *oLeaf, const char *pcKey,
+  size_t uLength, int *piFound);
+
+/*Returns the leftmost Leaf of oSymTable.*/
+static struct Leaf *SymTable_leftmost(SymTable_T oSymTable);
+
+/*Moves the bindings of oLeaf and the new binding of pcKey and pvValue,
+which goes at index uIndex, into oLeaf and the empty Leaf oRight, half
+in each. oLeaf must be full.*/
+static void SymTable_splitLeaf(struct Leaf *oLeaf, struct Leaf *oRight,
+  size_t uIndex, char *pcKey, const void *pvValue);
+
+/*Adds oChild, split off from the child at uIndex of oBranch, and its
+smallest key pcKey to oBranch, which must not be full.*/
+static void SymTable_branchInsert(struct Branch *oBranch, size_t uIndex,
+  char *pcKey, void *oChild);
+
+/*Does what SymTable_branchInsert does for a full oBranch by moving
+half of the children to the empty Branch oRight. Returns the smallest
+key under oRight, which is no longer in either Branch.*/
+static char *SymTable_splitBranch(struct Branch *oBranch,
+  struct Branch *oRight, size_t uIndex, char *pcKey, void *oChild);
+
+/*Removes child uIndex, which must not be the first, and the key in
+front of it from oBranch.*/
+static void SymTable_removeChild(struct Branch *oBranch, size_t uIndex);
+
+/*Refills the nodes on psPath that a remove left under their minimum,
+bottom up, by borrowing from or merging with a sibling.*/
+static void SymTable_rebalance(SymTable_T oSymTable,
+  struct Path *psPath);
+
+/*Refills the Leaf at index uIndex of oParent from a sibling.*/
+static void SymTable_fixLeaf(SymTable_T oSymTable,
+  struct Branch *oParent, size_t uIndex);
+
+/*Refills the Branch at index uIndex of oParent from a sibling.*/
+static void SymTable_fixBranch(SymTable_T oSymTable,
+  struct Branch *oParent, size_t uIndex);
+
+/*Copies the bindings of oSymTable into uLeafCount new Leaves in
+oArena and builds Branches over them, using ppvNodes and ppcMins, which
+have room for uLeafCount entries, as scratch. On success returns 1
+(TRUE), leaves the new root in ppvNodes[0] and its height in *puHeight.
+Returns 0 (FALSE) if oArena runs out of memory.*/
+static int SymTable_build(SymTable_T oSymTable, Arena_T oArena,
+  size_t uLeafCount, void **ppvNodes, char **ppcMins, size_t *puHeight);
+
+/*Returns the key oSymTable stores for the uLength bytes at pcKey:
+pcKey itself if oSymTable borrows its keys, otherwise a '\0'
+terminated copy from oArena, or NULL if insufficient memory is
+available.*/
+static char *SymTable_storeKey(SymTable_T oSymTable, Arena_T oArena,
+  const char *pcKey, size_t uLength);
+
+/*Gives the key copy pcKey back to the arena of oSymTable, unless
+oSymTable borrows its keys.*/
+static void SymTable_freeKey(SymTable_T oSymTable, char *pcKey);
+
+SymTable_T SymTable_new(void){
+  return SymTable_newWithCapacity(0);
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity){
+  SymTable_T table;
+  struct Leaf *leaf;
+
+  /*a tree grows one node at a time and never rehashes, so the hint
+  changes nothing*/
+  (void) uCapacity;
+
+  table = (SymTable_T) malloc(sizeof(struct SymTable));
+  if(table == NULL) return NULL;
+  table->arena = Arena_new();
+  if(table->arena == NULL){
+    free(table);
+    return NULL;
+  }
+  /*an empty table is a single empty Leaf*/
+  leaf = (struct Leaf *) Arena_alloc(table->arena, sizeof(struct Leaf));
+  if(leaf == NULL){
+    Arena_free(table->arena);
+    free(table);
+    return NULL;
+  }
+  leaf->count = 0;
+  leaf->next = NULL;
+  table->root = leaf;
+  table->height = 0;
+  table->size = 0;
+  table->borrowed = 0;
+  return table;
+}
+
+SymTable_T SymTable_newBorrowed(void){
+  SymTable_T table = SymTable_new();
+
+  if(table != NULL) table->borrowed = 1;
+  return table;
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity){
+  assert(oSymTable != NULL);
+
+  /*nothing to reserve in a tree, see SymTable_newWithCapacity*/
+  (void) uCapacity;
+  return 1;
+}
+
+void SymTable_free(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+
+  /*every key and node lives in the arena, so the tree is not walked.
+  Values untouched*/
+  Arena_free(oSymTable->arena);
+  free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+  assert(oSymTable != NULL);
+  return oSymTable->size;
+}
+
+int SymTable_put(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  struct Path path;
+  struct Leaf *leaf;
+  /*spares are the new nodes a split needs: a Leaf first, then a
+  Branch per level that splits and one more for a new root*/
+  void *spares[MAX_HEIGHT + 2];
+  size_t spareCount;
+  size_t used;
+  size_t top;
+  size_t index;
+  size_t level;
+  int found;
+  char *newKey;
+  char *carryKey;
+  void *carryNode;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  /*the tree orders keys by their bytes, so the hash is not used*/
+  (void) uHash;
+
+  leaf = SymTable_descend(oSymTable, pcKey, uLength, &path);
+  index = SymTable_leafFind(leaf, pcKey, uLength, &found);
+  if(found) return 0;
+
+  /*defensive copy of key, unless it is borrowed*/
+  newKey = SymTable_storeKey(oSymTable, oSymTable->arena, pcKey, uLength);
+  if(newKey == NULL) return 0;
+
+  if(leaf->count < LEAF_MAX){
+    memmove(&leaf->keys[index + 1], &leaf->keys[index],
+      (leaf->count - index) * sizeof(char *));
+    memmove(&leaf->values[index + 1], &leaf->values[index],
+      (leaf->count - index) * sizeof(const void *));
+    leaf->keys[index] = newKey;
+    leaf->values[index] = pvValue;
+    leaf->count += 1;
+    oSymTable->size += 1;
+    return 1;
+  }
+
+  /*the Leaf splits, and so does every full Branch above it up to the
+  first one with room. All new nodes are allocated before the tree is
+  touched, so running out of memory leaves it unchanged*/
+  top = oSymTable->height;
+  while(top > 0 && path.branches[top - 1]->count == BRANCH_MAX) top--;
+  spareCount = 1 + (oSymTable->height - top) + (top == 0 ? 1 : 0);
+  for(used = 0; used < spareCount; used++){
+    spares[used] = Arena_alloc(oSymTable->arena, used == 0
+      ? sizeof(struct Leaf) : sizeof(struct Branch));
+    if(spares[used] == NULL){
+      while(used > 0){
+        used -= 1;
+        Arena_release(oSymTable->arena, spares[used], used == 0
+          ? sizeof(struct Leaf) : sizeof(struct Branch));
+      }
+      SymTable_freeKey(oSymTable, newKey);
+      return 0;
+    }
+  }
+
+  SymTable_splitLeaf(leaf, (struct Leaf *) spares[0], index, newKey,
+    pvValue);
+  carryKey = ((struct Leaf *) spares[0])->keys[0];
+  carryNode = spares[0];
+  used = 1;
+
+  /*each split hands its new right node and that node's smallest key
+  to the parent*/
+  for(level = oSymTable->height; level > 0 && carryNode != NULL;
+    level--){
+    struct Branch *branch = path.branches[level - 1];
+    if(branch->count < BRANCH_MAX){
+      SymTable_branchInsert(branch, path.indexes[level - 1], carryKey,
+        carryNode);
+      carryNode = NULL;
+    }
+    else {
+      struct Branch *right = (struct Branch *) spares[used++];
+      carryKey = SymTable_splitBranch(branch, right,
+        path.indexes[level - 1], carryKey, carryNode);
+      carryNode = right;
+    }
+  }
+
+  /*the root itself split, so the tree gets one level taller*/
+  if(carryNode != NULL){
+    struct Branch *root = (struct Branch *) spares[used++];
+    root->count = 2;
+    root->keys[0] = carryKey;
+    root->children[0] = oSymTable->root;
+    root->children[1] = carryNode;
+    oSymTable->root = root;
+    oSymTable->height += 1;
+  }
+  assert(used == spareCount);
+
+  oSymTable->size += 1;
+  return 1;
+}
+
+int SymTable_putUnique(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_putUniqueHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+int SymTable_putUniqueHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+  /*a put has to walk down to the leaf where the key belongs whether
+  or not it checks for the key, and finding it there costs nothing
+  more, so there is nothing to skip*/
+  return SymTable_putHashed(oSymTable, pcKey, uLength, uHash, pvValue);
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+  const char *pcKey, const void *pvValue){
+
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_replaceHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length), pvValue);
+}
+
+void *SymTable_replaceHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash, const void *pvValue){
+
+  struct Leaf *leaf;
+  size_t index;
+  int found;
+  void *oldValue;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  (void) uHash;
+
+  leaf = SymTable_descend(oSymTable, pcKey, uLength, NULL);
+  index = SymTable_leafFind(leaf, pcKey, uLength, &found);
+  if(!found) return NULL;
+
+  oldValue = (void *) leaf->values[index];
+  leaf->values[index] = pvValue;
+  return oldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_containsHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+int SymTable_containsHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Leaf *leaf;
+  int found;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  (void) uHash;
+
+  leaf = SymTable_descend(oSymTable, pcKey, uLength, NULL);
+  (void) SymTable_leafFind(leaf, pcKey, uLength, &found);
+  return found;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_getHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_getHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Leaf *leaf;
+  size_t index;
+  int found;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  (void) uHash;
+
+  leaf = SymTable_descend(oSymTable, pcKey, uLength, NULL);
+  index = SymTable_leafFind(leaf, pcKey, uLength, &found);
+  if(!found) return NULL;
+  return (void *) leaf->values[index];
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+  size_t length;
+
+  assert(pcKey != NULL);
+
+  length = strlen(pcKey);
+  return SymTable_removeHashed(oSymTable, pcKey, length,
+    StrHash_hash(pcKey, length));
+}
+
+void *SymTable_removeHashed(SymTable_T oSymTable, const char *pcKey,
+  size_t uLength, size_t uHash){
+  struct Path path;
+  struct Leaf *leaf;
+  size_t index;
+  size_t level;
+  int found;
+  char *oldKey;
+  void *oldValue;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  (void) uHash;
+
+  leaf = SymTable_descend(oSymTable, pcKey, uLength, &path);
+  index = SymTable_leafFind(leaf, pcKey, uLength, &found);
+  if(!found) return NULL;
+
+  oldKey = leaf->keys[index];
+  oldValue = (void *) leaf->values[index];
+  memmove(&leaf->keys[index], &leaf->keys[index + 1],
+    (leaf->count - index - 1) * sizeof(char *));
+  memmove(&leaf->values[index], &leaf->values[index + 1],
+    (leaf->count - index - 1) * sizeof(const void *));
+  leaf->count -= 1;
+
+  /*the smallest key of a Leaf that is not the leftmost under some
+  Branch is that Branch's separator, found where the path last turned
+  away from a first child. It now points at the next key of the Leaf,
+  which a non root Leaf always has*/
+  if(index == 0){
+    for(level = oSymTable->height; level > 0; level--){
+      if(path.indexes[level - 1] > 0){
+        struct Branch *branch = path.branches[level - 1];
+        assert(branch->keys[path.indexes[level - 1] - 1] == oldKey);
+        assert(leaf->count > 0);
+        branch->keys[path.indexes[level - 1] - 1] = leaf->keys[0];
+        break;
+      }
+    }
+  }
+  /*frees key, value untouched*/
+  SymTable_freeKey(oSymTable, oldKey);
+  oSymTable->size -= 1;
+
+  SymTable_rebalance(oSymTable, &path);
+  return oldValue;
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  size_t uCount, void **ppvValues){
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  /*each lookup is a chain of dependent node reads, so the keys are
+  looked up in turn*/
+  for(i = 0; i < uCount; i++)
+    ppvValues[i] = SymTable_get(oSymTable, ppcKeys[i]);
+}
+
+size_t SymTable_putBatch(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount){
+  size_t i;
+  size_t added = 0;
+
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL || uCount == 0);
+  assert(ppvValues != NULL || uCount == 0);
+
+  for(i = 0; i < uCount; i++)
+    added += (size_t) SymTable_put(oSymTable, ppcKeys[i], ppvValues[i]);
+  return added;
+}
+
+size_t SymTable_bulkLoad(SymTable_T oSymTable, const char *const *ppcKeys,
+  const void *const *ppvValues, size_t uCount, size_t uThreads){
+  assert(oSymTable != NULL);
+
+  /*puts into one tree change shared Branches, so they are not split
+  over threads*/
+  (void) uThreads;
+  return SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount);
+}
+
+void SymTable_map(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra){
+
+  struct Leaf *leaf;
+  size_t i;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  /*walks the Leaves left to right, so bindings come in key order*/
+  for(leaf = SymTable_leftmost(oSymTable); leaf != NULL;
+    leaf = leaf->next)
+    for(i = 0; i < leaf->count; i++)
+      (*pfApply)(leaf->keys[i], (void *) leaf->values[i],
+        (void *) pvExtra);
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra, size_t uThreads){
+  assert(oSymTable != NULL);
+
+  /*the Leaves are a linked list, which cannot be split without walking
+  it first*/
+  (void) uThreads;
+  SymTable_map(oSymTable, pfApply, pvExtra);
+}
+
+int SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+  const char *pcHigh,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra){
+
+  struct Leaf *leaf;
+  size_t i;
+  size_t highLength = 0;
+  int found;
+
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  /*one descent finds the first key in range, after which the walk
+  only visits keys it applies pfApply to, plus the one that ends it*/
+  if(pcLow == NULL){
+    leaf = SymTable_leftmost(oSymTable);
+    i = 0;
+  }
+  else {
+    size_t lowLength = strlen(pcLow);
+    leaf = SymTable_descend(oSymTable, pcLow, lowLength, NULL);
+    i = SymTable_leafFind(leaf, pcLow, lowLength, &found);
+  }
+  if(pcHigh != NULL) highLength = strlen(pcHigh);
+
+  for(; leaf != NULL; leaf = leaf->next, i = 0){
+    for(; i < leaf->count; i++){
+      if(pcHigh != NULL
+      && SymTable_compare(leaf->keys[i], pcHigh, highLength) >= 0)
+        return 1;
+      (*pfApply)(leaf->keys[i], (void *) leaf->values[i],
+        (void *) pvExtra);
+    }
+  }
+  return 1;
+}
+
+int SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+  const void *pvExtra){
+
+  struct Leaf *leaf;
+  size_t i;
+  size_t length;
+  int found;
+
+  assert(oSymTable != NULL);
+  assert(pcPrefix != NULL);
+  assert(pfApply != NULL);
+
+  /*keys with the prefix are together, starting where the prefix itself
+  would be*/
+  length = strlen(pcPrefix);
+  leaf = SymTable_descend(oSymTable, pcPrefix, length, NULL);
+  i = SymTable_leafFind(leaf, pcPrefix, length, &found);
+
+  for(; leaf != NULL; leaf = leaf->next, i = 0){
+    for(; i < leaf->count; i++){
+      if(strncmp(leaf->keys[i], pcPrefix, length) != 0) return 1;
+      (*pfApply)(leaf->keys[i], (void *) leaf->values[i],
+        (void *) pvExtra);
+    }
+  }
+  return 1;
+}
+
+int SymTable_compact(SymTable_T oSymTable){
+  Arena_T newArena;
+  void **nodes;
+  char **mins;
+  size_t count;
+  size_t height;
+
+  assert(oSymTable != NULL);
+
+  count = (oSymTable->size + LEAF_MAX - 1) / LEAF_MAX;
+  if(count == 0) count = 1;
+
+  newArena = Arena_new();
+  nodes = (void **) malloc(count * sizeof(void *));
+  mins = (char **) malloc(count * sizeof(char *));
+  if(newArena == NULL || nodes == NULL || mins == NULL
+  || !SymTable_build(oSymTable, newArena, count, nodes, mins, &height)){
+    if(newArena != NULL) Arena_free(newArena);
+    free(nodes);
+    free(mins);
+    return 0;
+  }
+
+  Arena_free(oSymTable->arena);
+  oSymTable->arena = newArena;
+  oSymTable->root = nodes[0];
+  oSymTable->height = height;
+  free(nodes);
+  free(mins);
+  return 1;
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable,
+  struct SymTable_Iter *psIter){
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+
+  psIter->table = oSymTable;
+  psIter->position = SymTable_leftmost(oSymTable);
+  psIter->index = 0;
+}
+
+int SymTable_iterNext(struct SymTable_Iter *psIter, const char **ppcKey,
+  void **ppvValue){
+  struct Leaf *leaf;
+
+  assert(psIter != NULL);
+  assert(ppcKey != NULL);
+  assert(ppvValue != NULL);
+
+  leaf = (struct Leaf *) psIter->position;
+  while(leaf != NULL && psIter->index == leaf->count){
+    leaf = leaf->next;
+    psIter->index = 0;
+  }
+  psIter->position = leaf;
+  if(leaf == NULL) return 0;
+
+  *ppcKey = leaf->keys[psIter->index];
+  *ppvValue = (void *) leaf->values[psIter->index];
+  psIter->index += 1;
+  return 1;
+}
+
+int SymTable_getStats(SymTable_T oSymTable,
+  struct SymTable_Stats *psStats){
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+
+  /*a tree has no buckets or chains to report on*/
+  return 0;
+}
+
+size_t SymTable_hash(const char *pcKey, size_t uLength){
+  assert(pcKey != NULL);
+  return StrHash_hash(pcKey, uLength);
+}
+
+static int SymTable_compare(const char *pcStored, const char *pcKey,
+  size_t uLength){
+  int result;
+
+  /*a borrowed key looked up by the same pointer, an interned one say,
+  is equal without reading its bytes*/
+  if(pcStored == pcKey && pcStored[uLength] == '\0') return 0;
+  /*strncmp stops at the end of pcStored, so a shorter stored key is
+  never read past its '\0'*/
+  result = strncmp(pcStored, pcKey, uLength);
+  if(result != 0) return result;
+  /*the first uLength bytes match, so pcStored is only bigger if it
+  goes on*/
+  return pcStored[uLength] != '\0';
+}
+
+static struct Leaf *SymTable_descend(SymTable_T oSymTable,
+  const char *pcKey, size_t uLength, struct Path *psPath){
+  void *node;
+  size_t level;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  node = oSymTable->root;
+  for(level = 0; level < oSymTable->height; level++){
+    struct Branch *branch = (struct Branch *) node;
+    size_t low = 0;
+    size_t high = branch->count - 1;
+
+    /*finds the first separator above pcKey. Keys equal to a separator
+    are under the child to its right*/
+    while(low < high){
+      size_t middle = low + (high - low) / 2;
+      if(SymTable_compare(branch->keys[middle], pcKey, uLength) <= 0)
+        low = middle + 1;
+      else high = middle;
+    }
+    if(psPath != NULL){
+      psPath->branches[level] = branch;
+      psPath->indexes[level] = low;
+    }
+    node = branch->children[low];
+  }
+  return (struct Leaf *) node;
+}
+
+static size_t SymTable_leafFind(struct Leaf *oLeaf, const char *pcKey,
+  size_t uLength, int *piFound){
+  size_t low = 0;
+  size_t high;
+
+  assert(oLeaf != NULL);
+  assert(piFound != NULL);
+
+  high = oLeaf->count;
+  while(low < high){
+    size_t middle = low + (high - low) / 2;
+    if(SymTable_compare(oLeaf->keys[middle], pcKey, uLength) < 0)
+      low = middle + 1;
+    else high = middle;
+  }
+  *piFound = low < oLeaf->count
+    && SymTable_compare(oLeaf->keys[low], pcKey, uLength) == 0;
+  return low;
+}
+
+static struct Leaf *SymTable_leftmost(SymTable_T oSymTable){
+  void *node;
+  size_t level;
+
+  assert(oSymTable != NULL);
+
+  node = oSymTable->root;
+  for(level = 0; level < oSymTable->height; level++)
+    node = ((struct Branch *) node)->children[0];
+  return (struct Leaf *) node;
+}
+
+static void SymTable_splitLeaf(struct Leaf *oLeaf, struct Leaf *oRight,
+  size_t uIndex, char *pcKey, const void *pvValue){
+  char *keys[LEAF_MAX + 1];
+  const void *values[LEAF_MAX + 1];
+  size_t leftCount = (LEAF_MAX + 1) / 2;
+  size_t i;
+
+  assert(oLeaf != NULL);
+  assert(oRight != NULL);
+  assert(oLeaf->count == LEAF_MAX);
+
+  /*lines up all LEAF_MAX + 1 bindings in order, then deals them out*/
+  for(i = 0; i < uIndex; i++){
+    keys[i] = oLeaf->keys[i];
+    values[i] = oLeaf->values[i];
+  }
+  keys[uIndex] = pcKey;
+  values[uIndex] = pvValue;
+  for(i = uIndex; i < LEAF_MAX; i++){
+    keys[i + 1] = oLeaf->keys[i];
+    values[i + 1] = oLeaf->values[i];
+  }
+
+  memcpy(oLeaf->keys, keys, leftCount * sizeof(char *));
+  memcpy(oLeaf->values, values, leftCount * sizeof(const void *));
+  oLeaf->count = leftCount;
+  memcpy(oRight->keys, keys + leftCount,
+    (LEAF_MAX + 1 - leftCount) * sizeof(char *));
+  memcpy(oRight->values, values + leftCount,
+    (LEAF_MAX + 1 - leftCount) * sizeof(const void *));
+  oRight->count = LEAF_MAX + 1 - leftCount;
+
+  oRight->next = oLeaf->next;
+  oLeaf->next = oRight;
+}
+
+static void SymTable_branchInsert(struct Branch *oBranch, size_t uIndex,
+  char *pcKey, void *oChild){
+  assert(oBranch != NULL);
+  assert(oBranch->count < BRANCH_MAX);
+  assert(uIndex < oBranch->count);
+
+  memmove(&oBranch->keys[uIndex + 1], &oBranch->keys[uIndex],
+    (oBranch->count - 1 - uIndex) * sizeof(char *));
+  memmove(&oBranch->children[uIndex + 2], &oBranch->children[uIndex + 1],
+    (oBranch->count - 1 - uIndex) * sizeof(void *));
+  oBranch->keys[uIndex] = pcKey;
+  oBranch->children[uIndex + 1] = oChild;
+  oBranch->count += 1;
+}
+
+static char *SymTable_splitBranch(struct Branch *oBranch,
+  struct Branch *oRight, size_t uIndex, char *pcKey, void *oChild){
+  char *keys[BRANCH_MAX];
+  void *children[BRANCH_MAX + 1];
+  size_t leftCount = (BRANCH_MAX + 2) / 2;
+  size_t i;
+
+  assert(oBranch != NULL);
+  assert(oRight != NULL);
+  assert(oBranch->count == BRANCH_MAX);
+
+  for(i = 0; i < uIndex; i++) keys[i] = oBranch->keys[i];
+  keys[uIndex] = pcKey;
+  for(i = uIndex; i < BRANCH_MAX - 1; i++) keys[i + 1] = oBranch->keys[i];
+  for(i = 0; i <= uIndex; i++) children[i] = oBranch->children[i];
+  children[uIndex + 1] = oChild;
+  for(i = uIndex + 1; i < BRANCH_MAX; i++)
+    children[i + 1] = oBranch->children[i];
+
+  /*the key between the two halves moves up instead of staying in
+  either*/
+  memcpy(oBranch->keys, keys, (leftCount - 1) * sizeof(char *));
+  memcpy(oBranch->children, children, leftCount * sizeof(void *));
+  oBranch->count = leftCount;
+  memcpy(oRight->keys, keys + leftCount,
+    (BRANCH_MAX - leftCount) * sizeof(char *));
+  memcpy(oRight->children, children + leftCount,
+    (BRANCH_MAX + 1 - leftCount) * sizeof(void *));
+  oRight->count = BRANCH_MAX + 1 - leftCount;
+  return keys[leftCount - 1];
+}
+
+static void SymTable_removeChild(struct Branch *oBranch, size_t uIndex){
+  assert(oBranch != NULL);
+  assert(uIndex > 0 && uIndex < oBranch->count);
+
+  memmove(&oBranch->keys[uIndex - 1], &oBranch->keys[uIndex],
+    (oBranch->count - 1 - uIndex) * sizeof(char *));
+  memmove(&oBranch->children[uIndex], &oBranch->children[uIndex + 1],
+    (oBranch->count - 1 - uIndex) * sizeof(void *));
+  oBranch->count -= 1;
+}
+
+static void SymTable_rebalance(SymTable_T oSymTable,
+  struct Path *psPath){
+  size_t level;
+
+  assert(oSymTable != NULL);
+  assert(psPath != NULL);
+
+  for(level = oSymTable->height; level > 0; level--){
+    struct Branch *parent = psPath->branches[level - 1];
+    size_t index = psPath->indexes[level - 1];
+    if(level == oSymTable->height){
+      if(((struct Leaf *) parent->children[index])->count >= LEAF_MIN)
+        return;
+      SymTable_fixLeaf(oSymTable, parent, index);
+    }
+    else {
+      if(((struct Branch *) parent->children[index])->count >= BRANCH_MIN)
+        return;
+      SymTable_fixBranch(oSymTable, parent, index);
+    }
+  }
+
+  /*a root Branch left with one child hands the root to that child*/
+  if(oSymTable->height > 0
+  && ((struct Branch *) oSymTable->root)->count == 1){
+    struct Branch *root = (struct Branch *) oSymTable->root;
+    oSymTable->root = root->children[0];
+    oSymTable->height -= 1;
+    Arena_release(oSymTable->arena, root, sizeof(struct Branch));
+  }
+}
+
+static void SymTable_fixLeaf(SymTable_T oSymTable,
+  struct Branch *oParent, size_t uIndex){
+  struct Leaf *leaf;
+  struct Leaf *left = NULL;
+  struct Leaf *right = NULL;
+
+  assert(oSymTable != NULL);
+  assert(oParent != NULL);
+
+  leaf = (struct Leaf *) oParent->children[uIndex];
+  if(uIndex > 0) left = (struct Leaf *) oParent->children[uIndex - 1];
+  if(uIndex + 1 < oParent->count)
+    right = (struct Leaf *) oParent->children[uIndex + 1];
+
+  if(left != NULL && left->count > LEAF_MIN){
+    /*takes the last binding of the left sibling, which becomes the
+    smallest key of leaf*/
+    memmove(&leaf->keys[1], &leaf->keys[0], leaf->count * sizeof(char *));
+    memmove(&leaf->values[1], &leaf->values[0],
+      leaf->count * sizeof(const void *));
+    leaf->keys[0] = left->keys[left->count - 1];
+    leaf->values[0] = left->values[left->count - 1];
+    leaf->count += 1;
+    left->count -= 1;
+    oParent->keys[uIndex - 1] = leaf->keys[0];
+  }
+  else if(right != NULL && right->count > LEAF_MIN){
+    /*takes the first binding of the right sibling*/
+    leaf->keys[leaf->count] = right->keys[0];
+    leaf->values[leaf->count] = right->values[0];
+    leaf->count += 1;
+    memmove(&right->keys[0], &right->keys[1],
+      (right->count - 1) * sizeof(char *));
+    memmove(&right->values[0], &right->values[1],
+      (right->count - 1) * sizeof(const void *));
+    right->count -= 1;
+    oParent->keys[uIndex] = right->keys[0];
+  }
+  else if(left != NULL){
+    /*both fit in one Leaf, so leaf is emptied into left*/
+    memcpy(&left->keys[left->count], leaf->keys,
+      leaf->count * sizeof(char *));
+    memcpy(&left->values[left->count], leaf->values,
+      leaf->count * sizeof(const void *));
+    left->count += leaf->count;
+    left->next = leaf->next;
+    SymTable_removeChild(oParent, uIndex);
+    Arena_release(oSymTable->arena, leaf, sizeof(struct Leaf));
+  }
+  else {
+    assert(right != NULL);
+    memcpy(&leaf->keys[leaf->count], right->keys,
+      right->count * sizeof(char *));
+    memcpy(&leaf->values[leaf->count], right->values,
+      right->count * sizeof(const void *));
+    leaf->count += right->count;
+    leaf->next = right->next;
+    SymTable_removeChild(oParent, uIndex + 1);
+    Arena_release(oSymTable->arena, right, sizeof(struct Leaf));
+  }
+}
+
+static void SymTable_fixBranch(SymTable_T oSymTable,
+  struct Branch *oParent, size_t uIndex){
+  struct Branch *branch;
+  struct Branch *left = NULL;
+  struct Branch *right = NULL;
+
+  assert(oSymTable != NULL);
+  assert(oParent != NULL);
+
+  branch = (struct Branch *) oParent->children[uIndex];
+  if(uIndex > 0) left = (struct Branch *) oParent->children[uIndex - 1];
+  if(uIndex + 1 < oParent->count)
+    right = (struct Branch *) oParent->children[uIndex + 1];
+
+  if(left != NULL && left->count > BRANCH_MIN){
+    /*rotates through the parent: its separator comes down in front of
+    branch and the last key of left goes up in its place*/
+    memmove(&branch->keys[1], &branch->keys[0],
+      (branch->count - 1) * sizeof(char *));
+    memmove(&branch->children[1], &branch->children[0],
+      branch->count * sizeof(void *));
+    branch->keys[0] = oParent->keys[uIndex - 1];
+    branch->children[0] = left->children[left->count - 1];
+    branch->count += 1;
+    oParent->keys[uIndex - 1] = left->keys[left->count - 2];
+    left->count -= 1;
+  }
+  else if(right != NULL && right->count > BRANCH_MIN){
+    branch->keys[branch->count - 1] = oParent->keys[uIndex];
+    branch->children[branch->count] = right->children[0];
+    branch->count += 1;
+    oParent->keys[uIndex] = right->keys[0];
+    memmove(&right->keys[0], &right->keys[1],
+      (right->count - 2) * sizeof(char *));
+    memmove(&right->children[0], &right->children[1],
+      (right->count - 1) * sizeof(void *));
+    right->count -= 1;
+  }
+  else {
+    /*merges the pair, with the parent's separator between them coming
+    down*/
+    struct Branch *into = left != NULL ? left : branch;
+    struct Branch *from = left != NULL ? branch : right;
+    size_t fromIndex = left != NULL ? uIndex : uIndex + 1;
+
+    assert(from != NULL);
+    into->keys[into->count - 1] = oParent->keys[fromIndex - 1];
+    memcpy(&into->keys[into->count], from->keys,
+      (from->count - 1) * sizeof(char *));
+    memcpy(&into->children[into->count], from->children,
+      from->count * sizeof(void *));
+    into->count += from->count;
+    SymTable_removeChild(oParent, fromIndex);
+    Arena_release(oSymTable->arena, from, sizeof(struct Branch));
+  }
+}
+
+static int SymTable_build(SymTable_T oSymTable, Arena_T oArena,
+  size_t uLeafCount, void **ppvNodes, char **ppcMins, size_t *puHeight){
+  struct Leaf *source;
+  struct Leaf *previous = NULL;
+  size_t sourceIndex = 0;
+  size_t count = uLeafCount;
+  size_t u;
+
+  assert(oSymTable != NULL);
+  assert(oArena != NULL);
+  assert(puHeight != NULL);
+
+  /*copies the bindings in order into the Leaves, spread evenly so that
+  every Leaf is over half full*/
+  source = SymTable_leftmost(oSymTable);
+  for(u = 0; u < count; u++){
+    size_t take = oSymTable->size / count
+      + (u < oSymTable->size % count ? 1 : 0);
+    struct Leaf *leaf = (struct Leaf *) Arena_alloc(oArena,
+      sizeof(struct Leaf));
+    if(leaf == NULL) return 0;
+    leaf->count = 0;
+    leaf->next = NULL;
+    if(previous != NULL) previous->next = leaf;
+    previous = leaf;
+
+    while(leaf->count < take){
+      char *key;
+      while(sourceIndex == source->count){
+        source = source->next;
+        sourceIndex = 0;
+      }
+      key = SymTable_storeKey(oSymTable, oArena, source->keys[sourceIndex],
+        strlen(source->keys[sourceIndex]));
+      if(key == NULL) return 0;
+      leaf->keys[leaf->count] = key;
+      leaf->values[leaf->count] = source->values[sourceIndex];
+      leaf->count += 1;
+      sourceIndex += 1;
+    }
+    ppvNodes[u] = leaf;
+    ppcMins[u] = leaf->count > 0 ? leaf->keys[0] : NULL;
+  }
+
+  /*builds each Branch level over the one below in the same way until
+  one node is left. A level is written over the front of the arrays it
+  reads, which it never overtakes*/
+  *puHeight = 0;
+  while(count > 1){
+    size_t parents = (count + BRANCH_MAX - 1) / BRANCH_MAX;
+    size_t from = 0;
+    for(u = 0; u < parents; u++){
+      size_t take = count / parents + (u < count % parents ? 1 : 0);
+      size_t c;
+      struct Branch *branch = (struct Branch *) Arena_alloc(oArena,
+        sizeof(struct Branch));
+      if(branch == NULL) return 0;
+      branch->count = take;
+      for(c = 0; c < take; c++){
+        branch->children[c] = ppvNodes[from + c];
+        if(c > 0) branch->keys[c - 1] = ppcMins[from + c];
+      }
+      ppvNodes[u] = branch;
+      ppcMins[u] = ppcMins[from];
+      from += take;
+    }
+    count = parents;
+    *puHeight += 1;
+  }
+  return 1;
+}
+
+static char *SymTable_storeKey(SymTable_T oSymTable, Arena_T oArena,
+  const char *pcKey, size_t uLength){
+  char *copy;
+
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /*the tree never writes through a key, so a borrowed one can sit in
+  the same char * arrays as the copies*/
+  if(oSymTable->borrowed) return (char *) pcKey;
+  copy = (char *) Arena_alloc(oArena, sizeof(char) * (uLength + 1));
+  if(copy == NULL) return NULL;
+  memcpy(copy, pcKey, uLength);
+  copy[uLength] = '\0';
+  return copy;
+}
+
+static void SymTable_freeKey(SymTable_T oSymTable, char *pcKey){
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if(oSymTable->borrowed) return;
+  Arena_release(oSymTable->arena, pcKey,
+    sizeof(char) * (strlen(pcKey) + 1));
+}
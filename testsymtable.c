@@ -4,6 +4,7 @@
 /*--------------------------------------------------------------------*/
 
 #include "symtable.h"
+#include "intern.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -436,6 +437,11 @@ static void testMap(void)
 static void testEmptyTable(void)
 {
    SymTable_T oSymTable;
+   struct SymTable_Iter sIter;
+   const char *apcKeys[] = {"Jeter", "Ruth"};
+   void *apvValues[2];
+   const char *pcKey;
+   void *pvValue;
    char *pcValue;
    int iFound;
    size_t uLength;
@@ -462,6 +468,30 @@ static void testEmptyTable(void)
 
    SymTable_map(oSymTable, printBinding, "%s\t%s\n");
 
+   /* The rest of the functions that only read work on a table that
+      has never been put into as well. */
+   ASSURE(! SymTable_containsHashed(oSymTable, "Jeter", 5,
+      SymTable_hash("Jeter", 5)));
+   ASSURE(SymTable_replace(oSymTable, "Jeter", "Shortstop") == NULL);
+   apvValues[0] = apvValues[1] = "Shortstop";
+   SymTable_getBatch(oSymTable, apcKeys, 2, apvValues);
+   ASSURE(apvValues[0] == NULL && apvValues[1] == NULL);
+   SymTable_mapParallel(oSymTable, printBinding, "%s\t%s\n", 0);
+   SymTable_iterBegin(oSymTable, &sIter);
+   ASSURE(! SymTable_iterNext(&sIter, &pcKey, &pvValue));
+   ASSURE(SymTable_compact(oSymTable));
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   /* A table emptied again and compacted is as good as new. */
+   ASSURE(SymTable_put(oSymTable, "Jeter", "Shortstop"));
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "Jeter"), "Shortstop")
+      == 0);
+   ASSURE(SymTable_remove(oSymTable, "Jeter") != NULL);
+   ASSURE(SymTable_compact(oSymTable));
+   ASSURE(SymTable_get(oSymTable, "Jeter") == NULL);
+   ASSURE(SymTable_put(oSymTable, "Ruth", "Right Field"));
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+
    SymTable_free(oSymTable);
 }
 
@@ -696,86 +726,1311 @@ static void testTableOfTables(void)
 
 /*--------------------------------------------------------------------*/
 
-/* Test the ability of a SymTable object to handle collisions.  This
-   test assumes that a SymTable object is implemented as a hash table,
-   that there are 509 buckets in the hash table, and that the
-   implementation uses the hash function provided in the assignment
-   specification. */
+/* Test the ability of a SymTable object to handle collisions.  The
+   keys are the first decimal numbers whose SymTable_hash() values agree
+   in their low bits, so that they share a bucket in a hash table of up
+   to BUCKET_COUNT buckets, the starting size of symtablehash.c, and a
+   home slot in the flat table. */
 
 static void testCollisions(void)
 {
+   enum {BUCKET_COUNT = 512, KEY_COUNT = 5, MAX_KEY_LENGTH = 12};
+
    SymTable_T oSymTable;
    int iSuccessful;
+   char acKeys[KEY_COUNT][MAX_KEY_LENGTH];
    char acCenterField[] = "pitcher";
    char acCatcher[] = "catcher";
    char acFirstBase[] = "first base";
    char acRightField[] = "second base";
    char *pcValue;
+   size_t uLength;
+   int iNumber = 0;
+   int i;
 
    printf("------------------------------------------------------\n");
    printf("Testing the collision handling of a SymTable object\n");
-   printf("assuming a hash table implementation, and assuming that\n");
-   printf("the implementation uses the hash function from the\n");
-   printf("assignment specification.\n");
+   printf("with keys whose hashes share their low bits.\n");
    printf("No output should appear here:\n");
    fflush(stdout);
 
+   /* Find KEY_COUNT keys in bucket 0 of BUCKET_COUNT buckets. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      do
+         uLength = (size_t)sprintf(acKeys[i], "%d", iNumber++);
+      while ((SymTable_hash(acKeys[i], uLength) & (BUCKET_COUNT - 1))
+         != 0);
+   }
+
    oSymTable = SymTable_new();
    ASSURE(oSymTable != NULL);
 
-   /* Note that strings "250", "469", "947", "1303", and "2016" hash
-      to the same bucket -- bucket 123. */
-
-   iSuccessful = SymTable_put(oSymTable, "250", acCenterField);
+   iSuccessful = SymTable_put(oSymTable, acKeys[0], acCenterField);
    ASSURE(iSuccessful);
 
-   iSuccessful = SymTable_put(oSymTable, "469", acCatcher);
+   iSuccessful = SymTable_put(oSymTable, acKeys[1], acCatcher);
    ASSURE(iSuccessful);
 
-   iSuccessful = SymTable_put(oSymTable, "947", acFirstBase);
+   iSuccessful = SymTable_put(oSymTable, acKeys[2], acFirstBase);
    ASSURE(iSuccessful);
 
-   iSuccessful = SymTable_put(oSymTable, "1303", acRightField);
+   iSuccessful = SymTable_put(oSymTable, acKeys[3], acRightField);
    ASSURE(iSuccessful);
 
-   iSuccessful = SymTable_put(oSymTable, "2016", acRightField);
+   iSuccessful = SymTable_put(oSymTable, acKeys[4], acRightField);
    ASSURE(iSuccessful);
 
-   pcValue = SymTable_get(oSymTable, "250");
+   /* A key already in the shared chain is refused. */
+   iSuccessful = SymTable_put(oSymTable, acKeys[2], acCatcher);
+   ASSURE(! iSuccessful);
+
+   pcValue = SymTable_get(oSymTable, acKeys[0]);
    ASSURE(pcValue == acCenterField);
 
-   pcValue = SymTable_get(oSymTable, "469");
+   pcValue = SymTable_get(oSymTable, acKeys[1]);
    ASSURE(pcValue == acCatcher);
 
-   pcValue = SymTable_get(oSymTable, "947");
+   pcValue = SymTable_get(oSymTable, acKeys[2]);
    ASSURE(pcValue == acFirstBase);
 
-   pcValue = SymTable_get(oSymTable, "1303");
+   pcValue = SymTable_get(oSymTable, acKeys[3]);
    ASSURE(pcValue == acRightField);
 
-   pcValue = SymTable_get(oSymTable, "2016");
+   pcValue = SymTable_get(oSymTable, acKeys[4]);
    ASSURE(pcValue == acRightField);
 
-   pcValue = SymTable_remove(oSymTable, "947");
+   pcValue = SymTable_replace(oSymTable, acKeys[3], acFirstBase);
+   ASSURE(pcValue == acRightField);
+
+   pcValue = SymTable_get(oSymTable, acKeys[3]);
+   ASSURE(pcValue == acFirstBase);
+
+   pcValue = SymTable_remove(oSymTable, acKeys[2]);
    ASSURE(pcValue == acFirstBase);
 
-   pcValue = SymTable_remove(oSymTable, "2016");
+   pcValue = SymTable_remove(oSymTable, acKeys[4]);
    ASSURE(pcValue == acRightField);
 
-   pcValue = SymTable_remove(oSymTable, "250");
+   pcValue = SymTable_remove(oSymTable, acKeys[0]);
    ASSURE(pcValue == acCenterField);
 
-   pcValue = SymTable_get(oSymTable, "469");
+   pcValue = SymTable_get(oSymTable, acKeys[1]);
    ASSURE(pcValue == acCatcher);
 
-   pcValue = SymTable_get(oSymTable, "1303");
+   pcValue = SymTable_get(oSymTable, acKeys[3]);
+   ASSURE(pcValue == acFirstBase);
+
+   ASSURE(! SymTable_contains(oSymTable, acKeys[2]));
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_getStats(), if the implementation keeps statistics:
+   the counts must match the calls made, a table of buckets must have
+   resized, and the chain histogram must account for every binding. */
+
+static void testStats(void)
+{
+   enum {KEY_COUNT = 10000, MISS_COUNT = 10, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   struct SymTable_Stats sStats;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   size_t uBindings = 0;
+   size_t uBuckets = 0;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing statistics, if the implementation keeps them.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   if (! SymTable_getStats(oSymTable, &sStats))
+   {
+      SymTable_free(oSymTable);
+      return;
+   }
+   ASSURE(sStats.gets == 0);
+   ASSURE(sStats.puts == 0);
+   ASSURE(sStats.resizes == 0);
+   ASSURE(sStats.chains[0] > 0);
+   ASSURE(sStats.bytes > 0);
+
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, acValue));
+   }
+   /* A put of a key already there is counted too. */
+   ASSURE(! SymTable_put(oSymTable, "0", acValue));
+   for (i = 0; i < KEY_COUNT + MISS_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey)
+         == (i < KEY_COUNT ? acValue : NULL));
+   }
+
+   ASSURE(SymTable_getStats(oSymTable, &sStats));
+   ASSURE(sStats.puts == KEY_COUNT + 1);
+   ASSURE(sStats.putProbes >= 1);
+   ASSURE(sStats.gets == KEY_COUNT + MISS_COUNT);
+   ASSURE(sStats.hits == KEY_COUNT);
+   ASSURE(sStats.misses == MISS_COUNT);
+   ASSURE(sStats.getProbes >= KEY_COUNT);
+   ASSURE(sStats.resizeSeconds >= 0.0);
+   ASSURE(sStats.bytes > KEY_COUNT);
+   for (i = 0; i < SYMTABLE_STATS_CHAINS; i++)
+   {
+      uBindings += (size_t)i * sStats.chains[i];
+      uBuckets += sStats.chains[i];
+   }
+   /* A table of buckets must have grown past its first array by now.
+      A list reports itself as one chain and never resizes. */
+   if (uBuckets > 1)
+      ASSURE(sStats.resizes >= 1);
+   ASSURE(uBindings == KEY_COUNT
+      || (sStats.chains[SYMTABLE_STATS_CHAINS - 1] > 0
+          && uBindings < KEY_COUNT));
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the functions that take a key length and precomputed hash. */
+
+static void testHashed(void)
+{
+   SymTable_T oSymTable;
+   SymTable_T oSymTable2;
+   /* The keys "Ruth", "Ruth Babe", and "Babe" are slices of acLine,
+      none of them '\0' terminated where they end. */
+   char acLine[] = "Ruth Babe Ruth";
+   char acRightField[] = "RightField";
+   char acPitcher[] = "Pitcher";
+   size_t uHashRuth;
+   size_t uHashBabe;
+   char *pcValue;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the hashed functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   uHashRuth = SymTable_hash(acLine, 4);
+   uHashBabe = SymTable_hash(acLine + 5, 4);
+   ASSURE(uHashRuth == SymTable_hash("Ruth", strlen("Ruth")));
+   ASSURE(uHashRuth == SymTable_hash(acLine + 10, 4));
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   iSuccessful = SymTable_putHashed(oSymTable, acLine, 4, uHashRuth,
+      acRightField);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putHashed(oSymTable, acLine + 10, 4,
+      uHashRuth, acPitcher);
+   ASSURE(! iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+
+   /* The stored key is a '\0' terminated copy of the slice. */
+   pcValue = (char*)SymTable_get(oSymTable, "Ruth");
+   ASSURE(pcValue == acRightField);
+   ASSURE(! SymTable_contains(oSymTable, "Ruth Babe"));
+   ASSURE(! SymTable_contains(oSymTable, "Rut"));
+
+   /* A longer or shorter slice with the same prefix is another key. */
+   ASSURE(! SymTable_containsHashed(oSymTable, acLine, 9,
+      SymTable_hash(acLine, 9)));
+   ASSURE(! SymTable_containsHashed(oSymTable, acLine, 3,
+      SymTable_hash(acLine, 3)));
+   ASSURE(SymTable_containsHashed(oSymTable, acLine + 10, 4,
+      uHashRuth));
+
+   iSuccessful = SymTable_put(oSymTable, "Babe", acPitcher);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_getHashed(oSymTable, acLine + 5, 4,
+      uHashBabe);
+   ASSURE(pcValue == acPitcher);
+
+   pcValue = (char*)SymTable_replaceHashed(oSymTable, acLine + 5, 4,
+      uHashBabe, acRightField);
+   ASSURE(pcValue == acPitcher);
+   pcValue = (char*)SymTable_get(oSymTable, "Babe");
    ASSURE(pcValue == acRightField);
 
+   /* One hash serves lookups in any number of tables. */
+   oSymTable2 = SymTable_new();
+   ASSURE(oSymTable2 != NULL);
+   iSuccessful = SymTable_putHashed(oSymTable2, acLine, 4, uHashRuth,
+      acPitcher);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_getHashed(oSymTable2, acLine + 10, 4,
+      uHashRuth);
+   ASSURE(pcValue == acPitcher);
+   pcValue = (char*)SymTable_getHashed(oSymTable, acLine + 10, 4,
+      uHashRuth);
+   ASSURE(pcValue == acRightField);
+
+   pcValue = (char*)SymTable_removeHashed(oSymTable, acLine, 4,
+      uHashRuth);
+   ASSURE(pcValue == acRightField);
+   pcValue = (char*)SymTable_removeHashed(oSymTable, acLine, 4,
+      uHashRuth);
+   ASSURE(pcValue == NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(SymTable_contains(oSymTable2, "Ruth"));
+
+   /* The empty slice is the empty key. */
+   iSuccessful = SymTable_putHashed(oSymTable, acLine, 0,
+      SymTable_hash(acLine, 0), acPitcher);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_get(oSymTable, "");
+   ASSURE(pcValue == acPitcher);
+
+   SymTable_free(oSymTable);
+   SymTable_free(oSymTable2);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_putUnique() and SymTable_putUniqueHashed(), which the
+   caller only passes keys not yet in the table. */
+
+static void testPutUnique(void)
+{
+   enum {KEY_COUNT = 1000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acLine[] = "Ruth Babe";
+   char acValue[] = "value";
+   char acOther[] = "other";
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing puts of keys known to be new.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_putUnique(oSymTable, acKey, acValue));
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+
+   /* The bindings are ordinary ones: found by every lookup, and a
+      normal put still refuses their keys. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == acValue);
+      ASSURE(! SymTable_put(oSymTable, acKey, acOther));
+   }
+   ASSURE(SymTable_get(oSymTable, "-1") == NULL);
+
+   /* A key of known length and hash need not be '\0' terminated. */
+   ASSURE(SymTable_putUniqueHashed(oSymTable, acLine, 4,
+      SymTable_hash(acLine, 4), acOther));
+   ASSURE(SymTable_get(oSymTable, "Ruth") == acOther);
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT + 1);
+
+   /* Removed keys are new again. */
+   for (i = 0; i < KEY_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == acValue);
+   }
+   for (i = 0; i < KEY_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_putUnique(oSymTable, acKey, acOther));
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT + 1);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey)
+         == (i % 2 == 0 ? acOther : acValue));
+   }
+   ASSURE(SymTable_remove(oSymTable, "Ruth") == acOther);
+   ASSURE(SymTable_putUnique(oSymTable, "Ruth", acValue));
+   ASSURE(SymTable_get(oSymTable, "Ruth") == acValue);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_getBatch() and SymTable_putBatch() functions. */
+
+static void testBatch(void)
+{
+   enum {KEY_COUNT = 100, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char aacKeys[KEY_COUNT][MAX_KEY_LENGTH];
+   const char *apcKeys[KEY_COUNT];
+   const void *apvValues[KEY_COUNT];
+   void *apvResults[KEY_COUNT];
+   char acValue[] = "value";
+   char acOther[] = "other";
+   size_t uAdded;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the batch functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* The batch has more keys than an implementation is likely to
+      resolve at once, and its last quarter repeats its first. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(aacKeys[i], "%d", i < KEY_COUNT * 3 / 4 ? i : i - 50);
+      apcKeys[i] = aacKeys[i];
+      apvValues[i] = (i < KEY_COUNT * 3 / 4) ? acValue : acOther;
+   }
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   ASSURE(SymTable_putBatch(oSymTable, apcKeys, apvValues, 0) == 0);
+   SymTable_getBatch(oSymTable, apcKeys, 0, apvResults);
+
+   uAdded = SymTable_putBatch(oSymTable, apcKeys, apvValues, KEY_COUNT);
+   ASSURE(uAdded == KEY_COUNT * 3 / 4);
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT * 3 / 4);
+
+   /* The repeated keys kept the values of their first put. */
+   SymTable_getBatch(oSymTable, apcKeys, KEY_COUNT, apvResults);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(apvResults[i] == acValue);
+
+   /* Keys that are not in the table give NULL. */
+   for (i = 0; i < KEY_COUNT; i++)
+      sprintf(aacKeys[i], "x%d", i);
+   SymTable_getBatch(oSymTable, apcKeys, KEY_COUNT, apvResults);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(apvResults[i] == NULL);
+
+   /* Only the odd keys of a mixed batch are found. */
+   for (i = 0; i < KEY_COUNT; i++)
+      sprintf(aacKeys[i], (i % 2 == 1) ? "%d" : "x%d", i);
+   SymTable_getBatch(oSymTable, apcKeys, KEY_COUNT, apvResults);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(apvResults[i] == ((i % 2 == 1 && i < KEY_COUNT * 3 / 4)
+         ? (void*)acValue : NULL));
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Append pcKey to the array of keys whose next free element is
+   pointed to by pvExtra.  pvValue is unused. */
+
+static void appendKey(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   const char ***pppcNext = (const char***)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+   (void)pvValue;
+
+   **pppcNext = pcKey;
+   (*pppcNext)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_iterBegin() and SymTable_iterNext() functions. */
+
+static void testIterator(void)
+{
+   enum {KEY_COUNT = 1000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   struct SymTable_Iter sIter;
+   char acKey[MAX_KEY_LENGTH];
+   const char *apcMapped[KEY_COUNT];
+   const char **ppcNext;
+   char acSeen[KEY_COUNT];
+   char acValue[] = "value";
+   char acOther[] = "other";
+   const char *pcKey;
+   void *pvValue;
+   int iCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the iterator.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* An empty table has nothing to visit. */
+   SymTable_iterBegin(oSymTable, &sIter);
+   pcKey = NULL;
+   ASSURE(! SymTable_iterNext(&sIter, &pcKey, &pvValue));
+   ASSURE(pcKey == NULL);
+
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, acValue));
+   }
+
+   /* Every binding is visited once, in the order of SymTable_map(). */
+   ppcNext = apcMapped;
+   SymTable_map(oSymTable, appendKey, &ppcNext);
+   ASSURE(ppcNext == apcMapped + KEY_COUNT);
+   memset(acSeen, 0, sizeof(acSeen));
+   iCount = 0;
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+   {
+      ASSURE(iCount < KEY_COUNT);
+      if (iCount >= KEY_COUNT)
+         break;
+      ASSURE(pcKey == apcMapped[iCount]);
+      ASSURE(pvValue == acValue);
+      i = atoi(pcKey);
+      ASSURE(! acSeen[i]);
+      acSeen[i] = 1;
+      iCount++;
+   }
+   ASSURE(iCount == KEY_COUNT);
+   ASSURE(! SymTable_iterNext(&sIter, &pcKey, &pvValue));
+
+   /* SymTable_replace() is allowed during a traversal. */
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+      SymTable_replace(oSymTable, pcKey, acOther);
+   ASSURE(SymTable_get(oSymTable, "0") == acOther);
+   ASSURE(SymTable_get(oSymTable, "999") == acOther);
+
+   /* Only the bindings left after removes are visited. */
+   for (i = 0; i < KEY_COUNT; i++)
+      if (i % 100 != 7)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymTable_remove(oSymTable, acKey) == acOther);
+      }
+   iCount = 0;
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+   {
+      ASSURE(atoi(pcKey) % 100 == 7);
+      ASSURE(pvValue == acOther);
+      iCount++;
+   }
+   ASSURE(iCount == KEY_COUNT / 100);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the place of pcKey in a traversal of oSymTable, or -1 if the
+   traversal does not visit it. */
+
+static int getPlace(SymTable_T oSymTable, const char *pcKey)
+{
+   struct SymTable_Iter sIter;
+   const char *pcVisited;
+   void *pvValue;
+   int iPlace = 0;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcVisited, &pvValue))
+   {
+      if (strcmp(pcVisited, pcKey) == 0)
+         return iPlace;
+      iPlace++;
+   }
+   return -1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that SymTable_get() moves a key toward the front of a
+   self-organizing list, which testsymtablelistmtf and
+   testsymtablelisttranspose compile this file for with the LISTFLAGS
+   of their list (see the Makefile), and that it leaves the order of
+   any other table alone. */
+
+static void testReorder(void)
+{
+   enum {KEY_COUNT = 8, GET_COUNT = 3, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   struct SymTable_Iter sIter;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   const char *pcKey;
+   void *pvValue;
+   int iExpected;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the order of a traversal after lookups.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, acValue));
+   }
+
+   /* Look up the key visited last. It is copied out first, so that
+      no lookup happens during the traversal. */
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+      strcpy(acKey, pcKey);
+   ASSURE(getPlace(oSymTable, acKey) == KEY_COUNT - 1);
+   for (i = 0; i < GET_COUNT; i++)
+      ASSURE(SymTable_get(oSymTable, acKey) == acValue);
+#if defined(SYMTABLELIST_MOVE_TO_FRONT)
+   iExpected = 0;
+#elif defined(SYMTABLELIST_TRANSPOSE)
+   iExpected = KEY_COUNT - 1 - GET_COUNT;
+#else
+   iExpected = KEY_COUNT - 1;
+#endif
+   ASSURE(getPlace(oSymTable, acKey) == iExpected);
+
+   /* A miss moves nothing. */
+   ASSURE(SymTable_get(oSymTable, "-1") == NULL);
+   ASSURE(getPlace(oSymTable, acKey) == iExpected);
+
+   /* A list still puts new keys at its end after its last key moved. */
+   ASSURE(SymTable_put(oSymTable, "new", acValue));
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT + 1);
+#if defined(SYMTABLELIST_MOVE_TO_FRONT) || defined(SYMTABLELIST_TRANSPOSE)
+   ASSURE(getPlace(oSymTable, "new") == KEY_COUNT);
+#else
+   ASSURE(getPlace(oSymTable, "new") >= 0);
+#endif
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_compact() function, and tables that shrink as
+   bindings are removed. */
+
+static void testCompact(void)
+{
+   enum {KEY_COUNT = 5000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   int iRound;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing compaction and shrinking.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Compacting an empty table changes nothing. */
+   ASSURE(SymTable_compact(oSymTable));
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   /* Each round grows the table well past its starting size and then
+      removes nearly everything, so it shrinks back. */
+   for (iRound = 0; iRound < 3; iRound++)
+   {
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymTable_put(oSymTable, acKey, acValue));
+      }
+      ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+      for (i = 0; i < KEY_COUNT; i++)
+         if (i % 500 != 0)
+         {
+            sprintf(acKey, "%d", i);
+            ASSURE(SymTable_remove(oSymTable, acKey) == acValue);
+         }
+      ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT / 500);
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymTable_contains(oSymTable, acKey) == (i % 500 == 0));
+      }
+
+      ASSURE(SymTable_compact(oSymTable));
+      ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT / 500);
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE((SymTable_get(oSymTable, acKey) == acValue)
+            == (i % 500 == 0));
+      }
+      for (i = 0; i < KEY_COUNT; i += 500)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymTable_remove(oSymTable, acKey) == acValue);
+      }
+      ASSURE(SymTable_getLength(oSymTable) == 0);
+   }
+
+   /* Compacting straight after a put that made the table grow. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, acValue));
+      if (i % 1000 == 999)
+         ASSURE(SymTable_compact(oSymTable));
+   }
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == acValue);
+   }
+   ASSURE(SymTable_compact(oSymTable));
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test tables of every size up to a few dozen bindings, with short and
+   long keys, as they grow, shrink and are compacted, which is where an
+   adaptive table changes its layout. */
+
+static void testSmallTables(void)
+{
+   enum {MAX_SIZE = 40, MAX_KEY_LENGTH = 64};
+
+   SymTable_T oSymTable;
+   struct SymTable_Iter sIter;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   const char *apcVisited[MAX_SIZE];
+   const char *pcKey;
+   void *pvValue;
+   int iSize;
+   int iCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing small tables.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   for (iSize = 0; iSize <= MAX_SIZE; iSize++)
+   {
+      oSymTable = iSize % 2 == 0 ? SymTable_new()
+         : SymTable_newWithCapacity((size_t)iSize);
+      ASSURE(oSymTable != NULL);
+
+      /* Odd keys are too long to be stored inline. */
+      for (i = 0; i < iSize; i++)
+      {
+         sprintf(acKey, i % 2 == 0 ? "k%d"
+            : "a key that is too long to fit in a slot %d", i);
+         ASSURE(SymTable_put(oSymTable, acKey, acValue));
+         ASSURE(! SymTable_put(oSymTable, acKey, acValue));
+      }
+      ASSURE(SymTable_getLength(oSymTable) == (size_t)iSize);
+
+      /* The keys are looked up once the traversal ends, since a
+         self-organizing list is reordered by SymTable_get(). */
+      iCount = 0;
+      SymTable_iterBegin(oSymTable, &sIter);
+      while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+      {
+         ASSURE(iCount < iSize);
+         if (iCount >= iSize)
+            break;
+         apcVisited[iCount] = pcKey;
+         iCount++;
+      }
+      ASSURE(iCount == iSize);
+      for (i = 0; i < iCount; i++)
+         ASSURE(SymTable_get(oSymTable, apcVisited[i]) == acValue);
+
+      /* Removing two thirds and compacting keeps the rest. */
+      for (i = 0; i < iSize; i++)
+         if (i % 3 != 0)
+         {
+            sprintf(acKey, i % 2 == 0 ? "k%d"
+               : "a key that is too long to fit in a slot %d", i);
+            ASSURE(SymTable_remove(oSymTable, acKey) == acValue);
+         }
+      ASSURE(SymTable_compact(oSymTable));
+      ASSURE(SymTable_getLength(oSymTable) == (size_t)(iSize + 2) / 3);
+      for (i = 0; i < iSize; i++)
+      {
+         sprintf(acKey, i % 2 == 0 ? "k%d"
+            : "a key that is too long to fit in a slot %d", i);
+         ASSURE((SymTable_get(oSymTable, acKey) == acValue)
+            == (i % 3 == 0));
+      }
+
+      /* The table grows again after compacting. */
+      ASSURE(SymTable_reserve(oSymTable, (size_t)iSize));
+      for (i = 0; i < iSize; i++)
+         if (i % 3 != 0)
+         {
+            sprintf(acKey, i % 2 == 0 ? "k%d"
+               : "a key that is too long to fit in a slot %d", i);
+            ASSURE(SymTable_put(oSymTable, acKey, acValue));
+         }
+      ASSURE(SymTable_getLength(oSymTable) == (size_t)iSize);
+      ASSURE(! SymTable_contains(oSymTable, "k-1"));
+
+      SymTable_free(oSymTable);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_newWithCapacity() and SymTable_reserve()
+   functions. */
+
+static void testCapacity(void)
+{
+   enum {KEY_COUNT = 10000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing capacity hints.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* A capacity of 0 gives an ordinary empty table. */
+   oSymTable = SymTable_newWithCapacity(0);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   ASSURE(SymTable_put(oSymTable, "Ruth", acValue));
+   ASSURE(SymTable_get(oSymTable, "Ruth") == acValue);
+   SymTable_free(oSymTable);
+
+   /* A table made for KEY_COUNT bindings holds them, and keeps
+      working as they are removed. */
+   oSymTable = SymTable_newWithCapacity(KEY_COUNT);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, acValue));
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == acValue);
+   }
+   for (i = 1; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == acValue);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(SymTable_get(oSymTable, "0") == acValue);
+   SymTable_free(oSymTable);
+
+   /* Reserving in a table that already has bindings keeps them. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT / 10; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, acValue));
+   }
+   ASSURE(SymTable_reserve(oSymTable, KEY_COUNT));
+   ASSURE(SymTable_reserve(oSymTable, 0));
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT / 10);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey) == (i < KEY_COUNT / 10));
+      if (i >= KEY_COUNT / 10)
+         ASSURE(SymTable_put(oSymTable, acKey, acValue));
+   }
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == acValue);
+   }
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_mapRange() and SymTable_mapPrefix() functions. */
+
+static void testOrdered(void)
+{
+   enum {KEY_COUNT = 2000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   const char *apcMapped[KEY_COUNT];
+   const char **ppcNext;
+   char acValue[] = "value";
+   int iCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing range and prefix maps.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* An empty table has nothing in any range. */
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapRange(oSymTable, NULL, NULL, appendKey, &ppcNext));
+   ASSURE(SymTable_mapPrefix(oSymTable, "", appendKey, &ppcNext));
+   ASSURE(ppcNext == apcMapped);
+
+   /* Zero padded keys sort by strcmp() as their numbers do. They
+      are put out of order, as 7 steps through all KEY_COUNT. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%04d", (i * 7) % KEY_COUNT);
+      ASSURE(SymTable_put(oSymTable, acKey, acValue));
+   }
+
+   /* Open ends cover the whole table, in order. */
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapRange(oSymTable, NULL, NULL, appendKey, &ppcNext));
+   ASSURE(ppcNext - apcMapped == KEY_COUNT);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(atoi(apcMapped[i]) == i);
+
+   /* The low end is in the range and the high end is not. */
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapRange(oSymTable, "0100", "0250", appendKey,
+      &ppcNext));
+   ASSURE(ppcNext - apcMapped == 150);
+   for (i = 0; i < 150; i++)
+      ASSURE(atoi(apcMapped[i]) == 100 + i);
+
+   /* Bounds need not be keys of the table. */
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapRange(oSymTable, "1997x", NULL, appendKey,
+      &ppcNext));
+   ASSURE(ppcNext - apcMapped == 2);
+   ASSURE(strcmp(apcMapped[0], "1998") == 0);
+   ASSURE(strcmp(apcMapped[1], "1999") == 0);
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapRange(oSymTable, NULL, "0002x", appendKey,
+      &ppcNext));
+   ASSURE(ppcNext - apcMapped == 3);
+   ASSURE(strcmp(apcMapped[2], "0002") == 0);
+
+   /* Empty and backwards ranges have nothing in them. */
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapRange(oSymTable, "0500", "0500", appendKey,
+      &ppcNext));
+   ASSURE(SymTable_mapRange(oSymTable, "0600", "0500", appendKey,
+      &ppcNext));
+   ASSURE(SymTable_mapRange(oSymTable, "2", NULL, appendKey, &ppcNext));
+   ASSURE(ppcNext == apcMapped);
+
+   /* A prefix selects the keys that start with it, in order. */
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapPrefix(oSymTable, "017", appendKey, &ppcNext));
+   ASSURE(ppcNext - apcMapped == 10);
+   for (i = 0; i < 10; i++)
+      ASSURE(atoi(apcMapped[i]) == 170 + i);
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapPrefix(oSymTable, "1999", appendKey, &ppcNext));
+   ASSURE(SymTable_mapPrefix(oSymTable, "2", appendKey, &ppcNext));
+   ASSURE(SymTable_mapPrefix(oSymTable, "01a", appendKey, &ppcNext));
+   ASSURE(ppcNext - apcMapped == 1);
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapPrefix(oSymTable, "", appendKey, &ppcNext));
+   ASSURE(ppcNext - apcMapped == KEY_COUNT);
+
+   /* Removed keys drop out of ranges, including after compacting. */
+   for (i = 1; i < KEY_COUNT; i += 2)
+   {
+      sprintf(acKey, "%04d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == acValue);
+   }
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapPrefix(oSymTable, "01", appendKey, &ppcNext));
+   iCount = (int)(ppcNext - apcMapped);
+   ASSURE(iCount == 50);
+   for (i = 0; i < iCount; i++)
+      ASSURE(atoi(apcMapped[i]) == 100 + 2 * i);
+   ASSURE(SymTable_compact(oSymTable));
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapRange(oSymTable, "0990", "1010", appendKey,
+      &ppcNext));
+   iCount = (int)(ppcNext - apcMapped);
+   ASSURE(iCount == 10);
+   for (i = 0; i < iCount; i++)
+      ASSURE(atoi(apcMapped[i]) == 990 + 2 * i);
+
    SymTable_free(oSymTable);
 }
 
 /*--------------------------------------------------------------------*/
 
+/* Increment the int that pvValue points to.  Every binding must
+   have an int of its own, so that calls made from several threads at
+   once never touch the same int.  pcKey and pvExtra are unused. */
+
+static void countVisit(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   (void)pvExtra;
+
+   (*(int*)pvValue)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_bulkLoad() and SymTable_mapParallel()
+   functions. */
+
+static void testParallel(void)
+{
+   /* KEY_COUNT is enough keys for an implementation to split them
+      over several threads. */
+   enum {KEY_COUNT = 20000, UNIQUE_COUNT = 15000, PUT_COUNT = 100,
+      MAX_KEY_LENGTH = 10};
+
+   static char aacKeys[KEY_COUNT][MAX_KEY_LENGTH];
+   static const char *apcKeys[KEY_COUNT];
+   static const void *apvValues[KEY_COUNT];
+   static int aiVisits[KEY_COUNT];
+   SymTable_T oSymTable;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the parallel functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* The keys after the first UNIQUE_COUNT repeat the first ones.
+      Every key has a value of its own. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(aacKeys[i], "%d", i < UNIQUE_COUNT ? i : i - UNIQUE_COUNT);
+      apcKeys[i] = aacKeys[i];
+      apvValues[i] = &aiVisits[i];
+      aiVisits[i] = 0;
+   }
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_bulkLoad(oSymTable, apcKeys, apvValues, 0, 4) == 0);
+
+   /* Keys already in the table and keys that repeat within the load
+      are added once, with the value they were first given. */
+   for (i = 0; i < PUT_COUNT; i++)
+      ASSURE(SymTable_put(oSymTable, apcKeys[i], apvValues[i]));
+   ASSURE(SymTable_bulkLoad(oSymTable, apcKeys, apvValues, KEY_COUNT, 4)
+      == UNIQUE_COUNT - PUT_COUNT);
+   ASSURE(SymTable_getLength(oSymTable) == UNIQUE_COUNT);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(SymTable_get(oSymTable, apcKeys[i])
+         == &aiVisits[i < UNIQUE_COUNT ? i : i - UNIQUE_COUNT]);
+
+   /* Each binding is visited once, whatever the number of threads. */
+   SymTable_mapParallel(oSymTable, countVisit, NULL, 4);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(aiVisits[i] == (i < UNIQUE_COUNT ? 1 : 0));
+   SymTable_mapParallel(oSymTable, countVisit, NULL, 0);
+   SymTable_mapParallel(oSymTable, countVisit, NULL, 1);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(aiVisits[i] == (i < UNIQUE_COUNT ? 3 : 0));
+
+   /* The table works as usual afterwards. */
+   for (i = 0; i < UNIQUE_COUNT; i += 2)
+      ASSURE(SymTable_remove(oSymTable, apcKeys[i]) == &aiVisits[i]);
+   ASSURE(SymTable_getLength(oSymTable) == UNIQUE_COUNT / 2);
+   ASSURE(SymTable_put(oSymTable, apcKeys[0], apvValues[0]));
+   SymTable_free(oSymTable);
+
+   /* A table loaded with one thread per processor holds the same
+      bindings. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_bulkLoad(oSymTable, apcKeys, apvValues, KEY_COUNT, 0)
+      == UNIQUE_COUNT);
+   for (i = 0; i < KEY_COUNT; i++)
+      aiVisits[i] = 0;
+   SymTable_mapParallel(oSymTable, countVisit, NULL, 0);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(aiVisits[i] == (i < UNIQUE_COUNT ? 1 : 0));
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that pcKey is the very pointer pvValue, as it is for every
+   binding put by testBorrowed(), and count the binding in the int
+   that pvExtra points to. */
+
+static void checkBorrowed(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   ASSURE(pcKey == (const char*)pvValue);
+   (*(int*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_newBorrowed() function and the Intern
+   functions. */
+
+static void testBorrowed(void)
+{
+   enum {KEY_COUNT = 1000, MAX_KEY_LENGTH = 40};
+
+   static char aacKeys[KEY_COUNT][MAX_KEY_LENGTH];
+   static const char *apcKeys[KEY_COUNT];
+   char acCopy[MAX_KEY_LENGTH];
+   SymTable_T oSymTable;
+   Intern_T oIntern;
+   struct SymTable_Iter sIter;
+   const char *pcKey;
+   const char *pcInterned;
+   void *pvValue;
+   int iCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing borrowed keys and interning.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Every third key is too long to be stored inline, in the
+      implementations that store short keys inline. Each key is bound
+      to itself. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      if (i % 3 == 0)
+         sprintf(aacKeys[i], "a long key that does not fit %d", i);
+      else
+         sprintf(aacKeys[i], "%d", i);
+      apcKeys[i] = aacKeys[i];
+   }
+
+   oSymTable = SymTable_newBorrowed();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT / 2; i++)
+      ASSURE(SymTable_put(oSymTable, apcKeys[i], apcKeys[i]));
+   ASSURE(SymTable_bulkLoad(oSymTable, apcKeys + KEY_COUNT / 2,
+      (const void**)apcKeys + KEY_COUNT / 2, KEY_COUNT - KEY_COUNT / 2,
+      4) == KEY_COUNT - KEY_COUNT / 2);
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+
+   /* Lookups match by the same pointer and by an equal copy. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      strcpy(acCopy, apcKeys[i]);
+      ASSURE(SymTable_get(oSymTable, apcKeys[i]) == apcKeys[i]);
+      ASSURE(SymTable_get(oSymTable, acCopy) == apcKeys[i]);
+      ASSURE(! SymTable_put(oSymTable, acCopy, acCopy));
+   }
+
+   /* The table passes out the keys it was given, not copies. */
+   iCount = 0;
+   SymTable_map(oSymTable, checkBorrowed, &iCount);
+   ASSURE(iCount == KEY_COUNT);
+   iCount = 0;
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+   {
+      ASSURE(pcKey == (const char*)pvValue);
+      iCount++;
+   }
+   ASSURE(iCount == KEY_COUNT);
+
+   /* Removes and compaction leave the remaining keys where they
+      are. */
+   for (i = 0; i < KEY_COUNT; i += 2)
+      ASSURE(SymTable_remove(oSymTable, apcKeys[i]) == apcKeys[i]);
+   ASSURE(SymTable_compact(oSymTable));
+   iCount = 0;
+   SymTable_map(oSymTable, checkBorrowed, &iCount);
+   ASSURE(iCount == KEY_COUNT / 2);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(SymTable_get(oSymTable, apcKeys[i])
+         == (i % 2 == 0 ? NULL : apcKeys[i]));
+   SymTable_free(oSymTable);
+
+   /* An Intern holds one copy of each string. */
+   oIntern = Intern_new();
+   ASSURE(oIntern != NULL);
+   oSymTable = SymTable_newBorrowed();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      pcInterned = Intern_string(oIntern, apcKeys[i]);
+      ASSURE(pcInterned != NULL);
+      ASSURE(pcInterned != apcKeys[i]);
+      ASSURE(strcmp(pcInterned, apcKeys[i]) == 0);
+      ASSURE(SymTable_put(oSymTable, pcInterned, pcInterned));
+   }
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      strcpy(acCopy, apcKeys[i]);
+      pcInterned = Intern_string(oIntern, acCopy);
+      ASSURE(pcInterned == Intern_string(oIntern, apcKeys[i]));
+      ASSURE(SymTable_get(oSymTable, pcInterned) == pcInterned);
+      ASSURE(SymTable_contains(oSymTable, apcKeys[i]));
+   }
+   ASSURE(Intern_string(oIntern, "") == Intern_string(oIntern, ""));
+   ASSURE(Intern_string(oIntern, "") != Intern_string(oIntern, "x"));
+   SymTable_free(oSymTable);
+   Intern_free(oIntern);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_save() and SymTable_openMapped() functions. */
+
+static void testSnapshot(void)
+{
+   enum {KEY_COUNT = 1000, MAX_KEY_LENGTH = 10};
+
+   static const char acPath[] = "testsymtable.snapshot";
+   SymTable_T oSymTable;
+   SymTable_T oMapped;
+   SymTable_T oOther;
+   struct SymTable_Iter sIter;
+   const char *apcMapped[KEY_COUNT];
+   const char **ppcNext;
+   const char *pcKey;
+   void *pvValue;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   FILE *psFile;
+   int iCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing snapshots.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Every third key is removed before saving, and the odd keys have
+      NULL values. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey,
+         (i % 2 == 0) ? acValue : NULL));
+   }
+   for (i = 0; i < KEY_COUNT; i += 3)
+   {
+      sprintf(acKey, "%d", i);
+      SymTable_remove(oSymTable, acKey);
+   }
+   ASSURE(SymTable_save(oSymTable, acPath));
+
+   /* The opened table has the same bindings. */
+   oMapped = SymTable_openMapped(acPath);
+   ASSURE(oMapped != NULL);
+   ASSURE(SymTable_getLength(oMapped) == SymTable_getLength(oSymTable));
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oMapped, acKey) == (i % 3 != 0));
+      ASSURE(SymTable_get(oMapped, acKey)
+         == ((i % 3 != 0 && i % 2 == 0) ? (void*)acValue : NULL));
+      ASSURE(SymTable_containsHashed(oMapped, acKey, strlen(acKey),
+         SymTable_hash(acKey, strlen(acKey))) == (i % 3 != 0));
+   }
+   ASSURE(! SymTable_contains(oMapped, ""));
+   ASSURE(! SymTable_contains(oMapped, "10000"));
+
+   /* Its traversals see every binding once. */
+   iCount = 0;
+   SymTable_iterBegin(oMapped, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+   {
+      ASSURE(SymTable_get(oSymTable, pcKey) == pvValue);
+      iCount++;
+   }
+   ASSURE(iCount == (int)SymTable_getLength(oSymTable));
+   ppcNext = apcMapped;
+   SymTable_map(oMapped, appendKey, &ppcNext);
+   ASSURE(ppcNext - apcMapped == iCount);
+   ppcNext = apcMapped;
+   ASSURE(SymTable_mapPrefix(oMapped, "99", appendKey, &ppcNext));
+   ASSURE(ppcNext - apcMapped == 6);
+   ASSURE(strcmp(apcMapped[0], "991") == 0);
+   ASSURE(strcmp(apcMapped[5], "998") == 0);
+
+   /* Saving over the file leaves the table opened from it as it was,
+      and an empty table can be saved and opened. */
+   oOther = SymTable_new();
+   ASSURE(oOther != NULL);
+   ASSURE(SymTable_save(oOther, acPath));
+   ASSURE(SymTable_get(oMapped, "1") == NULL);
+   ASSURE(SymTable_contains(oMapped, "1"));
+   ASSURE(SymTable_get(oMapped, "998") == acValue);
+   SymTable_free(oOther);
+   oOther = SymTable_openMapped(acPath);
+   ASSURE(oOther != NULL);
+   ASSURE(SymTable_getLength(oOther) == 0);
+   ASSURE(SymTable_get(oOther, "1") == NULL);
+   SymTable_free(oOther);
+   SymTable_free(oMapped);
+   SymTable_free(oSymTable);
+
+   /* A missing file or one that is not a snapshot cannot be
+      opened. */
+   remove(acPath);
+   ASSURE(SymTable_openMapped(acPath) == NULL);
+   psFile = fopen(acPath, "w");
+   ASSURE(psFile != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+      fputs("not a snapshot\n", psFile);
+   fclose(psFile);
+   ASSURE(SymTable_openMapped(acPath) == NULL);
+   remove(acPath);
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test the ability of a SymTable object to be large, that is, to
    contain iBindingCount bindings. Write the time consumed to stdout. */
 
@@ -960,6 +2215,19 @@ int main(int argc, char *argv[])
    testLongKey();
    testTableOfTables();
    testCollisions();
+   testStats();
+   testHashed();
+   testPutUnique();
+   testBatch();
+   testIterator();
+   testReorder();
+   testCompact();
+   testSmallTables();
+   testCapacity();
+   testOrdered();
+   testParallel();
+   testBorrowed();
+   testSnapshot();
    testLargeTable(iBindingCount);
 
    printf("------------------------------------------------------\n");